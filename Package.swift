@@ -48,10 +48,29 @@ let package = Package(
                 .headerSearchPath("ExternalHeaders/spice-client-glib-2.0")]),
         .testTarget(
             name: "CocoaSpiceTests",
+            dependencies: ["CocoaSpice", "CocoaSpiceRenderer"],
+            linkerSettings: [
+                .linkedLibrary("glib-2.0"),
+                .linkedLibrary("gstreamer-1.0"),
+                .linkedLibrary("gstapp-1.0"),
+                .linkedLibrary("gstvideo-1.0"),
+                .linkedLibrary("usb-1.0"),
+                .linkedLibrary("spice-client-glib-2.0")]),
+        .testTarget(
+            name: "CocoaSpiceInternalTests",
             dependencies: ["CocoaSpice"],
+            cSettings: [
+                .headerSearchPath("../../Sources/CocoaSpice"),
+                .headerSearchPath("../../Sources/CocoaSpice/ExternalHeaders"),
+                .headerSearchPath("../../Sources/CocoaSpice/ExternalHeaders/glib-2.0"),
+                .headerSearchPath("../../Sources/CocoaSpice/ExternalHeaders/gstreamer-1.0"),
+                .headerSearchPath("../../Sources/CocoaSpice/ExternalHeaders/spice-1"),
+                .headerSearchPath("../../Sources/CocoaSpice/ExternalHeaders/spice-client-glib-2.0")],
             linkerSettings: [
                 .linkedLibrary("glib-2.0"),
                 .linkedLibrary("gstreamer-1.0"),
+                .linkedLibrary("gstapp-1.0"),
+                .linkedLibrary("gstvideo-1.0"),
                 .linkedLibrary("usb-1.0"),
                 .linkedLibrary("spice-client-glib-2.0")]),
     ]
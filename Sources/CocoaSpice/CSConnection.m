@@ -19,6 +19,7 @@
 #import "CSCursor+Protected.h"
 #import "CSDisplay+Protected.h"
 #import "CSInput+Protected.h"
+#import "CSQualityController+Protected.h"
 #import "CSSession+Protected.h"
 #import "CSPort+Protected.h"
 #if defined(WITH_USB_SUPPORT)
@@ -34,6 +35,7 @@
 @property (nonatomic, readwrite) BOOL isTLSOnly;
 @property (nonatomic, readwrite) CSSession *session;
 @property (nonatomic, readwrite) CSUSBManager *usbManager;
+@property (nonatomic, readwrite) CSQualityController *qualityController;
 @property (nonatomic, readwrite) NSMutableArray<CSChannel *> *mutableChannels;
 @property (nonatomic, readwrite) SpiceSession *spiceSession;
 @property (nonatomic, readwrite) SpiceMainChannel *spiceMain;
@@ -115,7 +117,7 @@ static void cs_display_monitors(SpiceChannel *channel, GParamSpec *pspec,
     
     SPICE_DEBUG("[CocoaSpice] display %ld now has %d monitors", display.channelID, cfgs->len);
     if (cfgs->len > 0) {
-        g_assert(cfgs->len == 1);
+        // further heads show up in `CSDisplay.secondaryMonitors`
         if (display.hasInitialConfig) {
             [self.delegate spiceDisplayUpdated:self display:display];
         } else {
@@ -229,6 +231,7 @@ static void cs_channel_new(SpiceSession *s, SpiceChannel *channel, gpointer data
         SPICE_DEBUG("new inputs channel");
         CSInput *input = [[CSInput alloc] initWithChannel:SPICE_INPUTS_CHANNEL(channel)];
         input.spiceMain = self.spiceMain;
+        input.connection = self;
         [self.mutableChannels addObject:input];
         [self.delegate spiceInputAvailable:self input:input];
         spice_channel_connect(channel);
@@ -432,6 +435,7 @@ end:
 #endif
     self.session = [[CSSession alloc] initWithSession:self.spiceSession];
     self.mutableChannels = [NSMutableArray<CSChannel *> array];
+    self.qualityController = [[CSQualityController alloc] initWithConnection:self];
 }
 
 - (instancetype)initWithHost:(NSString *)host port:(NSString *)port {
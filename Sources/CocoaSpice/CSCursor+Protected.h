@@ -33,6 +33,12 @@ NS_ASSUME_NONNULL_BEGIN
 /// @param channel SPICE cursor channel
 - (instancetype)initWithChannel:(SpiceCursorChannel *)channel NS_DESIGNATED_INITIALIZER;
 
+/// Show the cursor at a position just sent to the guest
+///
+/// Must be called on the SPICE thread.
+/// @param point Absolute position in the display
+- (void)predictPosition:(CGPoint)point;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -21,6 +21,115 @@
 #import <glib.h>
 #import <spice-client.h>
 
+// Cursor shapes kept on the GPU, enough for the frames of an animated cursor and the
+// handful of shapes a guest switches between
+static const NSUInteger kCSCursorShapeCacheSize = 16;
+
+// Predicted positions not yet echoed by the guest, many times what a slow link has in flight
+#define kCSCursorPredictions 64
+
+// Microseconds after the last prediction the guest is trusted again
+static const gint64 kCSCursorPredictionTimeout = G_USEC_PER_SEC;
+
+/// A cursor shape uploaded to the GPU
+@interface _CSCursorShape : NSObject
+
+@property (nonatomic, readonly) uint64_t bitsHash;
+@property (nonatomic, readonly) NSData *bits;
+@property (nonatomic, readonly) CGSize size;
+@property (nonatomic, readonly) CGPoint hotspot;
+@property (nonatomic, readonly) id<MTLTexture> texture;
+@property (nonatomic, readonly) id<MTLBuffer> vertices;
+
+@end
+
+@implementation _CSCursorShape
+
+/// Upload a cursor shape
+/// - Parameters:
+///   - bits: 32-bit pixels of the shape
+///   - hash: Hash of `bits`
+///   - size: Size of the shape in pixels
+///   - hotspot: Offset in the shape of the pointer
+///   - device: Device to upload to
+///   - recycled: A shape no longer needed whose texture and vertices are reused if they fit
+- (nullable instancetype)initWithBits:(NSData *)bits
+                                 hash:(uint64_t)hash
+                                 size:(CGSize)size
+                              hotspot:(CGPoint)hotspot
+                               device:(id<MTLDevice>)device
+                             recycled:(nullable _CSCursorShape *)recycled {
+    if (self = [super init]) {
+        _bits = bits;
+        _bitsHash = hash;
+        _size = size;
+        _hotspot = hotspot;
+        if (recycled && recycled.texture.device == device && CGSizeEqualToSize(recycled.size, size)) {
+            _texture = recycled.texture;
+            if (CGPointEqualToPoint(recycled.hotspot, hotspot)) {
+                _vertices = recycled.vertices;
+            }
+        }
+        if (!_texture) {
+            MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
+            // don't worry that that components are reversed, we fix it in shaders
+            textureDescriptor.pixelFormat = MTLPixelFormatBGRA8Unorm;
+            textureDescriptor.width = size.width;
+            textureDescriptor.height = size.height;
+            textureDescriptor.usage = MTLTextureUsageShaderRead;
+            _texture = [device newTextureWithDescriptor:textureDescriptor];
+        }
+        if (!_vertices) {
+            // We flip the y-coordinates because pixman renders flipped
+            CSRenderVertex quadVertices[] =
+            {
+                // Pixel positions, Texture coordinates
+                { { -hotspot.x + size.width, hotspot.y               },  { 1.f, 0.f } },
+                { { -hotspot.x             , hotspot.y               },  { 0.f, 0.f } },
+                { { -hotspot.x             , hotspot.y - size.height },  { 0.f, 1.f } },
+
+                { { -hotspot.x + size.width, hotspot.y               },  { 1.f, 0.f } },
+                { { -hotspot.x             , hotspot.y - size.height },  { 0.f, 1.f } },
+                { { -hotspot.x + size.width, hotspot.y - size.height },  { 1.f, 1.f } },
+            };
+
+            // Create our vertex buffer, and initialize it with our quadVertices array
+            _vertices = [device newBufferWithBytes:quadVertices
+                                            length:sizeof(quadVertices)
+                                           options:MTLResourceStorageModeShared];
+        }
+        if (!_texture || !_vertices) {
+            return nil;
+        }
+        const NSInteger pixelSize = 4;
+        MTLRegion region = {
+            { 0, 0 }, // MTLOrigin
+            { size.width, size.height, 1} // MTLSize
+        };
+        [_texture replaceRegion:region
+                    mipmapLevel:0
+                      withBytes:bits.bytes
+                    bytesPerRow:size.width*pixelSize];
+    }
+    return self;
+}
+
+- (BOOL)matchesBits:(const void *)bits
+             length:(NSUInteger)length
+               hash:(uint64_t)hash
+               size:(CGSize)size
+            hotspot:(CGPoint)hotspot
+             device:(id<MTLDevice>)device {
+    return self.bitsHash == hash &&
+        CGSizeEqualToSize(self.size, size) &&
+        CGPointEqualToPoint(self.hotspot, hotspot) &&
+        self.texture.device == device &&
+        self.bits.length == length &&
+        memcmp(self.bits.bytes, bits, length) == 0;
+}
+
+@end
+
 @interface CSCursor ()
 
 @property (nonatomic, weak) CSDisplay *display;
@@ -30,6 +139,8 @@
 @property (nonatomic, readwrite) BOOL hasCursor;
 @property (nonatomic, readwrite) BOOL cursorHidden;
 @property (nonatomic) CGPoint mouseGuest;
+@property (nonatomic, readonly) NSMutableArray<_CSCursorShape *> *shapeCache;
+@property (nonatomic, readwrite) NSUInteger shapeUploadCount;
 
 @property (nonatomic, nullable, readwrite) id<MTLTexture> texture;
 @property (nonatomic, readwrite) NSUInteger numVertices;
@@ -37,13 +148,19 @@
 
 @end
 
-@implementation CSCursor
+@implementation CSCursor {
+    // Positions sent to the guest and shown ahead of its echo, oldest first
+    CGPoint _predictions[kCSCursorPredictions];
+    NSUInteger _predictionCount;
+    gint64 _lastPredictionTime;
+}
 
 #pragma mark - Cursor events
 
 static void cs_cursor_invalidate(CSCursor *self)
 {
-    [self.display invalidate];
+    // nothing but the cursor changed, renderers need not present the whole display for it
+    [self.display invalidateCursor];
 }
 
 static void cs_cursor_set(SpiceCursorChannel *channel,
@@ -63,11 +180,7 @@ static void cs_cursor_set(SpiceCursorChannel *channel,
     
     CGPoint hotspot = CGPointMake(cursor_shape->hot_spot_x, cursor_shape->hot_spot_y);
     CGSize newSize = CGSizeMake(cursor_shape->width, cursor_shape->height);
-    if (!CGSizeEqualToSize(newSize, self.cursorSize) || !CGPointEqualToPoint(hotspot, self.cursorHotspot)) {
-        [self rebuildCursorWithSize:newSize center:hotspot];
-    }
-    [self drawCursor:cursor_shape->data];
-    // this has to be after drawCursor: which runs in the same serial queue
+    [self setCursorBits:cursor_shape->data size:newSize center:hotspot];
     g_boxed_free(SPICE_TYPE_CURSOR_SHAPE, cursor_shape);
     self.cursorHidden = NO;
     cs_cursor_invalidate(self);
@@ -77,7 +190,9 @@ static void cs_cursor_move(SpiceCursorChannel *channel, gint x, gint y, gpointer
 {
     CSCursor *self = (__bridge CSCursor *)data;
     
-    self.mouseGuest = CGPointMake(x, y);
+    if (![self consumePredictionOf:CGPointMake(x, y)]) {
+        self.mouseGuest = CGPointMake(x, y);
+    }
 
     /* apparently we have to restore cursor when "cursor_move" */
     if (self.hasCursor) {
@@ -117,6 +232,7 @@ static void cs_update_mouse_mode(SpiceChannel *channel, gpointer data)
     if (mouse_mode == SPICE_MOUSE_MODE_SERVER) {
         self.mouseGuest = CGPointMake(-1, -1);
     }
+    self->_predictionCount = 0;
 }
 
 #pragma mark - Properties
@@ -182,6 +298,8 @@ static void cs_update_mouse_mode(SpiceChannel *channel, gpointer data)
 - (instancetype)initWithChannel:(SpiceCursorChannel *)channel {
     if (self = [self init]) {
         gpointer cursor_shape;
+        _shapeCache = [NSMutableArray arrayWithCapacity:kCSCursorShapeCacheSize];
+        _predictsPosition = YES;
         self.channel = g_object_ref(channel);
         g_signal_connect(channel, "notify::cursor",
                          G_CALLBACK(cs_cursor_set), (__bridge void *)self);
@@ -218,40 +336,72 @@ static void cs_update_mouse_mode(SpiceChannel *channel, gpointer data)
 
 #pragma mark - Cursor drawing
 
-- (void)rebuildCursorWithSize:(CGSize)size center:(CGPoint)hotspot {
-    // hotspot is the offset in buffer for the center of the pointer
-    if (!self.device) {
+/// FNV-1a over the shape, only to rule out most shapes before comparing the bits
+static uint64_t cs_cursor_hash(const uint32_t *pixels, NSUInteger count) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (NSUInteger i = 0; i < count; i++) {
+        hash ^= pixels[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/// Show a cursor shape
+///
+/// Shapes seen recently are kept on the GPU, so a guest switching back to one of them (or
+/// cycling through the frames of an animated cursor) costs a lookup and no upload. A shape
+/// that is not found takes the place of the least recently used one, reusing its texture
+/// when the size matches.
+/// - Parameters:
+///   - bits: 32-bit pixels of the shape
+///   - size: Size of the shape in pixels
+///   - hotspot: Offset in the shape for the center of the pointer
+- (void)setCursorBits:(const void *)bits size:(CGSize)size center:(CGPoint)hotspot {
+    id<MTLDevice> device = self.device;
+    if (!device) {
         SPICE_DEBUG("[CocoaSpice] MTL device not ready for cursor draw");
         return;
     }
-    MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
-    // don't worry that that components are reversed, we fix it in shaders
-    textureDescriptor.pixelFormat = MTLPixelFormatBGRA8Unorm;
-    textureDescriptor.width = size.width;
-    textureDescriptor.height = size.height;
-    textureDescriptor.usage = MTLTextureUsageShaderRead;
-    self.texture = [self.device newTextureWithDescriptor:textureDescriptor];
-
-    // We flip the y-coordinates because pixman renders flipped
-    CSRenderVertex quadVertices[] =
-    {
-        // Pixel positions, Texture coordinates
-        { { -hotspot.x + size.width, hotspot.y               },  { 1.f, 0.f } },
-        { { -hotspot.x             , hotspot.y               },  { 0.f, 0.f } },
-        { { -hotspot.x             , hotspot.y - size.height },  { 0.f, 1.f } },
-
-        { { -hotspot.x + size.width, hotspot.y               },  { 1.f, 0.f } },
-        { { -hotspot.x             , hotspot.y - size.height },  { 0.f, 1.f } },
-        { { -hotspot.x + size.width, hotspot.y - size.height },  { 1.f, 1.f } },
-    };
-
-    // Create our vertex buffer, and initialize it with our quadVertices array
-    self.vertices = [self.device newBufferWithBytes:quadVertices
-                                             length:sizeof(quadVertices)
-                                            options:MTLResourceStorageModeShared];
-
-    // Calculate the number of vertices by dividing the byte length by the size of each vertex
-    self.numVertices = sizeof(quadVertices) / sizeof(CSRenderVertex);
+    if (size.width <= 0 || size.height <= 0) {
+        return;
+    }
+    NSUInteger count = size.width * size.height;
+    NSUInteger length = count * sizeof(uint32_t);
+    uint64_t hash = cs_cursor_hash(bits, count);
+    NSMutableArray<_CSCursorShape *> *cache = self.shapeCache;
+    _CSCursorShape *shape = nil;
+
+    for (NSUInteger i = 0; i < cache.count; i++) {
+        if ([cache[i] matchesBits:bits length:length hash:hash size:size hotspot:hotspot device:device]) {
+            shape = cache[i];
+            [cache removeObjectAtIndex:i];
+            break;
+        }
+    }
+    if (!shape) {
+        _CSCursorShape *recycled = nil;
+        // the one being replaced is never the one on screen, that is always the most recent
+        if (cache.count >= kCSCursorShapeCacheSize) {
+            recycled = cache.lastObject;
+            [cache removeLastObject];
+        }
+        shape = [[_CSCursorShape alloc] initWithBits:[NSData dataWithBytes:bits length:length]
+                                                hash:hash
+                                                size:size
+                                             hotspot:hotspot
+                                              device:device
+                                            recycled:recycled];
+        if (!shape) {
+            SPICE_DEBUG("[CocoaSpice] failed to upload cursor");
+            return;
+        }
+        self.shapeUploadCount++;
+    }
+    [cache insertObject:shape atIndex:0];
+
+    self.texture = shape.texture;
+    self.vertices = shape.vertices;
+    self.numVertices = 6;
     self.cursorSize = size;
     self.cursorHotspot = hotspot;
     self.hasCursor = YES;
@@ -266,20 +416,51 @@ static void cs_update_mouse_mode(SpiceChannel *channel, gpointer data)
     self.hasCursor = NO;
 }
 
-- (void)drawCursor:(const void *)buffer {
-    CGSize cursorSize = self.cursorSize;
-    if (CGSizeEqualToSize(cursorSize, CGSizeZero)) {
+#pragma mark - Prediction
+
+- (void)predictPosition:(CGPoint)point {
+    if (!self.predictsPosition) {
         return;
     }
-    const NSInteger pixelSize = 4;
-    MTLRegion region = {
-        { 0, 0 }, // MTLOrigin
-        { cursorSize.width, cursorSize.height, 1} // MTLSize
-    };
-    [self.texture replaceRegion:region
-                    mipmapLevel:0
-                      withBytes:buffer
-                    bytesPerRow:cursorSize.width*pixelSize];
+    if (_predictionCount == kCSCursorPredictions) {
+        // the guest fell far behind, forget the oldest
+        memmove(&_predictions[0], &_predictions[1], sizeof(_predictions[0]) * (kCSCursorPredictions - 1));
+        _predictionCount--;
+    }
+    _predictions[_predictionCount++] = point;
+    _lastPredictionTime = g_get_monotonic_time();
+    if (!CGPointEqualToPoint(self.mouseGuest, point)) {
+        self.mouseGuest = point;
+        cs_cursor_invalidate(self);
+    }
+}
+
+/// Reconcile a position from the guest with what was predicted
+///
+/// A position we predicted is an echo of one we already show, or showed and moved on from,
+/// so drawing it would only pull the cursor back along its path. Anything else is the guest
+/// placing the cursor itself, by warping or clamping it, and is where the cursor really is.
+/// @param point Position reported by the guest
+/// @returns YES if the position was predicted and should not be drawn
+- (BOOL)consumePredictionOf:(CGPoint)point {
+    if (_predictionCount == 0) {
+        return NO;
+    }
+    if (g_get_monotonic_time() - _lastPredictionTime > kCSCursorPredictionTimeout) {
+        // the guest has had ample time to catch up, whatever it says now stands
+        _predictionCount = 0;
+        return NO;
+    }
+    for (NSUInteger i = 0; i < _predictionCount; i++) {
+        if (fabs(_predictions[i].x - point.x) <= 1 && fabs(_predictions[i].y - point.y) <= 1) {
+            // everything before it has been handled too
+            _predictionCount -= i + 1;
+            memmove(&_predictions[0], &_predictions[i + 1], sizeof(_predictions[0]) * _predictionCount);
+            return YES;
+        }
+    }
+    _predictionCount = 0;
+    return NO;
 }
 
 - (void)moveTo:(CGPoint)point {
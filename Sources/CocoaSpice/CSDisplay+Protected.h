@@ -16,7 +16,9 @@
 
 #import "CSDisplay.h"
 #import "CSRenderer.h"
+#import "CSScreenshotReadback.h"
 
+@class CSDisplayOverlay;
 typedef struct _SpiceDisplayChannel SpiceDisplayChannel;
 
 NS_ASSUME_NONNULL_BEGIN
@@ -36,11 +38,43 @@ NS_ASSUME_NONNULL_BEGIN
 /// Set to true in CSConnection after seeing the first monitor config
 @property (nonatomic) BOOL hasInitialConfig;
 
+/// Video codecs we can decode, ordered for a link of the given bandwidth
+/// @param bandwidth Bytes per second the link is expected to carry
++ (NSArray<NSNumber *> *)videoCodecsForBandwidth:(double)bandwidth;
+
+/// Image compression for a link of the given bandwidth
+/// @param bandwidth Bytes per second the link is expected to carry
++ (CSDisplayImageCompression)imageCompressionForBandwidth:(double)bandwidth;
+
 /// Create a new display for a given channel and monitor
 /// @param channel Display channel
 /// @param monitorID Monitor in the channel
 - (instancetype)initWithChannel:(SpiceDisplayChannel *)channel NS_DESIGNATED_INITIALIZER;
 
+/// Request a new resolution for one of the heads of this display
+///
+/// Ignored for heads SPICE cannot address, those after the first of any channel but the first.
+/// @param bounds The requested display bounds
+/// @param monitorID Head to resize, `monitorID` for the display itself
+- (void)requestResolution:(CGRect)bounds forMonitorID:(NSInteger)monitorID;
+
+/// Present a decoded video frame in place of the canvas
+/// @param overlay Overlay the frame belongs to, ignored unless it is the display's current one
+/// @param texture Frame to present, must not be written until `completion` runs
+/// @param completion Runs once the frame has been drawn or was ignored
+- (void)overlay:(CSDisplayOverlay *)overlay presentTexture:(id<MTLTexture>)texture completion:(completionCallback_t)completion;
+
+/// Copy the frame being presented into a readback buffer
+///
+/// Must be called on the SPICE thread, only the copy itself happens there.
+/// @param readback Readback to take the buffer from
+/// @param completion Runs on the readback queue with the buffer, which it has to recycle, or nil on failure
+- (void)captureFrameWithReadback:(CSScreenshotReadback *)readback completion:(captureCallback_t)completion;
+
+/// Go back to presenting the canvas if `overlay` is the display's current one
+/// @param overlay Overlay whose stream ended
+- (void)overlayDidFinish:(CSDisplayOverlay *)overlay;
+
 @end
 
 NS_ASSUME_NONNULL_END
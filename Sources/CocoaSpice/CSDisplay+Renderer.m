@@ -17,6 +17,7 @@
 #import "CSDisplay+Renderer.h"
 #import "CSDisplay+Protected.h"
 #import "CSDisplay+Renderer_Protected.h"
+#import "CSDisplayMonitor+Protected.h"
 #import "CSRenderer.h"
 #import <stdatomic.h>
 
@@ -48,50 +49,71 @@
     [renderer disableRender];
 }
 
+/// Every renderer presenting this display or one of its other heads, with the source it presents
+- (NSUInteger)getRenderers:(NSArray<id<CSRenderer>> **)renderers sources:(NSArray<id<CSRenderSource>> **)sources {
+    /* lockless operation, need to get a copy of renderers */
+    NSMutableArray<id<CSRenderer>> *allRenderers = [self.renderers mutableCopy];
+    NSMutableArray<id<CSRenderSource>> *allSources = [NSMutableArray arrayWithCapacity:allRenderers.count];
+    for (NSUInteger i = 0; i < allRenderers.count; i++) {
+        [allSources addObject:self];
+    }
+    for (CSDisplayMonitor *monitor in self.secondaryMonitors) {
+        for (id<CSRenderer> renderer in monitor.renderers) {
+            [allRenderers addObject:renderer];
+            [allSources addObject:monitor];
+        }
+    }
+    *renderers = allRenderers;
+    *sources = allSources;
+    return allRenderers.count;
+}
+
 - (void)copyBuffer:(id<MTLBuffer>)sourceBuffer
-            region:(MTLRegion)region
-      sourceOffset:(NSUInteger)sourceOffset
+           regions:(const MTLRegion *)regions
+     sourceOffsets:(const NSUInteger *)sourceOffsets
+             count:(NSUInteger)count
  sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
         completion:(completionCallback_t)completion {
-    /* lockless operation, need to get a copy of renderers */
-    NSArray<id<CSRenderer>> *renderers = self.renderers;
-    __block atomic_int numRemaining = renderers.count;
+    NSArray<id<CSRenderer>> *renderers;
+    NSArray<id<CSRenderSource>> *sources;
+    __block atomic_int numRemaining = (int)[self getRenderers:&renderers sources:&sources];
     if (renderers.count == 0) {
         completion(); // nobody is left to call us back
         return;
     }
-    [renderers[0] renderSouce:self
+    // every head shares the texture, so one copy serves them all
+    [renderers[0] renderSouce:sources[0]
                    copyBuffer:sourceBuffer
-                       region:region
-                 sourceOffset:sourceOffset
+                      regions:regions
+                sourceOffsets:sourceOffsets
+                        count:count
             sourceBytesPerRow:sourceBytesPerRow
                    completion:^{
-        if (atomic_fetch_sub(&numRemaining, 1) == 1) {
-            completion();
-        }
-    }];
-    if (renderers.count > 1) {
-        // invalidate all others
+        // invalidate all others only now: they draw from their own command queues, which
+        // are not ordered against the copy, and would show the texture without it
         for (NSInteger i = 1; i < renderers.count; i++) {
-            [renderers[i] invalidateRenderSource:self withCompletion:^{
+            [renderers[i] invalidateRenderSource:sources[i] withCompletion:^{
                 if (atomic_fetch_sub(&numRemaining, 1) == 1) {
                     completion();
                 }
             }];
         }
-    }
+        if (atomic_fetch_sub(&numRemaining, 1) == 1) {
+            completion();
+        }
+    }];
 }
 
 - (void)invalidateWithCompletion:(completionCallback_t)completion {
-    /* lockless operation, need to get a copy of renderers */
-    NSArray<id<CSRenderer>> *renderers = self.renderers;
-    __block atomic_int numRemaining = renderers.count;
+    NSArray<id<CSRenderer>> *renderers;
+    NSArray<id<CSRenderSource>> *sources;
+    __block atomic_int numRemaining = (int)[self getRenderers:&renderers sources:&sources];
     if (renderers.count == 0) {
         completion(); // nobody is left to call us back
         return;
     }
     for (NSInteger i = 0; i < renderers.count; i++) {
-        [renderers[i] invalidateRenderSource:self withCompletion:^{
+        [renderers[i] invalidateRenderSource:sources[i] withCompletion:^{
             if (atomic_fetch_sub(&numRemaining, 1) == 1) {
                 completion();
             }
@@ -100,14 +122,31 @@
 }
 
 - (void)invalidate {
-    NSArray<id<CSRenderer>> *renderers = self.renderers;
+    NSArray<id<CSRenderer>> *renderers;
+    NSArray<id<CSRenderSource>> *sources;
+    [self getRenderers:&renderers sources:&sources];
     for (NSInteger i = 0; i < renderers.count; i++) {
-        [renderers[i] invalidateRenderSource:self withCompletion:nil];
+        [renderers[i] invalidateRenderSource:sources[i] withCompletion:nil];
+    }
+}
+
+- (void)invalidateCursor {
+    NSArray<id<CSRenderer>> *renderers;
+    NSArray<id<CSRenderSource>> *sources;
+    [self getRenderers:&renderers sources:&sources];
+    for (NSInteger i = 0; i < renderers.count; i++) {
+        if ([renderers[i] respondsToSelector:@selector(invalidateCursorOfRenderSource:)]) {
+            [renderers[i] invalidateCursorOfRenderSource:sources[i]];
+        } else {
+            [renderers[i] invalidateRenderSource:sources[i] withCompletion:nil];
+        }
     }
 }
 
 - (void)disableScanout {
-    NSArray<id<CSRenderer>> *renderers = self.renderers;
+    NSArray<id<CSRenderer>> *renderers;
+    NSArray<id<CSRenderSource>> *sources;
+    [self getRenderers:&renderers sources:&sources];
     for (NSInteger i = 0; i < renderers.count; i++) {
         [renderers[i] disableRender];
     }
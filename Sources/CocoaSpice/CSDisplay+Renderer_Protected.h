@@ -21,8 +21,9 @@ NS_ASSUME_NONNULL_BEGIN
 @interface CSDisplay (Renderer)
 
 - (void)copyBuffer:(id<MTLBuffer>)sourceBuffer
-            region:(MTLRegion)region
-      sourceOffset:(NSUInteger)sourceOffset
+           regions:(const MTLRegion *)regions
+     sourceOffsets:(const NSUInteger *)sourceOffsets
+             count:(NSUInteger)count
  sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
         completion:(completionCallback_t)completion;
 
@@ -30,6 +31,9 @@ NS_ASSUME_NONNULL_BEGIN
 
 - (void)invalidate;
 
+/// Redraw only the cursor, where renderers support it
+- (void)invalidateCursor;
+
 - (void)disableScanout;
 
 @end
@@ -14,20 +14,70 @@
 // limitations under the License.
 //
 
-@import CoreImage;
 #import "TargetConditionals.h"
 #import "CocoaSpice.h"
 #import "CSCursor+Protected.h"
 #import "CSChannel+Protected.h"
 #import "CSDisplay+Renderer_Protected.h"
+#import "CSDisplayMonitor+Protected.h"
+#import "CSDisplayOverlay.h"
+#import "CSDisplayRecorder.h"
+#import "CSDisplayStatistics+Protected.h"
+#import "CSDisplayThumbnail.h"
+#import "CSRegion.h"
+#import "CSScreenshotReadback.h"
 #import "CSShaderTypes.h"
 #import <glib.h>
+#import <gst/gst.h>
 #import <poll.h>
 #import <spice-client.h>
 #import <spice/protocol.h>
 #import <IOSurface/IOSurfaceRef.h>
+#import <VideoToolbox/VideoToolbox.h>
 #import <mach/vm_page_size.h>
 
+// Scanout surfaces kept wrapped in a texture, enough for a triple buffered guest
+static const NSUInteger kCSDisplayScanoutCacheSize = 4;
+
+// Heads SPICE numbers on its own, as `MAX_DISPLAY` in spice-gtk
+static const NSInteger kCSDisplayMaxMonitors = 16;
+
+/// A GL scanout surface wrapped in a texture
+@interface _CSScanoutTexture : NSObject
+
+@property (nonatomic, readonly) IOSurfaceID surfaceID;
+@property (nonatomic, readonly) uint32_t format;
+@property (nonatomic, readonly) id<MTLTexture> texture;
+
+@end
+
+@implementation _CSScanoutTexture
+
+/// Wrap a scanout surface
+/// - Parameters:
+///   - texture: Texture backed by the surface
+///   - surfaceID: ID the server sent for the surface
+///   - format: DRM format of the scanout
+- (instancetype)initWithTexture:(id<MTLTexture>)texture surfaceID:(IOSurfaceID)surfaceID format:(uint32_t)format {
+    if (self = [super init]) {
+        _texture = texture;
+        _surfaceID = surfaceID;
+        _format = format;
+    }
+    return self;
+}
+
+- (BOOL)matchesScanout:(SpiceGlScanout)scanout surfaceID:(IOSurfaceID)surfaceID device:(id<MTLDevice>)device {
+    // the texture holds a reference to the surface, so its ID cannot have been reused
+    return _surfaceID == surfaceID &&
+           _format == scanout.format &&
+           _texture.width == scanout.width &&
+           _texture.height == scanout.height &&
+           _texture.device == device;
+}
+
+@end
+
 @interface CSDisplay ()
 
 @property (nonatomic, assign) BOOL ready;
@@ -47,15 +97,33 @@
 @property (nonatomic) CGRect canvasArea;
 @property (nonatomic) id<MTLBuffer> canvasBuffer;
 @property (nonatomic) NSUInteger canvasBufferOffset;
-@property (nonatomic) BOOL canvasIsBusy;
-@property (nonatomic) CGRect canvasDirtyRect;
+@property (nonatomic, readwrite) BOOL canvasUsesSharedStorage;
+@property (nonatomic) NSUInteger canvasUploadsInFlight;
+@property (nonatomic, readonly) NSInteger canvasPixelSize;
+
+// Guest video decoded straight to a texture, see `cs_set_overlay`
+@property (nonatomic, nullable) CSDisplayOverlay *overlay;
+@property (atomic, nullable) id<MTLTexture> overlayTexture;
+// Streams can be decoded to an overlay, otherwise spice-gtk draws them into the surface
+@property (nonatomic, readonly) BOOL canPresentOverlay;
 
 // Other Drawing
+// Area held by the texture, the union of every head's area
 @property (nonatomic) CGRect visibleArea;
+// Area of the first head, the one presented by the display itself
+@property (nonatomic) CGRect monitorArea;
 @property (nonatomic, readwrite) CGSize displaySize;
+@property (atomic, readwrite) NSArray<CSDisplayMonitor *> *secondaryMonitors;
 
-// GL scanout shadow buffer, see `copyScanoutRect:withCompletion:`
-@property (nonatomic, nullable) id<MTLTexture> shadowTexture;
+// GL scanout textures, most recently used first, see `rebuildScanoutTextureWithScanout:`
+@property (nonatomic, readonly) NSMutableArray<_CSScanoutTexture *> *scanoutCache;
+@property (nonatomic, readwrite) uint64_t scanoutTextureCount;
+
+// GL scanout shadow ring, see `copyScanoutRect:withCompletion:`
+@property (nonatomic, nullable) NSArray<id<MTLTexture>> *shadowTextures;
+@property (nonatomic, nullable) id<MTLCommandQueue> shadowCopyQueue;
+// Signalled by every shadow copy, on whichever queue, so readbacks can wait for them
+@property (nonatomic, nullable) id<MTLEvent> shadowCopyEvent API_AVAILABLE(ios(12), macos(10.14));
 @property (atomic, nullable) id<MTLTexture> presentTexture;
 @property (nonatomic) BOOL shadowNeedsFullCopy;
 
@@ -68,12 +136,69 @@
 @property (nonatomic) id<MTLDevice> device;
 @property (atomic) NSArray<id<CSRenderer>> *renderers;
 
+@property (atomic, readwrite) double measuredBandwidth;
+
+// Screenshots, see `captureWithCompletion:`
+@property (nonatomic) CSScreenshotReadback *screenshotReadback;
+@property (atomic, nullable) CSDisplayThumbnail *thumbnail;
+@property (atomic, nullable) CSDisplayRecorder *recorder;
+
 @end
 
-@implementation CSDisplay
+// Shadow textures a GL scanout is copied into: one presented, one the renderer
+// may still be drawing from, and one free for the next copy
+enum { kCSDisplayShadowTextures = 3 };
+// Frames of damage remembered for catching up a shadow that missed them
+enum { kCSDisplayShadowDamageHistory = 8 };
+
+@implementation CSDisplay {
+    // Non-GL canvas damage waiting for an upload slot, see `drawDirtyRegion`
+    CSRegion _canvasDirtyRegion;
+    // Uploads submitted, indexed by how many were in flight including that one
+    uint64_t _canvasUploadsInFlightHistogram[kCSDisplayMaxCanvasUploadsInFlight + 1];
+    // When the oldest damage in `_canvasDirtyRegion` arrived, 0 if it did not come from the server
+    uint64_t _canvasDirtySince;
+    // When the `gl-draw` being handled arrived, the server sends no other until it is acknowledged
+    uint64_t _glDrawReceivedAt;
+    // GL frames acknowledged but not yet drawn by the renderer
+    NSUInteger _glPresentsPending;
+    // Shadow ring state, indexed like `shadowTextures` and only touched on the SPICE thread.
+    // Frames are numbered from 1 and never reset, a shadow holding frame 0 is undefined.
+    uint64_t _shadowFrame[kCSDisplayShadowTextures];
+    // 0 if free, UINT64_MAX while copied into or presented, otherwise the
+    // shadow is free once the renderer has drawn that frame
+    uint64_t _shadowBusyUntil[kCSDisplayShadowTextures];
+    CGRect _shadowDamage[kCSDisplayShadowDamageHistory];
+    uint64_t _shadowFrameCount;
+    uint64_t _shadowPresentedFrame;
+    NSInteger _shadowPresented;
+    // Last value `shadowCopyEvent` was told to signal
+    uint64_t _shadowCopyEventValue;
+    // Throughput sampling for `automaticEncoding`, only touched on the SPICE thread
+    GSource *_encodingTimer;
+    gulong _encodingLastReadBytes;
+    uint64_t _encodingLastSampleAt;
+    // Preferences the server already has, only touched on the SPICE thread
+    CSDisplayImageCompression _sentImageCompression;
+    NSArray<NSNumber *> *_sentVideoCodecs;
+    // Thumbnail damage waiting for `_thumbnailTimer`, only touched on the SPICE thread
+    GSource *_thumbnailTimer;
+    CGRect _thumbnailDirty;
+    uint64_t _thumbnailLastGeneration;
+}
+
+@synthesize maxCanvasUploadsInFlight = _maxCanvasUploadsInFlight;
+@synthesize preferredImageCompression = _preferredImageCompression;
+@synthesize preferredVideoCodecs = _preferredVideoCodecs;
+@synthesize automaticEncoding = _automaticEncoding;
+@synthesize thumbnailWidth = _thumbnailWidth;
 
 #pragma mark - Display events
 
+static CSRegionRect cs_region_rect(CGRect rect) {
+    return (CSRegionRect){ rect.origin.x, rect.origin.y, rect.size.width, rect.size.height };
+}
+
 static void cs_primary_create(SpiceChannel *channel, gint format,
                            gint width, gint height, gint stride,
                            gint shmid, gpointer imgdata, gpointer data) {
@@ -87,6 +212,10 @@ static void cs_primary_create(SpiceChannel *channel, gint format,
     self.canvasData = imgdata;
     
     cs_update_monitor_area(channel, NULL, data);
+    // a new primary surface may be a new connection that has not heard our preferences
+    self->_sentImageCompression = kCSDisplayImageCompressionDefault;
+    self->_sentVideoCodecs = nil;
+    [self sendEncodingPreferences];
 }
 
 static void cs_primary_destroy(SpiceDisplayChannel *channel, gpointer data) {
@@ -99,7 +228,15 @@ static void cs_primary_destroy(SpiceDisplayChannel *channel, gpointer data) {
     self.canvasStride = 0;
     self.canvasData = NULL;
     self.canvasBuffer = NULL; // no more new draws
-    if (self.canvasIsBusy) {
+    self.overlay = nil;
+    self.overlayTexture = nil;
+    if (!cs_region_is_empty(&self->_canvasDirtyRegion)) {
+        [self.statistics recordFrameDropped];
+    }
+    cs_region_clear(&self->_canvasDirtyRegion);
+    // the canvas is gone, keep the thumbnail of its last frame
+    [self stopThumbnailTimer];
+    if (self.canvasUploadsInFlight > 0) {
         dispatch_semaphore_t invalidateComplete = dispatch_semaphore_create(0);
         [self invalidateWithCompletion:^{
             dispatch_semaphore_signal(invalidateComplete);
@@ -107,10 +244,11 @@ static void cs_primary_destroy(SpiceDisplayChannel *channel, gpointer data) {
         dispatch_semaphore_wait(invalidateComplete, DISPATCH_TIME_FOREVER);
     }
     [self disableScanout];
-    // the copy is only meaningful while there is a scanout to copy, and it is
-    // a full sized private allocation we would otherwise hold onto forever
-    self.shadowTexture = nil;
-    self.presentTexture = nil;
+    // the copies are only meaningful while there is a scanout to copy, and they
+    // are full sized private allocations we would otherwise hold onto forever
+    [self discardShadowTextures];
+    // as are the wrapped scanouts, which also keep the server's surfaces alive
+    [self.scanoutCache removeAllObjects];
 }
 
 static void cs_invalidate(SpiceChannel *channel,
@@ -121,11 +259,19 @@ static void cs_invalidate(SpiceChannel *channel,
     CGRect rect = CGRectIntersection(CGRectMake(x, y, w, h), self.visibleArea);
     g_assert(!self.isGLEnabled);
     if (!CGRectIsEmpty(rect)) {
-        if (!self.canvasIsBusy) {
-            [self drawRegion:rect];
+        [self.statistics recordFrameReceived];
+        if (cs_region_is_empty(&self->_canvasDirtyRegion)) {
+            self->_canvasDirtySince = cs_display_statistics_now();
         } else {
-            self.canvasDirtyRect = CGRectUnion(self.canvasDirtyRect, rect);
+            // goes out with the damage already waiting for an upload slot
+            [self.statistics recordFrameMerged];
+        }
+        cs_region_add(&self->_canvasDirtyRegion, cs_region_rect(rect));
+        if (self.canvasUploadsInFlight < self.maxCanvasUploadsInFlight) {
+            [self drawDirtyRegion];
         }
+        [self invalidateThumbnailRect:rect];
+        [self.recorder invalidate];
     }
 }
 
@@ -136,17 +282,60 @@ static void cs_mark(SpiceChannel *channel, gint mark, gpointer data) {
     //}
 }
 
+static gpointer cs_streaming_mode(SpiceChannel *channel, gboolean streaming_mode, gpointer data) {
+    CSDisplay *self = (__bridge CSDisplay *)data;
+
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+    // spice-gtk only offers us the pipeline through `gst-video-overlay` once
+    // we hand back a window handle here, we have no window so any non-NULL will do
+    if (!streaming_mode || !self.canPresentOverlay) {
+        return NULL;
+    }
+    return data;
+}
+
 static gboolean cs_set_overlay(SpiceChannel *channel, void* pipeline_ptr, gpointer data) {
-    //FIXME: implement overlay
-    //CSDisplay *self = (__bridge CSDisplay *)data;
-    return false;
+    CSDisplay *self = (__bridge CSDisplay *)data;
+
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+    if (!self.canPresentOverlay) {
+        // let spice-gtk decode into the surface as usual
+        return false;
+    }
+    CSDisplayOverlay *overlay = [[CSDisplayOverlay alloc] initWithDisplay:self device:self.device];
+    GstElement *sink = [overlay createVideoSink];
+    if (!sink) {
+        return false;
+    }
+    SPICE_DEBUG("[CocoaSpice] presenting video stream as an overlay");
+    // playbin sinks the floating reference
+    g_object_set(pipeline_ptr, "video-sink", sink, NULL);
+    self.overlay = overlay;
+    return true;
+}
+
+/// Id of a head from its channel and the id the channel's monitor config gives it
+///
+/// Heads of the first channel keep their id, and the first head of every other channel
+/// takes the channel id, as spice-gtk does. Any further head of another channel cannot be
+/// told apart by SPICE, so it is numbered past every id SPICE uses rather than into the
+/// next channel's, see `cs_monitor_id_is_addressable`.
+static NSInteger cs_monitor_id(NSInteger channelID, guint headID) {
+    if (channelID == 0 || headID == 0) {
+        return channelID + headID;
+    }
+    return kCSDisplayMaxMonitors * channelID + headID;
+}
+
+/// True if SPICE can address the head, only those can be resized or enabled
+static BOOL cs_monitor_id_is_addressable(NSInteger monitorID) {
+    return monitorID >= 0 && monitorID < kCSDisplayMaxMonitors;
 }
 
 static void cs_update_monitor_area(SpiceChannel *channel, GParamSpec *pspec, gpointer data) {
     CSDisplay *self = (__bridge CSDisplay *)data;
-    SpiceDisplayMonitorConfig *cfg, *c = NULL;
+    SpiceDisplayMonitorConfig *c = NULL;
     GArray *monitors = NULL;
-    int i;
 
     g_assert(CSMain.sharedInstance.isCurrentContextMain);
     SPICE_DEBUG("[CocoaSpice] update monitor area");
@@ -154,14 +343,6 @@ static void cs_update_monitor_area(SpiceChannel *channel, GParamSpec *pspec, gpo
         goto whole;
     
     g_object_get(self.channel, "monitors", &monitors, NULL);
-    //for (i = 0; monitors != NULL && i < monitors->len; i++) {
-    //    cfg = &g_array_index(monitors, SpiceDisplayMonitorConfig, i);
-    //    if (cfg->id == self.monitorID) {
-    //        c = cfg;
-    //        break;
-    //    }
-    //}
-    g_assert(monitors->len <= 1);
     if (monitors->len == 0) {
         SPICE_DEBUG("[CocoaSpice] update monitor: no monitor %d", (int)self.monitorID);
         self.ready = NO;
@@ -185,7 +366,19 @@ static void cs_update_monitor_area(SpiceChannel *channel, GParamSpec *pspec, gpo
     if (monitors->len == 1 && !self.isGLEnabled) {
         [self updateVisibleAreaWithRect:CGRectMake(0, 0, c->width, c->height)];
     } else {
-        [self updateVisibleAreaWithRect:CGRectMake(c->x, c->y, c->width, c->height)];
+        CGRect areas[monitors->len];
+        NSInteger ids[monitors->len];
+        NSUInteger count = 0;
+        for (guint i = 0; i < monitors->len; i++) {
+            SpiceDisplayMonitorConfig *cfg = &g_array_index(monitors, SpiceDisplayMonitorConfig, i);
+            if (cfg->surface_id != 0) {
+                continue;
+            }
+            areas[count] = CGRectMake(cfg->x, cfg->y, cfg->width, cfg->height);
+            ids[count] = cs_monitor_id(self.channelID, cfg->id);
+            count++;
+        }
+        [self updateMonitorAreas:areas monitorIDs:ids count:count];
     }
     g_clear_pointer(&monitors, g_array_unref);
     return;
@@ -214,6 +407,7 @@ static void cs_gl_scanout(SpiceDisplayChannel *channel, GParamSpec *pspec, gpoin
     self.isGLEnabled = YES;
 
     [self rebuildScanoutTextureWithScanout:*scanout];
+    [self invalidateThumbnailRect:self.monitorArea];
 }
 
 static void cs_gl_draw(SpiceDisplayChannel *channel,
@@ -226,6 +420,10 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     SPICE_DEBUG("[CocoaSpice] %s",  __FUNCTION__);
 
     g_assert(self.isGLEnabled);
+    uint64_t received = cs_display_statistics_now();
+    self->_glDrawReceivedAt = received;
+    [self.statistics recordFrameReceived];
+    [self invalidateThumbnailRect:CGRectMake(x, y, w, h)];
     [self copyScanoutRect:CGRectMake(x, y, w, h) withCompletion:^{
         // `copyScanoutRect:withCompletion:` runs us on the SPICE context thread,
         // which is both where SPICE calls have to be made and where the
@@ -233,11 +431,310 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         g_assert(CSMain.sharedInstance.isCurrentContextMain);
         // the scanout surface is ours no longer, release the server first
         spice_display_channel_gl_draw_done(channel);
+        [self.statistics recordLatency:kCSDisplayLatencyDrawDone since:received];
+        if (self->_glPresentsPending > 0) {
+            // the renderer draws at most once a refresh, this may share it
+            [self.statistics recordFrameMerged];
+        }
+        self->_glPresentsPending++;
+        // the shadow copy is done, so this records the frame being presented
+        [self.recorder invalidate];
         // present the copy whenever the display is next ready
-        [self invalidate];
+        uint64_t presented = self->_shadowPresentedFrame;
+        [self invalidateWithCompletion:^{
+            [self.statistics recordFramePresentedSince:received];
+            [CSMain.sharedInstance asyncWith:^{
+                self->_glPresentsPending--;
+                [self releaseShadowTexturesReplacedBy:presented];
+            }];
+        }];
     }];
 }
 
+#pragma mark - Thumbnail
+
+// How long damage collects before the thumbnail is redrawn, in milliseconds
+static const guint kCSDisplayThumbnailInterval = 250;
+
+static gboolean cs_thumbnail_refresh(gpointer data) {
+    CSDisplay *self = (__bridge CSDisplay *)data;
+    // we are the last reference once this returns
+    g_source_unref(self->_thumbnailTimer);
+    self->_thumbnailTimer = NULL;
+    [self drawThumbnail];
+    return G_SOURCE_REMOVE;
+}
+
+/// Must be called on the SPICE thread
+///
+/// Replaces the thumbnail when its width or the monitor area changed, and redraws it whole.
+- (void)rebuildThumbnail {
+    NSUInteger width = self.thumbnailWidth;
+    CGRect area = self.monitorArea;
+    CSDisplayThumbnail *thumbnail = self.thumbnail;
+    if (width == 0 || CGRectIsEmpty(area)) {
+        [self stopThumbnailTimer];
+        self.thumbnail = nil;
+        return;
+    }
+    if (!thumbnail || thumbnail.width != MIN(width, area.size.width) || !CGSizeEqualToSize(thumbnail.sourceSize, area.size)) {
+        self.thumbnail = [[CSDisplayThumbnail alloc] initWithMaximumWidth:width
+                                                               sourceSize:area.size
+                                                               generation:++_thumbnailLastGeneration];
+    }
+    [self invalidateThumbnailRect:area];
+}
+
+/// Must be called on the SPICE thread
+///
+/// Damage is only collected here, `drawThumbnail` samples all of it at once a little later.
+- (void)invalidateThumbnailRect:(CGRect)rect {
+    if (!self.thumbnail) {
+        return;
+    }
+    _thumbnailDirty = CGRectUnion(_thumbnailDirty, rect);
+    if (!_thumbnailTimer) {
+        _thumbnailTimer = g_timeout_source_new(kCSDisplayThumbnailInterval);
+        g_source_set_callback(_thumbnailTimer, cs_thumbnail_refresh, (__bridge void *)self, NULL);
+        g_source_attach(_thumbnailTimer, CSMain.sharedInstance.glibMainContext);
+    }
+}
+
+/// Must be called on the SPICE thread
+- (void)stopThumbnailTimer {
+    if (_thumbnailTimer) {
+        g_source_destroy(_thumbnailTimer);
+        g_source_unref(_thumbnailTimer);
+        _thumbnailTimer = NULL;
+    }
+    _thumbnailDirty = CGRectNull;
+}
+
+/// Must be called on the SPICE thread
+///
+/// Samples the canvas, or in GL mode the scanout surface. The server may already be drawing
+/// the next frame into the surface, but any part of it we catch half drawn comes with damage
+/// of its own and is sampled again.
+- (void)drawThumbnail {
+    CSDisplayThumbnail *thumbnail = self.thumbnail;
+    CGRect area = self.monitorArea;
+    CGRect dirty = CGRectIntersection(_thumbnailDirty, area);
+    _thumbnailDirty = CGRectNull;
+    if (!thumbnail || CGRectIsEmpty(dirty)) {
+        return;
+    }
+    IOSurfaceRef surface = NULL;
+    const uint8_t *pixels = NULL;
+    size_t bytesPerRow = 0;
+    size_t pixelSize = 4;
+    CSDownscaleSource format = kCSDownscaleSourceBGRX8;
+    if (self.isGLEnabled) {
+        surface = self.glTexture.iosurface;
+        if (!surface || IOSurfaceLock(surface, kIOSurfaceLockReadOnly, NULL) != KERN_SUCCESS) {
+            return;
+        }
+        pixels = IOSurfaceGetBaseAddress(surface);
+        bytesPerRow = IOSurfaceGetBytesPerRow(surface);
+        if (IOSurfaceGetPixelFormat(surface) == 'RGBA') {
+            format = kCSDownscaleSourceRGBX8;
+        }
+    } else {
+        pixels = self.canvasData;
+        bytesPerRow = self.canvasStride;
+        if (self.canvasFormat == SPICE_SURFACE_FMT_16_555) {
+            format = kCSDownscaleSourceXRGB1555;
+            pixelSize = 2;
+        }
+    }
+    if (pixels) {
+        // the thumbnail is of the monitor area alone
+        pixels += (size_t)area.origin.y * bytesPerRow + (size_t)area.origin.x * pixelSize;
+        [thumbnail drawRect:CGRectOffset(dirty, -area.origin.x, -area.origin.y)
+                 fromPixels:pixels
+                bytesPerRow:bytesPerRow
+                     format:format
+                 generation:++_thumbnailLastGeneration];
+    }
+    if (surface) {
+        IOSurfaceUnlock(surface, kIOSurfaceLockReadOnly, NULL);
+    }
+}
+
+#pragma mark - Encoding
+
+// How often the display channel throughput is sampled with `automaticEncoding` on, in milliseconds
+static const guint kCSDisplayEncodingSampleInterval = 2000;
+// Share of the best throughput kept each sample, so a quiet screen only slowly lowers the estimate
+static const double kCSDisplayEncodingBandwidthDecay = 0.9;
+// Bandwidth in bytes per second at which bitrate and decode cost weigh the same
+static const double kCSDisplayEncodingReferenceBandwidth = 2 * 1024 * 1024;
+// Bandwidth above which the cheap decode of LZ4 is worth its worse ratio
+static const double kCSDisplayEncodingFastBandwidth = 8 * 1024 * 1024;
+// Bandwidth assumed before anything was measured, so bytes are never weighed infinitely
+static const double kCSDisplayEncodingMinimumBandwidth = 64 * 1024;
+// Decoding in hardware costs about this share of decoding in software
+static const double kCSDisplayEncodingHardwareDecodeCost = 0.25;
+
+typedef struct {
+    CSDisplayVideoCodec codec;
+    // Bytes for the same quality, relative to VP9
+    double bitrate;
+    // CPU time per frame in software, relative to MJPEG
+    double decodeCost;
+    const char *decoder;
+    const char *hardwareDecoder;
+    // Stream caps the decoders must accept
+    const char *caps;
+    // Codec VideoToolbox must decode in hardware for `hardwareDecoder` to count, 0 if none
+    CMVideoCodecType hardwareCodecType;
+} CSDisplayCodecCost;
+
+static const CSDisplayCodecCost kCSDisplayCodecCosts[] = {
+    { kCSDisplayVideoCodecMJPEG, 4.0, 1.0, "jpegdec", NULL, "image/jpeg", 0 },
+    { kCSDisplayVideoCodecVP8, 1.6, 1.5, "vp8dec", NULL, "video/x-vp8", 0 },
+    { kCSDisplayVideoCodecH264, 1.3, 2.0, "avdec_h264", "vtdec_hw", "video/x-h264", kCMVideoCodecType_H264 },
+    { kCSDisplayVideoCodecVP9, 1.0, 3.0, "vp9dec", NULL, "video/x-vp9", 0 },
+    { kCSDisplayVideoCodecH265, 0.9, 4.0, "avdec_h265", "vtdec_hw", "video/x-h265", kCMVideoCodecType_HEVC },
+};
+
+/// True if an element named `name` exists and takes the stream `caps`
+///
+/// `vtdec_hw` serves several codecs, depending on the GStreamer build, so its name alone
+/// does not say which.
+static gboolean cs_has_decoder(const char *name, const char *caps) {
+    GstElementFactory *factory = name ? gst_element_factory_find(name) : NULL;
+    if (!factory) {
+        return FALSE;
+    }
+    GstCaps *sinkCaps = gst_caps_from_string(caps);
+    gboolean result = gst_element_factory_can_sink_any_caps(factory, sinkCaps);
+    gst_caps_unref(sinkCaps);
+    gst_object_unref(factory);
+    return result;
+}
+
+/// True if `cost` can be decoded in hardware on this device
+static gboolean cs_has_hardware_decoder(const CSDisplayCodecCost *cost) {
+    if (!cost->hardwareCodecType || !VTIsHardwareDecodeSupported(cost->hardwareCodecType)) {
+        return FALSE;
+    }
+    return cs_has_decoder(cost->hardwareDecoder, cost->caps);
+}
+
+static gboolean cs_encoding_sample(gpointer data) {
+    CSDisplay *self = (__bridge CSDisplay *)data;
+    uint64_t now = cs_display_statistics_now();
+    gulong readBytes = 0;
+
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+    g_object_get(self.channel, "total-read-bytes", &readBytes, NULL);
+    // the counter starts over when the channel reconnects
+    if (self->_encodingLastSampleAt != 0 && readBytes >= self->_encodingLastReadBytes) {
+        double seconds = (now - self->_encodingLastSampleAt) / (double)NSEC_PER_SEC;
+        double bandwidth = (readBytes - self->_encodingLastReadBytes) / seconds;
+        self.measuredBandwidth = MAX(bandwidth, self.measuredBandwidth * kCSDisplayEncodingBandwidthDecay);
+    }
+    self->_encodingLastReadBytes = readBytes;
+    self->_encodingLastSampleAt = now;
+    [self chooseEncodingForBandwidth:self.measuredBandwidth];
+    return G_SOURCE_CONTINUE;
+}
+
+/// Must be called on the SPICE thread
+- (void)startEncodingTimer {
+    if (_encodingTimer) {
+        return;
+    }
+    _encodingLastSampleAt = 0;
+    _encodingTimer = g_timeout_source_new(kCSDisplayEncodingSampleInterval);
+    g_source_set_callback(_encodingTimer, cs_encoding_sample, (__bridge void *)self, NULL);
+    g_source_attach(_encodingTimer, CSMain.sharedInstance.glibMainContext);
+    // start from the last estimate rather than the server default
+    cs_encoding_sample((__bridge void *)self);
+}
+
+/// Must be called on the SPICE thread
+- (void)stopEncodingTimer {
+    if (_encodingTimer) {
+        g_source_destroy(_encodingTimer);
+        g_source_unref(_encodingTimer);
+        _encodingTimer = NULL;
+    }
+}
+
+/// Orders the codecs we can decode by decode cost plus bitrate, the bitrate weighing
+/// more the slower the link.
++ (NSArray<NSNumber *> *)videoCodecsForBandwidth:(double)bandwidth {
+    double bytesWeight = kCSDisplayEncodingReferenceBandwidth / MAX(bandwidth, kCSDisplayEncodingMinimumBandwidth);
+    NSMutableDictionary<NSNumber *, NSNumber *> *scores = [NSMutableDictionary dictionary];
+    for (size_t i = 0; i < G_N_ELEMENTS(kCSDisplayCodecCosts); i++) {
+        const CSDisplayCodecCost *cost = &kCSDisplayCodecCosts[i];
+        double decodeCost = cost->decodeCost;
+        if (cs_has_hardware_decoder(cost)) {
+            decodeCost *= kCSDisplayEncodingHardwareDecodeCost;
+        } else if (!cs_has_decoder(cost->decoder, cost->caps)) {
+            continue;
+        }
+        scores[@(cost->codec)] = @(decodeCost + cost->bitrate * bytesWeight);
+    }
+    return [scores keysSortedByValueUsingSelector:@selector(compare:)];
+}
+
++ (CSDisplayImageCompression)imageCompressionForBandwidth:(double)bandwidth {
+    return bandwidth >= kCSDisplayEncodingFastBandwidth ? kCSDisplayImageCompressionLZ4 : kCSDisplayImageCompressionAutoGLZ;
+}
+
+/// Must be called on the SPICE thread
+- (void)chooseEncodingForBandwidth:(double)bandwidth {
+    NSArray<NSNumber *> *codecs = [CSDisplay videoCodecsForBandwidth:bandwidth];
+    CSDisplayImageCompression compression = [CSDisplay imageCompressionForBandwidth:bandwidth];
+    @synchronized (self) {
+        if (!_automaticEncoding) {
+            return;
+        }
+        _preferredImageCompression = compression;
+        _preferredVideoCodecs = codecs;
+    }
+    [self sendEncodingPreferences];
+}
+
+/// Must be called on the SPICE thread
+///
+/// Does nothing until the server has told us it takes preferences, `cs_primary_create` tries again.
+- (void)sendEncodingPreferences {
+    SpiceChannel *channel = self.spiceChannel;
+    CSDisplayImageCompression compression;
+    NSArray<NSNumber *> *codecs;
+
+    @synchronized (self) {
+        compression = _preferredImageCompression;
+        codecs = _preferredVideoCodecs;
+    }
+    if (compression != kCSDisplayImageCompressionDefault && compression != _sentImageCompression &&
+        spice_channel_test_capability(channel, SPICE_DISPLAY_CAP_PREF_COMPRESSION)) {
+        SPICE_DEBUG("[CocoaSpice] preferring image compression %ld", (long)compression);
+        spice_display_channel_change_preferred_compression(channel, (gint)compression);
+        _sentImageCompression = compression;
+    }
+    if (codecs.count > 0 && ![codecs isEqualToArray:_sentVideoCodecs] &&
+        spice_channel_test_capability(channel, SPICE_DISPLAY_CAP_PREF_VIDEO_CODEC_TYPE)) {
+        gint types[SPICE_VIDEO_CODEC_TYPE_ENUM_END];
+        gsize count = 0;
+        GError *err = NULL;
+        for (NSNumber *codec in codecs) {
+            if (count < G_N_ELEMENTS(types)) {
+                types[count++] = codec.intValue;
+            }
+        }
+        if (spice_display_channel_change_preferred_video_codec_types(channel, types, count, &err)) {
+            _sentVideoCodecs = codecs;
+        } else {
+            SPICE_DEBUG("[CocoaSpice] failed to set preferred video codecs: %s", err ? err->message : "unknown error");
+            g_clear_error(&err);
+        }
+    }
+}
+
 #pragma mark - Properties
 
 - (void)setDevice:(id<MTLDevice>)device {
@@ -246,9 +743,13 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     }
     [CSMain.sharedInstance asyncWith:^{
         _device = device;
-        // the shadow buffer belongs to the old device
-        self.shadowTexture = nil;
-        self.presentTexture = nil;
+        // the shadow ring and wrapped scanouts belong to the old device
+        [self discardShadowTextures];
+        self.shadowCopyQueue = nil;
+        if (@available(iOS 12, macOS 10.14, *)) {
+            self.shadowCopyEvent = nil;
+        }
+        [self.scanoutCache removeAllObjects];
         if (self.isGLEnabled) {
             if (self.delayedScanoutSurface) {
                 [self rebuildScanoutTextureWithSurface:self.delayedScanoutSurface width:self.delayedScanoutInfo.width height:self.delayedScanoutInfo.height];
@@ -276,56 +777,173 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     return SPICE_CHANNEL(self.channel);
 }
 
+- (BOOL)canPresentOverlay {
+    return !self.isGLEnabled && self.device != nil;
+}
+
+/// Copy the current frame into a readback buffer
+///
+/// Only the copy happens on the SPICE thread: a memcpy of the canvas, or a GPU blit of
+/// the texture we present. `completion` runs on the readback queue and owns the buffer,
+/// which is nil on failure.
+- (void)captureFrameWithReadback:(CSScreenshotReadback *)readback completion:(captureCallback_t)completion {
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+
+    if (self.canvasData && !self.isGLEnabled && !self.overlayTexture) {
+        NSUInteger width = self.canvasArea.size.width;
+        NSUInteger height = self.canvasArea.size.height;
+        BOOL is555 = self.canvasFormat == SPICE_SURFACE_FMT_16_555;
+        NSUInteger bytesPerRow = is555 ? width * 4 : self.canvasStride;
+        CSScreenshotBuffer *buffer = [readback bufferWithLength:bytesPerRow * height];
+        if (buffer) {
+            if (is555) {
+                cs_convert_xrgb1555_to_bgra8(buffer.bytes, bytesPerRow, self.canvasData, self.canvasStride, width, height);
+            } else {
+                memcpy(buffer.bytes, self.canvasData, bytesPerRow * height);
+            }
+        }
+        dispatch_async(readback.queue, ^{
+            completion(buffer, width, height, bytesPerRow, MTLPixelFormatBGRA8Unorm);
+        });
+    } else if ((self.isGLEnabled || self.overlayTexture) && self.texture) {
+        // sample what we present rather than the scanout itself, which the
+        // server is free to overwrite as soon as a draw is acknowledged
+        id<MTLTexture> texture = self.texture;
+        NSUInteger bytesPerRow = texture.width * 4;
+        CSScreenshotBuffer *buffer = [readback bufferWithLength:bytesPerRow * texture.height];
+        id<MTLBuffer> metalBuffer = [buffer metalBufferForDevice:texture.device];
+        id<MTLCommandQueue> queue = self.renderers.firstObject.commandQueue ?: [readback commandQueueForDevice:texture.device];
+        id<MTLCommandBuffer> commandBuffer = metalBuffer ? [queue commandBuffer] : nil;
+        if (@available(iOS 12, macOS 10.14, *)) {
+            // a shadow copy may still be writing the texture, from either queue, and it is
+            // committed already as both happen on this thread
+            if (self.isGLEnabled && self.shadowCopyEvent && _shadowCopyEventValue) {
+                [commandBuffer encodeWaitForEvent:self.shadowCopyEvent value:_shadowCopyEventValue];
+            }
+        }
+        id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+        if (!blitEncoder) {
+            [buffer recycle];
+            dispatch_async(readback.queue, ^{
+                completion(nil, 0, 0, 0, MTLPixelFormatInvalid);
+            });
+            return;
+        }
+        commandBuffer.label = @"Screenshot Readback";
+        [blitEncoder copyFromTexture:texture
+                         sourceSlice:0
+                         sourceLevel:0
+                        sourceOrigin:MTLOriginMake(0, 0, 0)
+                          sourceSize:MTLSizeMake(texture.width, texture.height, 1)
+                            toBuffer:metalBuffer
+                   destinationOffset:0
+              destinationBytesPerRow:bytesPerRow
+            destinationBytesPerImage:bytesPerRow * texture.height];
+        [blitEncoder endEncoding];
+        [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
+            BOOL succeeded = commandBuffer.error == nil;
+            dispatch_async(readback.queue, ^{
+                if (succeeded) {
+                    completion(buffer, texture.width, texture.height, bytesPerRow, texture.pixelFormat);
+                } else {
+                    [buffer recycle];
+                    completion(nil, 0, 0, 0, MTLPixelFormatInvalid);
+                }
+            });
+        }];
+        [commandBuffer commit];
+    } else {
+        dispatch_async(readback.queue, ^{
+            completion(nil, 0, 0, 0, MTLPixelFormatInvalid);
+        });
+    }
+}
+
+/// Copy the current frame and make an image of it
+///
+/// The image is made on the readback queue without another copy, and `completion` runs
+/// there, with NULL on failure.
+- (void)captureWithCompletion:(void (^)(CGImageRef _Nullable))completion {
+    [self captureFrameWithReadback:self.screenshotReadback completion:^(CSScreenshotBuffer *buffer, NSUInteger width, NSUInteger height, NSUInteger bytesPerRow, MTLPixelFormat pixelFormat) {
+        // the scanout carries no meaningful alpha, the image skips it
+        CGImageRef img = [buffer createImageWithWidth:width height:height bytesPerRow:bytesPerRow pixelFormat:pixelFormat];
+        if (!img) {
+            [buffer recycle];
+        }
+        completion(img);
+        CGImageRelease(img);
+    }];
+}
+
 - (void)screenshotWithCompletion:(screenshotCallback_t)completion {
     [CSMain.sharedInstance asyncWith:^{
-        CGImageRef img = NULL;
-
-        if (self.canvasData && !self.isGLEnabled) {
-            CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
-            CGDataProviderRef dataProviderRef = CGDataProviderCreateWithData(NULL,
-                                                                             self.canvasData,
-                                                                             self.canvasStride * self.canvasArea.size.height,
-                                                                             nil);
-            img = CGImageCreate(self.canvasArea.size.width,
-                                self.canvasArea.size.height,
-                                8,
-                                32,
-                                self.canvasStride,
-                                colorSpaceRef,
-                                kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst,
-                                dataProviderRef,
-                                NULL,
-                                NO,
-                                kCGRenderingIntentDefault);
-            CGDataProviderRelease(dataProviderRef);
-            CGColorSpaceRelease(colorSpaceRef);
-        } else if (self.isGLEnabled && self.texture) {
-            // sample what we present rather than the scanout itself, which the
-            // server is free to overwrite as soon as a draw is acknowledged
-            CIImage *ciimage = [[CIImage alloc] initWithMTLTexture:self.texture options:nil];
-            // the scanout carries no meaningful alpha -- it is zero for every
-            // pixel and the shader ignores it (`hasAlpha` is NO), so without
-            // this the image reads as fully transparent
-            ciimage = [ciimage imageBySettingAlphaOneInExtent:ciimage.extent];
-            CIImage *flipped = [ciimage imageByApplyingOrientation:kCGImagePropertyOrientationDownMirrored];
-            CIContext *cictx = self.device ? [CIContext contextWithMTLDevice:self.device] : [CIContext context];
-            img = [cictx createCGImage:flipped fromRect:flipped.extent];
-        }
-
-        if (img) {
-#if TARGET_OS_IPHONE
-            UIImage *uiimg = [UIImage imageWithCGImage:img];
-#else
-            NSImage *uiimg = [[NSImage alloc] initWithCGImage:img size:NSZeroSize];
-#endif
-            CGImageRelease(img);
-            completion([[CSScreenshot alloc] initWithImage:uiimg]);
-        } else {
+        [self captureWithCompletion:^(CGImageRef img) {
+            completion(img ? [[CSScreenshot alloc] initWithCGImage:img] : nil);
+        }];
+    }];
+}
+
+- (void)screenshotDataWithFormat:(CSScreenshotFormat)format quality:(CGFloat)quality completion:(void (^)(NSData * _Nullable))completion {
+    [self screenshotWithCompletion:^(CSScreenshot *screenshot) {
+        completion([screenshot dataWithFormat:format quality:quality]);
+    }];
+}
+
+- (void)writeScreenshotToURL:(NSURL *)url format:(CSScreenshotFormat)format quality:(CGFloat)quality completion:(void (^)(BOOL))completion {
+    [self screenshotWithCompletion:^(CSScreenshot *screenshot) {
+        completion([screenshot writeToURL:url format:format quality:quality]);
+    }];
+}
+
+- (void)startRecordingToURL:(NSURL *)url completion:(recordingCallback_t)completion {
+    [CSMain.sharedInstance asyncWith:^{
+        if (self.recorder) {
+            completion([NSError errorWithDomain:kCSDisplayRecorderDomain code:-1 userInfo:@{NSLocalizedDescriptionKey: @"The display is already being recorded."}]);
+            return;
+        }
+        CSDisplayRecorder *recorder = [[CSDisplayRecorder alloc] initWithDisplay:self url:url];
+        NSError *error = nil;
+        if (![recorder startWithError:&error]) {
+            completion(error);
+            return;
+        }
+        self.recorder = recorder;
+        // start on what is on screen rather than waiting for it to change
+        [recorder invalidate];
+        completion(nil);
+    }];
+}
+
+- (void)stopRecordingWithCompletion:(recordingCallback_t)completion {
+    [CSMain.sharedInstance asyncWith:^{
+        CSDisplayRecorder *recorder = self.recorder;
+        if (!recorder) {
             completion(nil);
+            return;
         }
+        self.recorder = nil;
+        [recorder finishWithCompletion:completion];
     }];
 }
 
+- (BOOL)isRecording {
+    return self.recorder != nil;
+}
+
+- (uint64_t)recordingDroppedFrameCount {
+    return self.recorder.droppedFrameCount;
+}
+
+- (CSScreenshot *)thumbnailWithGeneration:(uint64_t *)generation {
+    CGImageRef img = [self.thumbnail copyImageWithGeneration:generation];
+    if (!img) {
+        return nil;
+    }
+    CSScreenshot *thumbnail = [[CSScreenshot alloc] initWithCGImage:img];
+    CGImageRelease(img);
+    return thumbnail;
+}
+
 - (id<MTLTexture>)texture {
     if (self.isGLEnabled) {
         // present the shadow copy once we have one, see
@@ -333,7 +951,9 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         id<MTLTexture> presentTexture = self.presentTexture;
         return presentTexture ?: self.glTexture;
     } else {
-        return self.canvasTexture;
+        // a video stream covering the whole surface skips the canvas entirely
+        id<MTLTexture> overlayTexture = self.overlayTexture;
+        return overlayTexture ?: self.canvasTexture;
     }
 }
 
@@ -385,6 +1005,114 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     return CGPointZero;
 }
 
+- (NSInteger)canvasPixelSize {
+    return (self.canvasFormat == SPICE_SURFACE_FMT_32_xRGB) ? 4 : 2;
+}
+
+- (uint64_t)canvasBytesDamaged {
+    return _canvasDirtyRegion.damagedPixels * self.canvasPixelSize;
+}
+
+- (uint64_t)canvasBytesUploaded {
+    return _canvasDirtyRegion.uploadedPixels * self.canvasPixelSize;
+}
+
+- (NSUInteger)maxCanvasUploadsInFlight {
+    @synchronized (self) {
+        return _maxCanvasUploadsInFlight;
+    }
+}
+
+- (void)setMaxCanvasUploadsInFlight:(NSUInteger)maxCanvasUploadsInFlight {
+    @synchronized (self) {
+        _maxCanvasUploadsInFlight = MAX(1, MIN(maxCanvasUploadsInFlight, kCSDisplayMaxCanvasUploadsInFlight));
+    }
+}
+
+- (CSDisplayImageCompression)preferredImageCompression {
+    @synchronized (self) {
+        return _preferredImageCompression;
+    }
+}
+
+- (void)setPreferredImageCompression:(CSDisplayImageCompression)preferredImageCompression {
+    self.automaticEncoding = NO;
+    @synchronized (self) {
+        _preferredImageCompression = preferredImageCompression;
+    }
+    [CSMain.sharedInstance asyncWith:^{
+        [self sendEncodingPreferences];
+    }];
+}
+
+- (NSArray<NSNumber *> *)preferredVideoCodecs {
+    @synchronized (self) {
+        return _preferredVideoCodecs;
+    }
+}
+
+- (void)setPreferredVideoCodecs:(NSArray<NSNumber *> *)preferredVideoCodecs {
+    self.automaticEncoding = NO;
+    @synchronized (self) {
+        _preferredVideoCodecs = [preferredVideoCodecs copy];
+    }
+    [CSMain.sharedInstance asyncWith:^{
+        [self sendEncodingPreferences];
+    }];
+}
+
+- (BOOL)automaticEncoding {
+    @synchronized (self) {
+        return _automaticEncoding;
+    }
+}
+
+- (void)setAutomaticEncoding:(BOOL)automaticEncoding {
+    @synchronized (self) {
+        if (_automaticEncoding == automaticEncoding) {
+            return;
+        }
+        _automaticEncoding = automaticEncoding;
+    }
+    [CSMain.sharedInstance asyncWith:^{
+        if (automaticEncoding) {
+            [self startEncodingTimer];
+        } else {
+            [self stopEncodingTimer];
+        }
+    }];
+}
+
+- (NSUInteger)thumbnailWidth {
+    @synchronized (self) {
+        return _thumbnailWidth;
+    }
+}
+
+- (void)setThumbnailWidth:(NSUInteger)thumbnailWidth {
+    @synchronized (self) {
+        if (_thumbnailWidth == thumbnailWidth) {
+            return;
+        }
+        _thumbnailWidth = thumbnailWidth;
+    }
+    [CSMain.sharedInstance asyncWith:^{
+        [self rebuildThumbnail];
+    }];
+}
+
+- (uint64_t)thumbnailGeneration {
+    return self.thumbnail.generation;
+}
+
+- (NSArray<NSNumber *> *)canvasUploadsInFlightHistogram {
+    NSMutableArray<NSNumber *> *histogram = [NSMutableArray arrayWithCapacity:kCSDisplayMaxCanvasUploadsInFlight];
+    for (NSUInteger i = 1; i <= kCSDisplayMaxCanvasUploadsInFlight; i++) {
+        [histogram addObject:@(_canvasUploadsInFlightHistogram[i])];
+    }
+    return histogram;
+}
+
 #pragma mark - Methods
 
 - (instancetype)initWithChannel:(SpiceDisplayChannel *)channel {
@@ -393,6 +1121,15 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         self.channel = g_object_ref(channel);
         self.monitorID = self.channelID;
         self.renderers = [NSMutableArray array];
+        self.secondaryMonitors = @[];
+        cs_region_init(&_canvasDirtyRegion);
+        _maxCanvasUploadsInFlight = 2;
+        _statistics = [[CSDisplayStatistics alloc] init];
+        _preferredVideoCodecs = @[];
+        _screenshotReadback = [[CSScreenshotReadback alloc] init];
+        _thumbnailDirty = CGRectNull;
+        _shadowPresented = -1;
+        _scanoutCache = [NSMutableArray arrayWithCapacity:kCSDisplayScanoutCacheSize];
         SPICE_DEBUG("[CocoaSpice] %s:%d", __FUNCTION__, __LINE__);
         g_signal_connect(channel, "display-primary-create",
                          G_CALLBACK(cs_primary_create), (__bridge void *)self);
@@ -404,6 +1141,8 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
                          G_CALLBACK(cs_mark), (__bridge void *)self);
         g_signal_connect(channel, "notify::monitors",
                          G_CALLBACK(cs_update_monitor_area), (__bridge void *)self);
+        g_signal_connect(channel, "streaming-mode",
+                         G_CALLBACK(cs_streaming_mode), (__bridge void *)self);
         g_signal_connect(channel, "gst-video-overlay",
                          G_CALLBACK(cs_set_overlay), (__bridge void *)self);
         g_signal_connect(channel, "notify::gl-scanout",
@@ -423,12 +1162,23 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     SPICE_DEBUG("[CocoaSpice] %s:%d", __FUNCTION__, __LINE__);
     SpiceDisplayChannel *channel = self.channel;
     gpointer data = (__bridge void *)self;
+    GSource *encodingTimer = _encodingTimer;
+    GSource *thumbnailTimer = _thumbnailTimer;
     [CSMain.sharedInstance syncWith:^{
+        if (encodingTimer) {
+            g_source_destroy(encodingTimer);
+            g_source_unref(encodingTimer);
+        }
+        if (thumbnailTimer) {
+            g_source_destroy(thumbnailTimer);
+            g_source_unref(thumbnailTimer);
+        }
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_primary_create), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_primary_destroy), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_invalidate), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_mark), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_update_monitor_area), data);
+        g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_streaming_mode), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_set_overlay), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_gl_scanout), data);
         g_signal_handlers_disconnect_by_func(channel, G_CALLBACK(cs_gl_draw), data);
@@ -437,23 +1187,76 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
 }
 
 - (void)updateVisibleAreaWithRect:(CGRect)rect {
+    NSInteger monitorID = self.monitorID;
+    [self updateMonitorAreas:&rect monitorIDs:&monitorID count:1];
+}
+
+/// Show the first area on this display and the others on `secondaryMonitors`
+///
+/// The texture covers all of them, so the canvas is uploaded once for every head.
+- (void)updateMonitorAreas:(const CGRect *)areas monitorIDs:(const NSInteger *)monitorIDs count:(NSUInteger)count {
     CGRect primary = self.canvasArea;
-    CGRect visible = CGRectIntersection(primary, rect);
+    CGRect visible = count > 0 ? CGRectIntersection(primary, areas[0]) : CGRectNull;
+    NSMutableArray<CSDisplayMonitor *> *secondaryMonitors = [NSMutableArray array];
     if (CGRectIsNull(visible)) {
         SPICE_DEBUG("[CocoaSpice] The monitor area is not intersecting primary surface");
         self.ready = NO;
         self.visibleArea = CGRectZero;
+        self.monitorArea = CGRectZero;
     } else {
+        self.monitorArea = visible;
+        for (NSUInteger i = 1; i < count; i++) {
+            CGRect area = CGRectIntersection(primary, areas[i]);
+            if (CGRectIsNull(area)) {
+                continue;
+            }
+            visible = CGRectUnion(visible, area);
+            // keep the objects callers already know about
+            CSDisplayMonitor *monitor = nil;
+            for (CSDisplayMonitor *candidate in self.secondaryMonitors) {
+                if (candidate.monitorID == monitorIDs[i]) {
+                    monitor = candidate;
+                    break;
+                }
+            }
+            if (!monitor) {
+                monitor = [[CSDisplayMonitor alloc] initWithDisplay:self monitorID:monitorIDs[i]];
+            }
+            monitor.area = area;
+            [secondaryMonitors addObject:monitor];
+        }
         self.visibleArea = visible;
     }
-    self.displaySize = self.visibleArea.size;
+    if (![secondaryMonitors isEqualToArray:self.secondaryMonitors]) {
+        for (CSDisplayMonitor *monitor in self.secondaryMonitors) {
+            if ([secondaryMonitors containsObject:monitor]) {
+                continue;
+            }
+            // the head is gone, so its renderers must stop drawing it
+            for (id<CSRenderer> renderer in monitor.renderers) {
+                [renderer disableRender];
+            }
+        }
+        SPICE_DEBUG("[CocoaSpice] display %ld now has %lu more heads", (long)self.monitorID, (unsigned long)secondaryMonitors.count);
+        self.secondaryMonitors = secondaryMonitors;
+    }
+    self.displaySize = self.monitorArea.size;
     if (!self.isGLEnabled) {
         [self rebuildCanvasTexture];
     }
     [self rebuildDisplayVertices];
+    [self rebuildThumbnail];
     self.ready = YES;
 }
 
+/// Present a new scanout
+///
+/// Guests that double or triple buffer flip between a few scanout surfaces, sending
+/// a new scanout for every frame. The surface ID still has to be read from the fd
+/// every time, but the surface lookup and wrapping it in a texture are only done the
+/// first time we see it, after that the wrapper comes from `scanoutCache`. A scanout
+/// of the surface we already present changes nothing, so it does not even force a
+/// full copy into the shadows.
 - (void)rebuildScanoutTextureWithScanout:(SpiceGlScanout)scanout {
     IOSurfaceID iosurfaceid = 0;
     IOSurfaceRef iosurface = NULL;
@@ -477,12 +1280,44 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         perror("read");
         return;
     }
+    NSMutableArray<_CSScanoutTexture *> *cache = self.scanoutCache;
+    _CSScanoutTexture *scanoutTexture = nil;
+    if (self.device) {
+        for (NSUInteger i = 0; i < cache.count; i++) {
+            if ([cache[i] matchesScanout:scanout surfaceID:iosurfaceid device:self.device]) {
+                scanoutTexture = cache[i];
+                [cache removeObjectAtIndex:i];
+                [cache insertObject:scanoutTexture atIndex:0];
+                break;
+            }
+        }
+    }
+    if (scanoutTexture) {
+        if (scanoutTexture.texture == self.glTexture) {
+            // same surface, so the damage that follows builds on what the
+            // shadows hold, which only needs them to still be there
+            [self rebuildShadowTextureWithWidth:scanout.width height:scanout.height];
+        } else {
+            [self presentScanoutTexture:scanoutTexture.texture width:scanout.width height:scanout.height];
+            [self rebuildDisplayVertices];
+        }
+        return;
+    }
     if ((iosurface = IOSurfaceLookup(iosurfaceid)) == NULL) {
         SPICE_DEBUG("[CocoaSpice] Failed to lookup surface: %d", iosurfaceid);
         return;
     }
     if (self.device) {
-        [self rebuildScanoutTextureWithSurface:iosurface width:scanout.width height:scanout.height];
+        id<MTLTexture> texture = [self newScanoutTextureWithSurface:iosurface width:scanout.width height:scanout.height];
+        if (texture) {
+            if (cache.count >= kCSDisplayScanoutCacheSize) {
+                [cache removeLastObject];
+            }
+            [cache insertObject:[[_CSScanoutTexture alloc] initWithTexture:texture surfaceID:iosurfaceid format:scanout.format]
+                        atIndex:0];
+        }
+        CFRelease(iosurface);
+        [self presentScanoutTexture:texture width:scanout.width height:scanout.height];
         [self rebuildDisplayVertices];
     } else {
         // delay until we have a device
@@ -496,8 +1331,7 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
                                                       : MTLPixelFormatBGRA8Unorm;
 }
 
-/// Consumes a +1 reference on `surface`.
-- (void)rebuildScanoutTextureWithSurface:(IOSurfaceRef)surface width:(NSUInteger)width height:(NSUInteger)height {
+- (nullable id<MTLTexture>)newScanoutTextureWithSurface:(IOSurfaceRef)surface width:(NSUInteger)width height:(NSUInteger)height {
     MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
     // The surface carries its own channel order (the host picks it from the
     // guest scanout, which is not always BGRA), so take it from the surface:
@@ -506,29 +1340,46 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     textureDescriptor.width = width;
     textureDescriptor.height = height;
     textureDescriptor.usage = MTLTextureUsageShaderRead;
+    id<MTLTexture> texture = [self.device newTextureWithDescriptor:textureDescriptor iosurface:surface plane:0];
+    if (texture) {
+        self.scanoutTextureCount++;
+    }
+    return texture;
+}
+
+/// Make a wrapped scanout surface the one we copy from
+- (void)presentScanoutTexture:(nullable id<MTLTexture>)texture width:(NSUInteger)width height:(NSUInteger)height {
     self.canvasArea = CGRectMake(0, 0, width, height);
-    self.glTexture = [self.device newTextureWithDescriptor:textureDescriptor iosurface:surface plane:0];
-    CFRelease(surface);
+    self.glTexture = texture;
     [self rebuildShadowTextureWithWidth:width height:height];
     // the damage rects that follow describe changes against the previous
     // scanout, so the first copy out of a new one has to be whole
     self.shadowNeedsFullCopy = YES;
 }
 
-/// Allocate the private texture the scanout is copied into. See
-/// `copyScanoutRect:withCompletion:` for why the copy exists.
+/// Consumes a +1 reference on `surface`.
+- (void)rebuildScanoutTextureWithSurface:(IOSurfaceRef)surface width:(NSUInteger)width height:(NSUInteger)height {
+    id<MTLTexture> texture = [self newScanoutTextureWithSurface:surface width:width height:height];
+    CFRelease(surface);
+    [self presentScanoutTexture:texture width:width height:height];
+}
+
+/// Allocate the private textures the scanout is copied into. See
+/// `copyScanoutRect:withCompletion:` for why the copies exist.
 - (void)rebuildShadowTextureWithWidth:(NSUInteger)width height:(NSUInteger)height {
     MTLPixelFormat format = self.glTexture ? self.glTexture.pixelFormat
                                            : MTLPixelFormatBGRA8Unorm;
-    if (self.shadowTexture.width == width && self.shadowTexture.height == height &&
-        self.shadowTexture.pixelFormat == format) {
-        // the next copy overwrites it in full, so the existing allocation is
-        // still good and what we are presenting stays valid until then
+    id<MTLTexture> existing = self.shadowTextures.firstObject;
+    if (existing.width == width && existing.height == height &&
+        existing.pixelFormat == format) {
+        // the next copies overwrite them in full, so the existing allocations
+        // are still good and what we are presenting stays valid until then
         return;
     }
+    [self discardShadowTextures];
 
     MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
-    // copyScanoutRect blits into this, and a blit cannot convert formats
+    // copyScanoutRect blits into these, and a blit cannot convert formats
     textureDescriptor.pixelFormat = format;
     textureDescriptor.width = width;
     textureDescriptor.height = height;
@@ -537,8 +1388,71 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
 
     // if this fails we present the scanout directly, which is correct but
     // couples the server to our display refresh
-    self.shadowTexture = [self.device newTextureWithDescriptor:textureDescriptor];
+    NSMutableArray<id<MTLTexture>> *shadowTextures = [NSMutableArray arrayWithCapacity:kCSDisplayShadowTextures];
+    for (NSInteger i = 0; i < kCSDisplayShadowTextures; i++) {
+        id<MTLTexture> texture = [self.device newTextureWithDescriptor:textureDescriptor];
+        if (!texture) {
+            return;
+        }
+        [shadowTextures addObject:texture];
+    }
+    if (self.shadowCopyQueue.device != self.device) {
+        self.shadowCopyQueue = [self.device newCommandQueue];
+    }
+    if (@available(iOS 12, macOS 10.14, *)) {
+        if (self.shadowCopyEvent.device != self.device) {
+            self.shadowCopyEvent = [self.device newEvent];
+            self->_shadowCopyEventValue = 0;
+        }
+    }
+    self.shadowTextures = shadowTextures;
+}
+
+/// Forget the shadow ring, copies still in flight into it are dropped when they land
+- (void)discardShadowTextures {
+    self.shadowTextures = nil;
     self.presentTexture = nil;
+    memset(_shadowFrame, 0, sizeof(_shadowFrame));
+    memset(_shadowBusyUntil, 0, sizeof(_shadowBusyUntil));
+    _shadowPresented = -1;
+}
+
+/// Free the shadows that were replaced by a frame no later than `frame`, once the renderer has drawn it
+///
+/// Renderers draw from whatever `presentTexture` was when they were last invalidated, and
+/// nothing else. After an invalidate that picked up `frame` completes, nothing can be
+/// reading a shadow that was presented before it.
+- (void)releaseShadowTexturesReplacedBy:(uint64_t)frame {
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+    for (NSInteger i = 0; i < kCSDisplayShadowTextures; i++) {
+        if (_shadowBusyUntil[i] != UINT64_MAX && _shadowBusyUntil[i] <= frame) {
+            _shadowBusyUntil[i] = 0;
+        }
+    }
+}
+
+/// Free shadow holding the most recent frame, so it has the least to catch up on
+/// @returns Index into `shadowTextures`, or -1 if every one is in use
+- (NSInteger)freeShadowTexture {
+    NSInteger best = -1;
+    for (NSInteger i = 0; i < self.shadowTextures.count; i++) {
+        if (_shadowBusyUntil[i] == 0 && (best < 0 || _shadowFrame[i] > _shadowFrame[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/// Everything that changed in the scanout after `since` up to and including `frame`
+- (CGRect)shadowDamageSince:(uint64_t)since frame:(uint64_t)frame bounds:(CGRect)bounds {
+    if (since == 0 || since > frame || frame - since > kCSDisplayShadowDamageHistory) {
+        return bounds;
+    }
+    CGRect damaged = CGRectNull;
+    for (uint64_t i = since + 1; i <= frame; i++) {
+        damaged = CGRectUnion(damaged, _shadowDamage[i % kCSDisplayShadowDamageHistory]);
+    }
+    return CGRectIntersection(damaged, bounds);
 }
 
 /// Copy the shared scanout surface into a texture we own, and report when that
@@ -552,26 +1466,49 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
 /// under a millisecond and present from the copy whenever the display is next
 /// ready, which is both tear free and decoupled from vsync.
 ///
-/// A single shadow is enough because the copy is submitted on the renderer's
-/// own queue: command buffers on a queue execute in the order they were
-/// committed, so a copy can never overwrite the texture while a render pass
-/// submitted before it is still reading.
+/// The copy goes into a ring of shadows on a queue of its own, into one the
+/// renderer is not drawing from, so it never waits behind a render pass. A
+/// shadow stays in use from the copy into it until the renderer has drawn the
+/// frame that replaced it, see `releaseShadowTexturesReplacedBy:`. Should every
+/// shadow still be in use, the copy goes into the presented one on the
+/// renderer's queue instead: command buffers on a queue execute in the order
+/// they were committed, so it cannot overwrite the texture while a render pass
+/// submitted before it is still reading, but it does wait for that pass.
 ///
-/// Only `rect` is copied: the shadow keeps the previous frame, and `gl_draw`
-/// tells us exactly which part of the scanout changed since it. A newly
-/// allocated shadow, or a new scanout surface, has nothing to build on, so
-/// `shadowNeedsFullCopy` forces one whole copy first.
+/// Only what changed is copied. Every shadow remembers which frame it holds,
+/// and the damage of the last `kCSDisplayShadowDamageHistory` frames is kept,
+/// so a shadow a few frames behind is caught up with the union of the rects
+/// it missed. A shadow further behind, a newly allocated one, or any after a
+/// new scanout surface has nothing to build on and is copied in full.
 ///
 /// `completion` is always run on the SPICE context thread.
 - (void)copyScanoutRect:(CGRect)rect withCompletion:(nonnull completionCallback_t)completion {
     g_assert(CSMain.sharedInstance.isCurrentContextMain);
     id<MTLTexture> source = self.glTexture;
-    id<MTLTexture> destination = self.shadowTexture;
-    id<MTLCommandQueue> queue = self.renderers.firstObject.commandQueue;
+    NSArray<id<MTLTexture>> *shadowTextures = self.shadowTextures;
+    uint64_t received = _glDrawReceivedAt;
     id<MTLCommandBuffer> commandBuffer = nil;
     id<MTLBlitCommandEncoder> blitEncoder = nil;
 
-    if (self.ready && source && destination) {
+    if (self.shadowNeedsFullCopy) {
+        // the damage that follows describes changes against the previous
+        // scanout, which none of the shadows hold any longer
+        memset(_shadowFrame, 0, sizeof(_shadowFrame));
+        self.shadowNeedsFullCopy = NO;
+    }
+    // every frame counts towards what the shadows missed, even one we do not copy
+    uint64_t frame = ++_shadowFrameCount;
+    _shadowDamage[frame % kCSDisplayShadowDamageHistory] = rect;
+
+    NSInteger index = [self freeShadowTexture];
+    id<MTLCommandQueue> queue = self.shadowCopyQueue;
+    BOOL waitsForPresent = NO;
+    if (index < 0 && _shadowPresented >= 0) {
+        index = _shadowPresented;
+        queue = self.renderers.firstObject.commandQueue;
+        waitsForPresent = YES;
+    }
+    if (self.ready && source && index >= 0) {
         commandBuffer = [queue commandBuffer];
         blitEncoder = [commandBuffer blitCommandEncoder];
     }
@@ -583,15 +1520,23 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         // Going through the renderer instead holds the acknowledgement until
         // the frame is on screen, which is what we did before the copy existed,
         // and costs nothing when there is nothing to draw.
+        [self.statistics recordAckWaitedForPresent];
         [self invalidateWithCompletion:^{
             [CSMain.sharedInstance asyncWith:completion];
         }];
         return;
     }
+    if (waitsForPresent) {
+        [self.statistics recordAckWaitedForPresent];
+    }
 
+    id<MTLTexture> destination = shadowTextures[index];
     CGRect bounds = CGRectMake(0, 0, MIN(source.width, destination.width),
                                MIN(source.height, destination.height));
-    CGRect damaged = self.shadowNeedsFullCopy ? bounds : CGRectIntersection(rect, bounds);
+    CGRect damaged = [self shadowDamageSince:_shadowFrame[index] frame:frame bounds:bounds];
+    // half copied until the completion says otherwise
+    _shadowFrame[index] = 0;
+    _shadowBusyUntil[index] = UINT64_MAX;
 
     commandBuffer.label = @"Scanout Copy";
     if (!CGRectIsEmpty(damaged)) {
@@ -606,24 +1551,51 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
                    destinationOrigin:MTLOriginMake(damaged.origin.x, damaged.origin.y, 0)];
     }
     [blitEncoder endEncoding];
-    // later copies build on this one, and the queue keeps them in order
-    self.shadowNeedsFullCopy = NO;
 
     [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
         BOOL succeeded = commandBuffer.error == nil;
+        if (succeeded) {
+            [self.statistics recordLatency:kCSDisplayLatencyUpload since:received];
+        }
         [CSMain.sharedInstance asyncWith:^{
-            // A failed copy leaves the shadow undefined, and a copy that was
-            // still in flight when the scanout changed wrote into a shadow we
-            // have since replaced: publishing either would show a frame that
+            // A copy that was still in flight when the scanout changed wrote
+            // into a ring we have since replaced, and a failed copy leaves its
+            // shadow undefined: publishing either would show a frame that
             // never existed. The server has to be released in any case.
-            if (succeeded && destination == self.shadowTexture) {
+            if (shadowTextures != self.shadowTextures) {
+                [self.statistics recordFrameDropped];
+            } else if (!succeeded) {
+                if (index != self->_shadowPresented) {
+                    self->_shadowBusyUntil[index] = 0;
+                }
+                [self.statistics recordFrameDropped];
+            } else if (frame > self->_shadowPresentedFrame) {
+                self->_shadowFrame[index] = frame;
+                if (self->_shadowPresented >= 0 && self->_shadowPresented != index) {
+                    // the renderer may still be drawing the old frame
+                    self->_shadowBusyUntil[self->_shadowPresented] = frame;
+                }
+                self->_shadowPresented = index;
+                self->_shadowPresentedFrame = frame;
                 // publish before the completion runs, so the invalidate it
                 // triggers picks up this frame
                 self.presentTexture = destination;
+            } else {
+                // overtaken by a later frame, but still a good one to build on
+                self->_shadowFrame[index] = frame;
+                if (index != self->_shadowPresented) {
+                    self->_shadowBusyUntil[index] = 0;
+                }
+                [self.statistics recordFrameDropped];
             }
             completion();
         }];
     }];
+    if (@available(iOS 12, macOS 10.14, *)) {
+        if (self.shadowCopyEvent) {
+            [commandBuffer encodeSignalEvent:self.shadowCopyEvent value:++_shadowCopyEventValue];
+        }
+    }
 
     [commandBuffer commit];
 }
@@ -634,8 +1606,8 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
         return;
     }
     MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
-    // don't worry that that components are reversed, we fix it in shaders
-    textureDescriptor.pixelFormat = (self.canvasFormat == SPICE_SURFACE_FMT_32_xRGB) ? MTLPixelFormatBGRA8Unorm : (MTLPixelFormat)43;// FIXME: MTLPixelFormatBGR5A1Unorm is supposed to be available.
+    // 16-bit canvases are converted on upload, see `drawDirtyRegion`
+    textureDescriptor.pixelFormat = MTLPixelFormatBGRA8Unorm;
     textureDescriptor.width = visibleArea.size.width;
     textureDescriptor.height = visibleArea.size.height;
     textureDescriptor.usage = MTLTextureUsageShaderRead;
@@ -645,126 +1617,250 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
     if (!canvasDataAligned || !canvasSize) {
         return; // it will be freed
     }
-#if TARGET_OS_SIMULATOR
-    self.canvasBuffer = [self.device newBufferWithBytes:(void *)self.canvasData
-                                                 length:canvasSize
-                                                options:0];
-#else /* !TARGET_OS_SIMULATOR */
-    // round size up to multiple of page size
-    self.canvasBufferOffset = ((uintptr_t)self.canvasData - canvasDataAligned);
-    canvasSize += self.canvasBufferOffset;
-    canvasSize = round_page_kernel(canvasSize);
-    self.canvasBuffer = [self.device newBufferWithBytesNoCopy:(void *)canvasDataAligned
-                                                       length:canvasSize
 #if TARGET_OS_OSX
-                                                      options:MTLResourceStorageModeManaged
+    MTLResourceOptions options = MTLResourceStorageModeManaged;
+    if (@available(macOS 10.15, *)) {
+        // with unified memory the GPU sees the canvas as SPICE writes it, so there
+        // are no modified ranges to report
+        if (self.device.hasUnifiedMemory) {
+            options = MTLResourceStorageModeShared;
+        }
+    }
 #else
-                                                      options:MTLResourceCPUCacheModeWriteCombined
+    MTLResourceOptions options = MTLResourceCPUCacheModeWriteCombined;
 #endif
-                                                  deallocator:nil];
+    if (self.canvasFormat == SPICE_SURFACE_FMT_16_555) {
+        // not every GPU can sample 555, so damage is widened into a BGRA8 copy of the
+        // canvas on its way to the texture
+        self.canvasBuffer = [self.device newBufferWithLength:self.canvasArea.size.width * 4 * self.canvasArea.size.height
+                                                     options:options];
+        self.canvasBufferOffset = 0;
+        self.canvasUsesSharedStorage = NO;
+    } else {
+#if TARGET_OS_SIMULATOR
+        self.canvasBuffer = [self.device newBufferWithBytes:(void *)self.canvasData
+                                                     length:canvasSize
+                                                    options:0];
+        self.canvasUsesSharedStorage = NO; // a copy, refreshed on every draw
+#else /* !TARGET_OS_SIMULATOR */
+        // round size up to multiple of page size
+        self.canvasBufferOffset = ((uintptr_t)self.canvasData - canvasDataAligned);
+        canvasSize += self.canvasBufferOffset;
+        canvasSize = round_page_kernel(canvasSize);
+        self.canvasBuffer = [self.device newBufferWithBytesNoCopy:(void *)canvasDataAligned
+                                                           length:canvasSize
+                                                          options:options
+                                                      deallocator:nil];
+        self.canvasUsesSharedStorage = self.canvasBuffer.storageMode == MTLStorageModeShared;
 #endif /* TARGET_OS_SIMULATOR */
-    [self drawRegion:visibleArea];
-}
-
-- (void)rebuildDisplayVertices {
-    CGRect visibleArea = self.visibleArea;
-    if (CGRectIsEmpty(visibleArea) || !self.device) {
-        return;
     }
+    // the new texture starts out blank, so anything pending is superseded
+    if (cs_region_is_empty(&_canvasDirtyRegion)) {
+        _canvasDirtySince = 0; // not a server frame, do not time it
+    }
+    cs_region_clear(&_canvasDirtyRegion);
+    cs_region_add(&_canvasDirtyRegion, cs_region_rect(visibleArea));
+    [self drawDirtyRegion];
+}
 
+/// Vertices showing `area` of a texture covering `textureArea`, both in surface coordinates
+///
+/// Renderers may still be reading `existing`, so it is never written to. It is returned as
+/// is if it already holds these vertices, which is the usual case for a scanout flip or a
+/// monitor update that left the geometry alone.
+- (id<MTLBuffer>)verticesForArea:(CGRect)area textureArea:(CGRect)textureArea reusing:(nullable id<MTLBuffer>)existing {
     // Default to full texture mapping (0.0 to 1.0)
     float minX = 0.0f;
     float maxX = 1.0f;
     float minY = 0.0f;
     float maxY = 1.0f;
 
-    // In GL mode, the texture is the full scanout, but we only want to display 'visibleArea'.
-    // We must crop the texture coordinates to match the monitor's x/y offset and width/height.
-    if (self.isGLEnabled && !CGRectIsEmpty(self.canvasArea)) {
-        float textureWidth = self.canvasArea.size.width;
-        float textureHeight = self.canvasArea.size.height;
+    // The texture may hold more than this head, such as the full scanout in GL mode or
+    // every head of the channel. We must crop the texture coordinates to match the
+    // monitor's x/y offset and width/height.
+    if (!CGRectEqualToRect(area, textureArea) && !CGRectIsEmpty(textureArea)) {
+        float textureWidth = textureArea.size.width;
+        float textureHeight = textureArea.size.height;
 
-        minX = visibleArea.origin.x / textureWidth;
-        maxX = (visibleArea.origin.x + visibleArea.size.width) / textureWidth;
+        minX = (area.origin.x - textureArea.origin.x) / textureWidth;
+        maxX = (area.origin.x - textureArea.origin.x + area.size.width) / textureWidth;
 
-        minY = visibleArea.origin.y / textureHeight;
-        maxY = (visibleArea.origin.y + visibleArea.size.height) / textureHeight;
+        minY = (area.origin.y - textureArea.origin.y) / textureHeight;
+        maxY = (area.origin.y - textureArea.origin.y + area.size.height) / textureHeight;
     }
 
     // We flip the y-coordinates because pixman renders flipped
     CSRenderVertex quadVertices[] =
     {
         // Pixel positions,                                             Texture coordinates
-        { {  visibleArea.size.width/2,   visibleArea.size.height/2 },  { maxX, minY } }, // Top Right
-        { { -visibleArea.size.width/2,   visibleArea.size.height/2 },  { minX, minY } }, // Top Left
-        { { -visibleArea.size.width/2,  -visibleArea.size.height/2 },  { minX, maxY } }, // Bottom Left
+        { {  area.size.width/2,   area.size.height/2 },  { maxX, minY } }, // Top Right
+        { { -area.size.width/2,   area.size.height/2 },  { minX, minY } }, // Top Left
+        { { -area.size.width/2,  -area.size.height/2 },  { minX, maxY } }, // Bottom Left
 
-        { {  visibleArea.size.width/2,   visibleArea.size.height/2 },  { maxX, minY } }, // Top Right
-        { { -visibleArea.size.width/2,  -visibleArea.size.height/2 },  { minX, maxY } }, // Bottom Left
-        { {  visibleArea.size.width/2,  -visibleArea.size.height/2 },  { maxX, maxY } }, // Bottom Right
+        { {  area.size.width/2,   area.size.height/2 },  { maxX, minY } }, // Top Right
+        { { -area.size.width/2,  -area.size.height/2 },  { minX, maxY } }, // Bottom Left
+        { {  area.size.width/2,  -area.size.height/2 },  { maxX, maxY } }, // Bottom Right
     };
 
+    if (existing.device == self.device && existing.length == sizeof(quadVertices) &&
+        memcmp(existing.contents, quadVertices, sizeof(quadVertices)) == 0) {
+        return existing;
+    }
+
     // Create our vertex buffer, and initialize it with our quadVertices array
-    self.vertices = [self.device newBufferWithBytes:quadVertices
-                                             length:sizeof(quadVertices)
-                                            options:MTLResourceCPUCacheModeWriteCombined];
+    return [self.device newBufferWithBytes:quadVertices
+                                    length:sizeof(quadVertices)
+                                   options:MTLResourceCPUCacheModeWriteCombined];
+}
 
-    // Calculate the number of vertices by dividing the byte length by the size of each vertex
-    self.numVertices = sizeof(quadVertices) / sizeof(CSRenderVertex);
+- (void)rebuildDisplayVertices {
+    CGRect visibleArea = self.visibleArea;
+    if (CGRectIsEmpty(visibleArea) || !self.device) {
+        return;
+    }
+    // In GL mode, the texture is the full scanout, otherwise it is the canvas for every head
+    CGRect textureArea = self.isGLEnabled ? self.canvasArea : visibleArea;
+
+    self.vertices = [self verticesForArea:self.monitorArea textureArea:textureArea reusing:self.vertices];
+    self.numVertices = 6;
+    for (CSDisplayMonitor *monitor in self.secondaryMonitors) {
+        monitor.vertices = [self verticesForArea:monitor.area textureArea:textureArea reusing:monitor.vertices];
+        monitor.numVertices = 6;
+    }
 }
 
-- (void)drawRegion:(CGRect)rect {
+/// Upload all pending canvas damage with a single copy.
+///
+/// Up to `maxCanvasUploadsInFlight` copies are in flight at a time. Damage arriving while
+/// they are all busy accumulates in `_canvasDirtyRegion`, which keeps the rectangles
+/// separate (up to a bound) so that two small updates far apart do not turn into a copy
+/// of everything in between.
+///
+/// There is no staging ring: the copies read straight from the canvas, which SPICE keeps
+/// decoding into while they are in flight. A copy can therefore pick up some of the next
+/// frame's pixels early, but that damage is already queued and the copy after it writes
+/// the same pixels again. Copies execute in submission order on the renderer's queue, so
+/// the texture never goes back in time. Bounding the depth only limits how far the
+/// renderer can fall behind.
+- (void)drawDirtyRegion {
+    CSRegionRect rects[CS_REGION_MAX_RECTS];
+    MTLRegion regions[CS_REGION_MAX_RECTS];
+    NSUInteger offsets[CS_REGION_MAX_RECTS];
     if (!self.canvasData || !self.canvasBuffer) {
         return; // not ready to draw yet
     }
-    self.canvasIsBusy = YES;
-    NSInteger pixelSize = (self.canvasFormat == SPICE_SURFACE_FMT_32_xRGB) ? 4 : 2;
-    // create draw region
-    MTLRegion region = {
-        { rect.origin.x-self.visibleArea.origin.x, rect.origin.y-self.visibleArea.origin.y, 0 }, // MTLOrigin
-        { rect.size.width, rect.size.height, 1} // MTLSize
-    };
-    NSUInteger offset = (NSUInteger)(rect.origin.y*self.canvasStride + rect.origin.x*pixelSize);
-    NSUInteger totalBytes = rect.size.width*rect.size.height*pixelSize;
-#if TARGET_OS_OSX || TARGET_OS_SIMULATOR
-    for (NSUInteger i = 0; i < rect.size.height; i++) {
-#if TARGET_OS_SIMULATOR
-        memcpy(self.canvasBuffer.contents + offset + i*self.canvasStride,
-               self.canvasData + offset + i*self.canvasStride,
-               rect.size.width*pixelSize);
-#else /* !TARGET_OS_SIMULATOR */
-        [self.canvasBuffer didModifyRange:NSMakeRange(offset+i*self.canvasStride,
-                                                      rect.size.width*pixelSize)];
-#endif /* TARGET_OS_SIMULATOR */
+    size_t count = cs_region_flush(&_canvasDirtyRegion, rects);
+    if (count == 0) {
+        return;
     }
+    uint64_t since = _canvasDirtySince;
+    self.canvasUploadsInFlight++;
+    _canvasUploadsInFlightHistogram[MIN(self.canvasUploadsInFlight, kCSDisplayMaxCanvasUploadsInFlight)]++;
+    NSInteger pixelSize = self.canvasPixelSize;
+    BOOL convert = self.canvasFormat == SPICE_SURFACE_FMT_16_555;
+    NSUInteger bufferStride = convert ? (NSUInteger)self.canvasArea.size.width * 4 : self.canvasStride;
+    for (size_t i = 0; i < count; i++) {
+        CGRect rect = CGRectMake(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+        // create draw region
+        regions[i] = (MTLRegion){
+            { rect.origin.x-self.visibleArea.origin.x, rect.origin.y-self.visibleArea.origin.y, 0 }, // MTLOrigin
+            { rect.size.width, rect.size.height, 1} // MTLSize
+        };
+        NSUInteger offset = (NSUInteger)(rect.origin.y*self.canvasStride + rect.origin.x*pixelSize);
+        if (!convert) {
+            offsets[i] = self.canvasBufferOffset + offset;
+        } else {
+            offsets[i] = (NSUInteger)(rect.origin.y*bufferStride + rect.origin.x*4);
+            cs_convert_xrgb1555_to_bgra8(self.canvasBuffer.contents + offsets[i],
+                                         bufferStride,
+                                         self.canvasData + offset,
+                                         self.canvasStride,
+                                         rect.size.width,
+                                         rect.size.height);
+        }
+#if TARGET_OS_SIMULATOR
+        for (NSUInteger j = 0; !convert && j < rect.size.height; j++) {
+            memcpy(self.canvasBuffer.contents + offset + j*self.canvasStride,
+                   self.canvasData + offset + j*self.canvasStride,
+                   rect.size.width*pixelSize);
+        }
+#elif TARGET_OS_OSX
+        if (self.canvasBuffer.storageMode == MTLStorageModeManaged) {
+            // one range from the first pixel to the last rather than one per row: the
+            // bytes between rows are synchronised needlessly, but that is far cheaper
+            // than a call and a tracked range for each of thousands of rows
+            NSUInteger length = (NSUInteger)((rect.size.height-1)*bufferStride + rect.size.width*(convert ? 4 : pixelSize));
+            [self.canvasBuffer didModifyRange:NSMakeRange(offsets[i], length)];
+        }
 #endif
-    dispatch_semaphore_t drawCompletedEvent = dispatch_semaphore_create(0);
+    }
     [self copyBuffer:self.canvasBuffer
-              region:region
-        sourceOffset:self.canvasBufferOffset + offset
-   sourceBytesPerRow:self.canvasStride
+             regions:regions
+       sourceOffsets:offsets
+               count:count
+   sourceBytesPerRow:bufferStride
           completion:^ {
+        if (since) {
+            [self.statistics recordFramePresentedSince:since];
+        }
         [CSMain.sharedInstance asyncWith:^{
-            CGRect dirtyRect = self.canvasDirtyRect;
-            self.canvasDirtyRect = CGRectZero;
-            self.canvasIsBusy = NO;
-            if (!CGRectIsEmpty(dirtyRect)) {
-                [self drawRegion:dirtyRect];
+            self.canvasUploadsInFlight--;
+            if (self.canvasUploadsInFlight < self.maxCanvasUploadsInFlight) {
+                [self drawDirtyRegion];
             }
         }];
     }];
 }
 
+- (void)overlay:(CSDisplayOverlay *)overlay presentTexture:(id<MTLTexture>)texture completion:(completionCallback_t)completion {
+    [CSMain.sharedInstance asyncWith:^{
+        if (overlay != self.overlay || self.isGLEnabled) {
+            completion(); // superseded, let it drain
+            return;
+        }
+        self.overlayTexture = texture;
+        [self.recorder invalidate];
+        [self invalidateWithCompletion:completion];
+    }];
+}
+
+- (void)overlayDidFinish:(CSDisplayOverlay *)overlay {
+    [CSMain.sharedInstance asyncWith:^{
+        if (overlay != self.overlay) {
+            return;
+        }
+        SPICE_DEBUG("[CocoaSpice] video overlay finished");
+        self.overlay = nil;
+        self.overlayTexture = nil;
+        if (!self.isGLEnabled) {
+            // the canvas was not drawn while the stream was up, so bring all of it up to date
+            cs_region_add(&self->_canvasDirtyRegion, cs_region_rect(self.visibleArea));
+            if (self.canvasUploadsInFlight < self.maxCanvasUploadsInFlight) {
+                [self drawDirtyRegion];
+            }
+        }
+        [self invalidate];
+    }];
+}
+
 - (void)requestResolution:(CGRect)bounds {
+    [self requestResolution:bounds forMonitorID:self.monitorID];
+}
+
+- (void)requestResolution:(CGRect)bounds forMonitorID:(NSInteger)monitorID {
     if (!self.spiceMain) {
         SPICE_DEBUG("[CocoaSpice] ignoring change resolution because main channel not found");
         return;
     }
+    if (!cs_monitor_id_is_addressable(monitorID)) {
+        SPICE_DEBUG("[CocoaSpice] ignoring change resolution of monitor %ld, SPICE cannot address it", (long)monitorID);
+        return;
+    }
     [CSMain.sharedInstance asyncWith:^{
         SpiceMainChannel *main = self.spiceMain;
-        spice_main_channel_update_display_enabled(main, (int)self.monitorID, TRUE, FALSE);
+        spice_main_channel_update_display_enabled(main, (int)monitorID, TRUE, FALSE);
         spice_main_channel_update_display(main,
-                                          (int)self.monitorID,
+                                          (int)monitorID,
                                           bounds.origin.x,
                                           bounds.origin.y,
                                           bounds.size.width,
@@ -780,6 +1876,10 @@ static void cs_gl_draw(SpiceDisplayChannel *channel,
             SPICE_DEBUG("[CocoaSpice] ignoring display enable change because main channel not found");
             return;
         }
+        if (!cs_monitor_id_is_addressable(self.monitorID)) {
+            SPICE_DEBUG("[CocoaSpice] ignoring display enable change of monitor %ld, SPICE cannot address it", (long)self.monitorID);
+            return;
+        }
         [CSMain.sharedInstance asyncWith:^{
             spice_main_channel_update_display_enabled(self.spiceMain, (int)self.monitorID, isEnabled, TRUE);
             self->_isEnabled = isEnabled;
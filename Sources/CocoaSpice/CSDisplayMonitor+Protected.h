@@ -0,0 +1,37 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayMonitor.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface CSDisplayMonitor ()
+
+@property (nonatomic, readwrite) CGRect area;
+@property (nonatomic, nullable, readwrite) id<MTLBuffer> vertices;
+@property (nonatomic, readwrite) NSUInteger numVertices;
+
+/// Renderers presenting this head
+@property (atomic, readonly) NSArray<id<CSRenderer>> *renderers;
+
+/// Create a head of a display
+/// @param display Display channel the head belongs to
+/// @param monitorID Id of the head
+- (instancetype)initWithDisplay:(CSDisplay *)display monitorID:(NSInteger)monitorID NS_DESIGNATED_INITIALIZER;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,96 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayMonitor+Protected.h"
+#import "CSDisplay+Protected.h"
+#import "CSRenderer.h"
+
+@interface CSDisplayMonitor ()
+
+@property (atomic, readwrite) NSArray<id<CSRenderer>> *renderers;
+
+@end
+
+@implementation CSDisplayMonitor
+
+#pragma mark - Properties
+
+- (CGSize)displaySize {
+    return self.area.size;
+}
+
+- (BOOL)isVisible {
+    return self.display.isVisible && self.vertices && !CGRectIsEmpty(self.area);
+}
+
+- (CGPoint)offset {
+    return CGPointZero;
+}
+
+- (id<MTLTexture>)texture {
+    // the display's texture covers every head
+    return self.display.texture;
+}
+
+- (BOOL)hasAlpha {
+    return self.display.hasAlpha;
+}
+
+- (BOOL)isInverted {
+    return self.display.isInverted;
+}
+
+- (id<CSRenderSource>)cursorSource {
+    return nil;
+}
+
+#pragma mark - Methods
+
+- (instancetype)initWithDisplay:(CSDisplay *)display monitorID:(NSInteger)monitorID {
+    if (self = [super init]) {
+        _display = display;
+        _monitorID = monitorID;
+        _renderers = @[];
+    }
+    return self;
+}
+
+- (void)requestResolution:(CGRect)bounds {
+    [self.display requestResolution:bounds forMonitorID:self.monitorID];
+}
+
+- (void)addRenderer:(id<CSRenderer>)renderer {
+    NSArray<id<CSRenderer>> *renderers = self.renderers;
+    CSDisplay *display = self.display;
+    if (![renderers containsObject:renderer]) {
+        self.renderers = [renderers arrayByAddingObject:renderer];
+    }
+    if (!display.device) {
+        display.device = renderer.device;
+    } else {
+        NSAssert(display.device == renderer.device, @"Cannot use two renderers from different Metal devices!");
+    }
+    [renderer invalidateRenderSource:self withCompletion:nil];
+}
+
+- (void)removeRenderer:(id<CSRenderer>)renderer {
+    NSMutableArray<id<CSRenderer>> *renderers = [self.renderers mutableCopy];
+    [renderers removeObject:renderer];
+    self.renderers = renderers;
+    [renderer disableRender];
+}
+
+@end
@@ -0,0 +1,51 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import Metal;
+
+@class CSDisplay;
+typedef struct _GstElement GstElement;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Decodes one guest video stream straight into textures
+///
+/// When the server streams a whole surface and the display answers `streaming-mode` with a
+/// handle, spice-gtk offers us its GStreamer pipeline through `gst-video-overlay`. Taking it replaces the pipeline's video sink with one of
+/// ours, so decoded frames are written into a texture the display presents in place of
+/// the canvas, instead of going through the canvas and its damage uploads.
+///
+/// The overlay is kept alive by its sink and ends when spice-gtk tears the pipeline down.
+@interface CSDisplayOverlay : NSObject
+
+/// Display the frames are presented on
+@property (nonatomic, weak, readonly) CSDisplay *display;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Create an overlay for a display
+/// @param display Display to present on
+/// @param device Device to create textures on
+- (instancetype)initWithDisplay:(CSDisplay *)display device:(id<MTLDevice>)device NS_DESIGNATED_INITIALIZER;
+
+/// Create the video sink feeding this overlay
+/// @returns A floating reference to hand to the pipeline, or NULL if the sink could not be created
+- (nullable GstElement *)createVideoSink;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,193 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayOverlay.h"
+#import "CSDisplay+Protected.h"
+#import "CSDisplayStatistics+Protected.h"
+#import <glib.h>
+#import <spice-client.h>
+#import <gst/gst.h>
+#import <gst/app/gstappsink.h>
+#import <gst/video/video.h>
+
+// Frames presented from alternately, so one can be written while the other is on screen
+#define kCSDisplayOverlayTextures 2
+
+@interface CSDisplayOverlay ()
+
+// These must only be accessed on `queue`
+@property (nonatomic, readonly) dispatch_queue_t queue;
+@property (nonatomic, readonly) id<MTLDevice> device;
+@property (nonatomic) BOOL uploadScheduled;
+@property (nonatomic) uint64_t pendingSampleReceivedAt;
+
+@end
+
+@implementation CSDisplayOverlay {
+    // Newest decoded frame not uploaded yet, older ones are dropped in its favour
+    GstSample *_pendingSample;
+    id<MTLTexture> _textures[kCSDisplayOverlayTextures];
+    NSUInteger _nextTexture;
+}
+
+#pragma mark - Sink callbacks
+
+static GstFlowReturn cs_overlay_new_sample(GstAppSink *sink, gpointer data) {
+    CSDisplayOverlay *self = (__bridge CSDisplayOverlay *)data;
+    uint64_t receivedAt = cs_display_statistics_now();
+    GstSample *sample = gst_app_sink_pull_sample(sink);
+
+    if (!sample) {
+        return GST_FLOW_EOS;
+    }
+    [self.display.statistics recordFrameReceived];
+    dispatch_async(self.queue, ^{
+        if (self->_pendingSample) {
+            // decoding outran the display, only the newest frame is worth showing
+            gst_sample_unref(self->_pendingSample);
+            [self.display.statistics recordFrameMerged];
+        }
+        self->_pendingSample = sample;
+        self.pendingSampleReceivedAt = receivedAt;
+        if (!self.uploadScheduled) {
+            self.uploadScheduled = YES;
+            [self uploadPendingSample];
+        }
+    });
+    return GST_FLOW_OK;
+}
+
+static void cs_overlay_eos(GstAppSink *sink, gpointer data) {
+    CSDisplayOverlay *self = (__bridge CSDisplayOverlay *)data;
+    SPICE_DEBUG("[CocoaSpice] video overlay end of stream");
+    [self.display overlayDidFinish:self];
+}
+
+static void cs_overlay_destroy(gpointer data) {
+    // the sink is gone with its pipeline, and so is the stream
+    CSDisplayOverlay *self = (__bridge_transfer CSDisplayOverlay *)data;
+    [self.display overlayDidFinish:self];
+}
+
+#pragma mark - Methods
+
+- (instancetype)initWithDisplay:(CSDisplay *)display device:(id<MTLDevice>)device {
+    if (self = [super init]) {
+        _display = display;
+        _device = device;
+        _queue = dispatch_queue_create("CSDisplayOverlay", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_pendingSample) {
+        gst_sample_unref(_pendingSample);
+    }
+}
+
+- (GstElement *)createVideoSink {
+    GstElement *sink = gst_element_factory_make("appsink", NULL);
+    if (!sink) {
+        SPICE_DEBUG("[CocoaSpice] failed to create video overlay sink");
+        return NULL;
+    }
+    // playbin converts to whatever we ask for, and BGRx is what the canvas
+    // texture already holds so the renderer needs nothing new
+    GstCaps *caps = gst_caps_from_string("video/x-raw,format=BGRx");
+    gst_app_sink_set_caps(GST_APP_SINK(sink), caps);
+    gst_caps_unref(caps);
+    // we keep our own latest frame, there is no point in queuing in the sink
+    gst_app_sink_set_max_buffers(GST_APP_SINK(sink), 1);
+    gst_app_sink_set_drop(GST_APP_SINK(sink), TRUE);
+    GstAppSinkCallbacks callbacks = {
+        .eos = cs_overlay_eos,
+        .new_sample = cs_overlay_new_sample,
+    };
+    gst_app_sink_set_callbacks(GST_APP_SINK(sink), &callbacks, (__bridge_retained void *)self, cs_overlay_destroy);
+    return sink;
+}
+
+/// Must be called on `queue`
+///
+/// Writes the newest frame into the texture not on screen and presents it. The next
+/// frame is only written once this one has been drawn, so a texture is never written
+/// while the renderer could still be reading it.
+- (void)uploadPendingSample {
+    GstSample *sample = _pendingSample;
+    uint64_t receivedAt = self.pendingSampleReceivedAt;
+    CSDisplay *display = self.display;
+
+    _pendingSample = NULL;
+    if (!sample || !display) {
+        if (sample) {
+            gst_sample_unref(sample);
+        }
+        self.uploadScheduled = NO;
+        return;
+    }
+
+    id<MTLTexture> texture = [self writeSample:sample];
+    gst_sample_unref(sample);
+    if (!texture) {
+        [display.statistics recordFrameDropped];
+        self.uploadScheduled = NO;
+        return;
+    }
+
+    [display overlay:self presentTexture:texture completion:^{
+        [display.statistics recordFramePresentedSince:receivedAt];
+        dispatch_async(self.queue, ^{
+            [self uploadPendingSample];
+        });
+    }];
+}
+
+/// Must be called on `queue`
+- (nullable id<MTLTexture>)writeSample:(GstSample *)sample {
+    GstVideoInfo info;
+    GstVideoFrame frame;
+    GstBuffer *buffer = gst_sample_get_buffer(sample);
+    GstCaps *caps = gst_sample_get_caps(sample);
+
+    if (!buffer || !caps || !gst_video_info_from_caps(&info, caps)) {
+        return nil;
+    }
+    NSUInteger width = GST_VIDEO_INFO_WIDTH(&info);
+    NSUInteger height = GST_VIDEO_INFO_HEIGHT(&info);
+    id<MTLTexture> texture = _textures[_nextTexture];
+    if (texture.width != width || texture.height != height) {
+        MTLTextureDescriptor *textureDescriptor = [[MTLTextureDescriptor alloc] init];
+        textureDescriptor.pixelFormat = MTLPixelFormatBGRA8Unorm;
+        textureDescriptor.width = width;
+        textureDescriptor.height = height;
+        textureDescriptor.usage = MTLTextureUsageShaderRead;
+        texture = [self.device newTextureWithDescriptor:textureDescriptor];
+        _textures[_nextTexture] = texture;
+    }
+    if (!texture || !gst_video_frame_map(&frame, &info, buffer, GST_MAP_READ)) {
+        return nil;
+    }
+    [texture replaceRegion:MTLRegionMake2D(0, 0, width, height)
+               mipmapLevel:0
+                 withBytes:GST_VIDEO_FRAME_PLANE_DATA(&frame, 0)
+               bytesPerRow:GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0)];
+    gst_video_frame_unmap(&frame);
+    _nextTexture = (_nextTexture + 1) % kCSDisplayOverlayTextures;
+    return texture;
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+@class CSDisplay;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Error domain of recordings
+extern NSString *const kCSDisplayRecorderDomain;
+
+/// Encodes what a display presents to a video file
+///
+/// Frames follow the damage: each change to the display is copied on the SPICE thread
+/// (see `-[CSDisplay captureFrameWithReadback:completion:]`) at most 30 times a second,
+/// and an idle screen sends nothing at all. Converting, encoding to H.264 and muxing run
+/// on the pipeline's own streaming thread. Only a few frames may wait there, any damage
+/// past that is kept for a later frame rather than making the SPICE thread wait.
+@interface CSDisplayRecorder : NSObject
+
+/// Display being recorded
+@property (nonatomic, weak, readonly) CSDisplay *display;
+
+/// Number of frames sent to the encoder
+@property (atomic, readonly) uint64_t recordedFrameCount;
+
+/// Number of frames not copied because the encoder was behind
+@property (atomic, readonly) uint64_t droppedFrameCount;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Create a recorder
+/// @param display Display to record
+/// @param url File to write, an extension of mp4, mov or mkv picks that container and anything else MPEG-TS
+- (instancetype)initWithDisplay:(CSDisplay *)display url:(NSURL *)url NS_DESIGNATED_INITIALIZER;
+
+/// Build and start the encode pipeline
+/// @param error Set when the pipeline could not be started
+- (BOOL)startWithError:(NSError * _Nullable *)error;
+
+/// Record a frame for a change to the display
+///
+/// Must be called on the SPICE thread once the change can be captured.
+- (void)invalidate;
+
+/// Stop recording and finish the file
+///
+/// Must be called on the SPICE thread.
+/// @param completion Runs on a background queue once the file is written, with an error if the recording failed
+- (void)finishWithCompletion:(void (^)(NSError * _Nullable))completion;
+
+@end
+
+NS_ASSUME_NONNULL_END
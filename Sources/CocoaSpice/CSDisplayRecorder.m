@@ -0,0 +1,305 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayRecorder.h"
+#import "CSDisplay+Protected.h"
+#import "CSMain.h"
+#import "CSScreenshotReadback.h"
+#import <glib.h>
+#import <spice-client.h>
+#import <gst/gst.h>
+#import <gst/app/gstappsrc.h>
+#import <gst/video/video.h>
+
+NSString *const kCSDisplayRecorderDomain = @"org.spice-space.record";
+
+// Fastest a recording follows the display, in frames per second
+static const gint64 kCSDisplayRecorderMaxFrameRate = 30;
+// Frames copied but not yet converted for the encoder, past this damage waits for a later frame
+static const gint kCSDisplayRecorderMaxFramesInFlight = 3;
+// Longest we wait for the pipeline to finish the file
+static const GstClockTime kCSDisplayRecorderFinishTimeout = 10 * GST_SECOND;
+
+typedef struct {
+    void *buffer;
+    void *recorder;
+} CSDisplayRecorderFrame;
+
+@interface CSDisplayRecorder ()
+
+@property (nonatomic, weak, readwrite) CSDisplay *display;
+@property (nonatomic) NSURL *url;
+@property (atomic, readwrite) uint64_t recordedFrameCount;
+@property (atomic, readwrite) uint64_t droppedFrameCount;
+
+@end
+
+@implementation CSDisplayRecorder {
+    GstElement *_pipeline;
+    GstAppSrc *_source;
+    CSScreenshotReadback *_readback;
+    // copied frames still held by us or the pipeline
+    gint _framesInFlight;
+    // only touched on the SPICE thread
+    GSource *_frameTimer;
+    gint64 _lastFrameAt;
+    BOOL _dirty;
+    BOOL _finishing;
+    // only touched on the readback queue
+    GstClockTime _firstFrameAt;
+    NSUInteger _width;
+    NSUInteger _height;
+    MTLPixelFormat _pixelFormat;
+    BOOL _finished;
+}
+
+static NSError *errorWithUTF8String(const char *string) {
+    NSString *description = [NSString stringWithUTF8String:string];
+    return [NSError errorWithDomain:kCSDisplayRecorderDomain code:-1 userInfo:@{NSLocalizedDescriptionKey: description}];
+}
+
+static const char *cs_recorder_muxer(NSURL *url) {
+    NSString *extension = url.pathExtension.lowercaseString;
+    if ([extension isEqualToString:@"mp4"] || [extension isEqualToString:@"m4v"]) {
+        return "mp4mux";
+    } else if ([extension isEqualToString:@"mov"]) {
+        return "qtmux";
+    } else if ([extension isEqualToString:@"mkv"]) {
+        return "matroskamux";
+    } else {
+        // survives being cut short, unlike the others which are only complete once finished
+        return "mpegtsmux";
+    }
+}
+
+static void cs_recorder_frame_free(gpointer data) {
+    CSDisplayRecorderFrame *frame = data;
+    CSScreenshotBuffer *buffer = (__bridge_transfer CSScreenshotBuffer *)frame->buffer;
+    // the pipeline gives every frame back before the recorder goes, see `dealloc`
+    CSDisplayRecorder *self = (__bridge CSDisplayRecorder *)frame->recorder;
+    [buffer recycle];
+    g_atomic_int_add(&self->_framesInFlight, -1);
+    g_free(frame);
+}
+
+static gboolean cs_recorder_frame_timer(gpointer data) {
+    CSDisplayRecorder *self = (__bridge CSDisplayRecorder *)data;
+    // we are the last reference once this returns
+    g_source_unref(self->_frameTimer);
+    self->_frameTimer = NULL;
+    if (self->_dirty) {
+        [self captureFrame];
+    }
+    return G_SOURCE_REMOVE;
+}
+
+#pragma mark - Methods
+
+- (instancetype)initWithDisplay:(CSDisplay *)display url:(NSURL *)url {
+    if (self = [super init]) {
+        _display = display;
+        _url = url;
+        // one buffer for each frame that may be in flight, so they are never reallocated
+        _readback = [[CSScreenshotReadback alloc] initWithFreeBuffers:kCSDisplayRecorderMaxFramesInFlight];
+        _firstFrameAt = GST_CLOCK_TIME_NONE;
+        _pixelFormat = MTLPixelFormatInvalid;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    GSource *frameTimer = _frameTimer;
+    if (frameTimer) {
+        [CSMain.sharedInstance syncWith:^{
+            g_source_destroy(frameTimer);
+            g_source_unref(frameTimer);
+        }];
+    }
+    if (_pipeline) {
+        gst_element_set_state(_pipeline, GST_STATE_NULL);
+        gst_object_unref(_source);
+        gst_object_unref(_pipeline);
+    }
+}
+
+- (BOOL)startWithError:(NSError **)error {
+    GError *err = NULL;
+    gchar *description = g_strdup_printf("appsrc name=source ! videoconvert ! "
+                                         "x264enc tune=zerolatency speed-preset=veryfast ! "
+                                         "h264parse ! %s ! filesink name=sink", cs_recorder_muxer(self.url));
+    _pipeline = gst_parse_launch(description, &err);
+    g_free(description);
+    if (!_pipeline || err) {
+        if (error) {
+            *error = errorWithUTF8String(err ? err->message : "failed to create the recording pipeline");
+        }
+        g_clear_error(&err);
+        g_clear_object(&_pipeline);
+        return NO;
+    }
+    _source = GST_APP_SRC(gst_bin_get_by_name(GST_BIN(_pipeline), "source"));
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(_pipeline), "sink");
+    g_object_set(sink, "location", self.url.fileSystemRepresentation, NULL);
+    gst_object_unref(sink);
+    // frames carry the time they were captured and come as often as the display changes
+    g_object_set(_source, "format", GST_FORMAT_TIME, "is-live", TRUE, NULL);
+    if (gst_element_set_state(_pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        if (error) {
+            *error = errorWithUTF8String("failed to start the recording pipeline");
+        }
+        return NO;
+    }
+    return YES;
+}
+
+- (void)invalidate {
+    _dirty = YES;
+    if (_frameTimer || _finishing) {
+        return;
+    }
+    gint64 wait = _lastFrameAt + G_USEC_PER_SEC / kCSDisplayRecorderMaxFrameRate - g_get_monotonic_time();
+    if (wait > 0) {
+        [self scheduleFrameAfter:wait];
+    } else {
+        [self captureFrame];
+    }
+}
+
+/// Must be called on the SPICE thread
+- (void)scheduleFrameAfter:(gint64)wait {
+    _frameTimer = g_timeout_source_new((guint)((wait + 999) / 1000));
+    g_source_set_callback(_frameTimer, cs_recorder_frame_timer, (__bridge void *)self, NULL);
+    g_source_attach(_frameTimer, CSMain.sharedInstance.glibMainContext);
+}
+
+/// Must be called on the SPICE thread
+- (void)captureFrame {
+    CSDisplay *display = self.display;
+    gint64 now = g_get_monotonic_time();
+    if (!display) {
+        return;
+    }
+    _lastFrameAt = now;
+    if (g_atomic_int_get(&_framesInFlight) >= kCSDisplayRecorderMaxFramesInFlight) {
+        // the encoder is behind, try again with whatever the display shows by then
+        self.droppedFrameCount++;
+        if (!_finishing) {
+            [self scheduleFrameAfter:G_USEC_PER_SEC / kCSDisplayRecorderMaxFrameRate];
+        }
+        return;
+    }
+    _dirty = NO;
+    g_atomic_int_inc(&_framesInFlight);
+    [display captureFrameWithReadback:_readback completion:^(CSScreenshotBuffer *buffer, NSUInteger width, NSUInteger height, NSUInteger bytesPerRow, MTLPixelFormat pixelFormat) {
+        [self pushBuffer:buffer width:width height:height bytesPerRow:bytesPerRow pixelFormat:pixelFormat capturedAt:now * GST_USECOND];
+    }];
+}
+
+/// Must be called on the readback queue, takes over one frame in flight
+- (void)pushBuffer:(nullable CSScreenshotBuffer *)buffer
+             width:(NSUInteger)width
+            height:(NSUInteger)height
+       bytesPerRow:(NSUInteger)bytesPerRow
+       pixelFormat:(MTLPixelFormat)pixelFormat
+        capturedAt:(GstClockTime)capturedAt {
+    GstVideoFormat format = GST_VIDEO_FORMAT_UNKNOWN;
+    if (pixelFormat == MTLPixelFormatBGRA8Unorm) {
+        format = GST_VIDEO_FORMAT_BGRx;
+    } else if (pixelFormat == MTLPixelFormatRGBA8Unorm) {
+        format = GST_VIDEO_FORMAT_RGBx;
+    }
+    if (!buffer || format == GST_VIDEO_FORMAT_UNKNOWN || _finished) {
+        [buffer recycle];
+        g_atomic_int_add(&_framesInFlight, -1);
+        return;
+    }
+    if (width != _width || height != _height || pixelFormat != _pixelFormat) {
+        // the encoder starts over at the new size
+        GstCaps *caps = gst_caps_new_simple("video/x-raw",
+                                            "format", G_TYPE_STRING, gst_video_format_to_string(format),
+                                            "width", G_TYPE_INT, (gint)width,
+                                            "height", G_TYPE_INT, (gint)height,
+                                            "framerate", GST_TYPE_FRACTION, 0, 1,
+                                            NULL);
+        gst_app_src_set_caps(_source, caps);
+        gst_caps_unref(caps);
+        _width = width;
+        _height = height;
+        _pixelFormat = pixelFormat;
+    }
+    if (_firstFrameAt == GST_CLOCK_TIME_NONE) {
+        _firstFrameAt = capturedAt;
+    }
+
+    // the pipeline reads the readback buffer in place and hands it back once converted
+    CSDisplayRecorderFrame *frame = g_new(CSDisplayRecorderFrame, 1);
+    frame->buffer = (__bridge_retained void *)buffer;
+    frame->recorder = (__bridge void *)self;
+    GstBuffer *gstBuffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+                                                       buffer.bytes,
+                                                       buffer.length,
+                                                       0,
+                                                       bytesPerRow * height,
+                                                       frame,
+                                                       cs_recorder_frame_free);
+    gsize offset[GST_VIDEO_MAX_PLANES] = { 0 };
+    gint stride[GST_VIDEO_MAX_PLANES] = { (gint)bytesPerRow };
+    gst_buffer_add_video_meta_full(gstBuffer, GST_VIDEO_FRAME_FLAG_NONE, format, (guint)width, (guint)height, 1, offset, stride);
+    GST_BUFFER_PTS(gstBuffer) = capturedAt - _firstFrameAt;
+    if (gst_app_src_push_buffer(_source, gstBuffer) == GST_FLOW_OK) {
+        self.recordedFrameCount++;
+    } else {
+        SPICE_DEBUG("[CocoaSpice] recording pipeline stopped taking frames");
+    }
+}
+
+- (void)finishWithCompletion:(void (^)(NSError * _Nullable))completion {
+    if (_frameTimer) {
+        g_source_destroy(_frameTimer);
+        g_source_unref(_frameTimer);
+        _frameTimer = NULL;
+    }
+    BOOL wasFinishing = _finishing;
+    _finishing = YES;
+    if (_dirty && !wasFinishing) {
+        // end on what the display shows now
+        [self captureFrame];
+    }
+    dispatch_async(_readback.queue, ^{
+        // a GPU copy still in flight completes after this and is dropped
+        self->_finished = YES;
+        gst_app_src_end_of_stream(self->_source);
+        GstBus *bus = gst_element_get_bus(self->_pipeline);
+        GstMessage *message = gst_bus_timed_pop_filtered(bus, kCSDisplayRecorderFinishTimeout, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+        NSError *error = nil;
+        if (!message) {
+            error = errorWithUTF8String("timed out finishing the recording");
+        } else if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_ERROR) {
+            GError *err = NULL;
+            gst_message_parse_error(message, &err, NULL);
+            error = errorWithUTF8String(err ? err->message : "recording failed");
+            g_clear_error(&err);
+        }
+        if (message) {
+            gst_message_unref(message);
+        }
+        gst_object_unref(bus);
+        gst_element_set_state(self->_pipeline, GST_STATE_NULL);
+        completion(error);
+    });
+}
+
+@end
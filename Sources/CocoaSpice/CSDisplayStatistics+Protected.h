@@ -0,0 +1,42 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayStatistics.h"
+
+/// Monotonic timestamp in nanoseconds to pass to the `since:` methods
+uint64_t cs_display_statistics_now(void);
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface CSDisplayStatistics ()
+
+- (void)recordFrameReceived;
+- (void)recordFrameMerged;
+- (void)recordFrameDropped;
+- (void)recordAckWaitedForPresent;
+
+/// Count a presented frame and sample its `kCSDisplayLatencyPresent`
+/// @param timestamp When the frame arrived, from `cs_display_statistics_now()`
+- (void)recordFramePresentedSince:(uint64_t)timestamp;
+
+/// Sample a stage's latency
+/// @param latency Stage that just completed
+/// @param timestamp When the frame arrived, from `cs_display_statistics_now()`
+- (void)recordLatency:(CSDisplayLatency)latency since:(uint64_t)timestamp;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,199 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayStatistics+Protected.h"
+#import <stdlib.h>
+#import <time.h>
+
+#define kCSDisplayLatencyCount (kCSDisplayLatencyDrawDone + 1)
+
+uint64_t cs_display_statistics_now(void) {
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+typedef struct {
+    uint64_t samples[kCSDisplayStatisticsSampleCount];
+    NSUInteger next;
+    NSUInteger count;
+} CSLatencyRing;
+
+static int cs_compare_samples(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+@implementation CSDisplayStatistics {
+    CSLatencyRing _rings[kCSDisplayLatencyCount];
+    uint64_t _framesReceived;
+    uint64_t _framesPresented;
+    uint64_t _framesMerged;
+    uint64_t _framesDropped;
+    uint64_t _acksWaitedForPresent;
+}
+
+#pragma mark - Properties
+
+- (uint64_t)framesReceived {
+    @synchronized (self) {
+        return _framesReceived;
+    }
+}
+
+- (uint64_t)framesPresented {
+    @synchronized (self) {
+        return _framesPresented;
+    }
+}
+
+- (uint64_t)framesMerged {
+    @synchronized (self) {
+        return _framesMerged;
+    }
+}
+
+- (uint64_t)framesDropped {
+    @synchronized (self) {
+        return _framesDropped;
+    }
+}
+
+- (uint64_t)acksWaitedForPresent {
+    @synchronized (self) {
+        return _acksWaitedForPresent;
+    }
+}
+
+#pragma mark - Recording
+
+- (void)recordFrameReceived {
+    @synchronized (self) {
+        _framesReceived++;
+    }
+}
+
+- (void)recordFrameMerged {
+    @synchronized (self) {
+        _framesMerged++;
+    }
+}
+
+- (void)recordFrameDropped {
+    @synchronized (self) {
+        _framesDropped++;
+    }
+}
+
+- (void)recordAckWaitedForPresent {
+    @synchronized (self) {
+        _acksWaitedForPresent++;
+    }
+}
+
+- (void)recordFramePresentedSince:(uint64_t)timestamp {
+    @synchronized (self) {
+        _framesPresented++;
+        [self recordLatency:kCSDisplayLatencyPresent since:timestamp];
+    }
+}
+
+- (void)recordLatency:(CSDisplayLatency)latency since:(uint64_t)timestamp {
+    uint64_t now = cs_display_statistics_now();
+    NSAssert(latency >= 0 && latency < kCSDisplayLatencyCount, @"invalid latency %ld", (long)latency);
+    @synchronized (self) {
+        CSLatencyRing *ring = &_rings[latency];
+        ring->samples[ring->next] = now > timestamp ? now - timestamp : 0;
+        ring->next = (ring->next + 1) % kCSDisplayStatisticsSampleCount;
+        ring->count = MIN(ring->count + 1, kCSDisplayStatisticsSampleCount);
+    }
+}
+
+#pragma mark - Queries
+
+- (NSUInteger)sampleCountForLatency:(CSDisplayLatency)latency {
+    NSAssert(latency >= 0 && latency < kCSDisplayLatencyCount, @"invalid latency %ld", (long)latency);
+    @synchronized (self) {
+        return _rings[latency].count;
+    }
+}
+
+/// Sort a copy of the samples so several percentiles can be read from one snapshot
+- (NSUInteger)sortedSamples:(uint64_t *)sorted forLatency:(CSDisplayLatency)latency {
+    NSUInteger count;
+    @synchronized (self) {
+        count = _rings[latency].count;
+        memcpy(sorted, _rings[latency].samples, count * sizeof(uint64_t));
+    }
+    qsort(sorted, count, sizeof(uint64_t), cs_compare_samples);
+    return count;
+}
+
+/// Nearest rank percentile
+static NSTimeInterval cs_percentile(const uint64_t *sorted, NSUInteger count, double percentile) {
+    if (count == 0) {
+        return 0;
+    }
+    percentile = MAX(0, MIN(percentile, 100));
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100 * count);
+    return sorted[rank > 0 ? rank - 1 : 0] / (double)NSEC_PER_SEC;
+}
+
+- (NSTimeInterval)latency:(CSDisplayLatency)latency atPercentile:(double)percentile {
+    uint64_t sorted[kCSDisplayStatisticsSampleCount];
+    NSAssert(latency >= 0 && latency < kCSDisplayLatencyCount, @"invalid latency %ld", (long)latency);
+    NSUInteger count = [self sortedSamples:sorted forLatency:latency];
+    return cs_percentile(sorted, count, percentile);
+}
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation {
+    static NSString * const names[kCSDisplayLatencyCount] = {
+        [kCSDisplayLatencyUpload] = @"uploadLatency",
+        [kCSDisplayLatencyPresent] = @"presentLatency",
+        [kCSDisplayLatencyDrawDone] = @"drawDoneLatency",
+    };
+    uint64_t sorted[kCSDisplayStatisticsSampleCount];
+    NSMutableDictionary<NSString *, id> *dict = [NSMutableDictionary dictionary];
+    @synchronized (self) {
+        dict[@"framesReceived"] = @(_framesReceived);
+        dict[@"framesPresented"] = @(_framesPresented);
+        dict[@"framesMerged"] = @(_framesMerged);
+        dict[@"framesDropped"] = @(_framesDropped);
+        dict[@"acksWaitedForPresent"] = @(_acksWaitedForPresent);
+    }
+    for (CSDisplayLatency latency = 0; latency < kCSDisplayLatencyCount; latency++) {
+        NSUInteger count = [self sortedSamples:sorted forLatency:latency];
+        dict[names[latency]] = @{
+            @"count": @(count),
+            @"p50": @(cs_percentile(sorted, count, 50)),
+            @"p95": @(cs_percentile(sorted, count, 95)),
+            @"p99": @(cs_percentile(sorted, count, 99)),
+        };
+    }
+    return dict;
+}
+
+- (void)reset {
+    @synchronized (self) {
+        memset(_rings, 0, sizeof(_rings));
+        _framesReceived = 0;
+        _framesPresented = 0;
+        _framesMerged = 0;
+        _framesDropped = 0;
+        _acksWaitedForPresent = 0;
+    }
+}
+
+@end
@@ -0,0 +1,66 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import CoreGraphics;
+@import CocoaSpiceRenderer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Small copy of a display kept up to date from its damage
+///
+/// Drawing only resamples the part of the thumbnail a damaged rectangle covers, see
+/// `cs_downscale_to_bgra8`. Every draw stamps the thumbnail with a new generation, so a
+/// caller polling many displays can tell which ones changed without looking at any pixels.
+@interface CSDisplayThumbnail : NSObject
+
+/// Width in pixels
+@property (nonatomic, readonly) NSUInteger width;
+
+/// Height in pixels
+@property (nonatomic, readonly) NSUInteger height;
+
+/// Size of what the thumbnail is of
+@property (nonatomic, readonly) CGSize sourceSize;
+
+/// Generation of the last draw
+@property (atomic, readonly) uint64_t generation;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Create a black thumbnail
+/// @param maximumWidth Width to scale down to, sources narrower than this are kept at their size
+/// @param sourceSize Size of what the thumbnail is of
+/// @param generation Generation of the black thumbnail
+- (instancetype)initWithMaximumWidth:(NSUInteger)maximumWidth sourceSize:(CGSize)sourceSize generation:(uint64_t)generation NS_DESIGNATED_INITIALIZER;
+
+/// Resample the part of the thumbnail covering a rectangle of the source
+/// @param rect Damaged rectangle, relative to the source
+/// @param pixels Start of the source
+/// @param bytesPerRow Stride of the source
+/// @param format Pixel layout of the source
+/// @param generation Generation of the thumbnail once drawn, larger than any before it
+- (void)drawRect:(CGRect)rect fromPixels:(const void *)pixels bytesPerRow:(NSUInteger)bytesPerRow format:(CSDownscaleSource)format generation:(uint64_t)generation;
+
+/// Make an image of the thumbnail as it is now
+///
+/// The image is only made once per generation, every call in between returns the same one.
+/// @param generation Set to the generation of the image returned
+- (nullable CGImageRef)copyImageWithGeneration:(nullable uint64_t *)generation CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,91 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSDisplayThumbnail.h"
+
+@implementation CSDisplayThumbnail {
+    NSMutableData *_pixels;
+    NSUInteger _bytesPerRow;
+    // image of the current generation, made on demand
+    CGImageRef _image;
+}
+
+- (instancetype)initWithMaximumWidth:(NSUInteger)maximumWidth sourceSize:(CGSize)sourceSize generation:(uint64_t)generation {
+    if (self = [super init]) {
+        NSUInteger sourceWidth = MAX(sourceSize.width, 1);
+        NSUInteger sourceHeight = MAX(sourceSize.height, 1);
+        _sourceSize = sourceSize;
+        _width = MAX(MIN(maximumWidth, sourceWidth), 1);
+        _height = MAX((sourceHeight * _width + sourceWidth / 2) / sourceWidth, 1);
+        _bytesPerRow = _width * 4;
+        _pixels = [NSMutableData dataWithLength:_bytesPerRow * _height];
+        _generation = generation;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CGImageRelease(_image);
+}
+
+- (void)drawRect:(CGRect)rect fromPixels:(const void *)pixels bytesPerRow:(NSUInteger)bytesPerRow format:(CSDownscaleSource)format generation:(uint64_t)generation {
+    rect = CGRectIntersection(CGRectIntegral(rect), CGRectMake(0, 0, _sourceSize.width, _sourceSize.height));
+    if (CGRectIsEmpty(rect)) {
+        return;
+    }
+    @synchronized (self) {
+        cs_downscale_to_bgra8(_pixels.mutableBytes, _bytesPerRow, _width, _height,
+                              pixels, bytesPerRow, _sourceSize.width, _sourceSize.height, format,
+                              rect.origin.x, rect.origin.y, rect.size.width, rect.size.height);
+        CGImageRelease(_image);
+        _image = NULL;
+        _generation = generation;
+    }
+}
+
+- (uint64_t)generation {
+    @synchronized (self) {
+        return _generation;
+    }
+}
+
+- (CGImageRef)copyImageWithGeneration:(uint64_t *)generation {
+    @synchronized (self) {
+        if (!_image) {
+            CGDataProviderRef dataProviderRef = CGDataProviderCreateWithCFData((__bridge CFDataRef)[_pixels copy]);
+            CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+            _image = CGImageCreate(_width,
+                                   _height,
+                                   8,
+                                   32,
+                                   _bytesPerRow,
+                                   colorSpaceRef,
+                                   kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst,
+                                   dataProviderRef,
+                                   NULL,
+                                   NO,
+                                   kCGRenderingIntentDefault);
+            CGDataProviderRelease(dataProviderRef);
+            CGColorSpaceRelease(colorSpaceRef);
+        }
+        if (generation) {
+            *generation = _generation;
+        }
+        return CGImageRetain(_image);
+    }
+}
+
+@end
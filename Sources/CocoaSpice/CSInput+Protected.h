@@ -19,6 +19,8 @@
 typedef struct _SpiceInputsChannel SpiceInputsChannel;
 typedef struct _SpiceMainChannel SpiceMainChannel;
 
+@class CSConnection;
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface CSInput ()
@@ -31,6 +33,11 @@ NS_ASSUME_NONNULL_BEGIN
 /// This must be set before server/client mode switching can occur
 @property (nonatomic, readwrite, nullable) SpiceMainChannel *spiceMain;
 
+/// Connection this input belongs to
+///
+/// Used to find the cursor to move ahead of the guest in client mouse mode.
+@property (nonatomic, weak, nullable) CSConnection *connection;
+
 /// Create a new input for a SPICE inputs channel
 /// @param channel SPICE inputs channel
 - (instancetype)initWithChannel:(SpiceInputsChannel *)channel NS_DESIGNATED_INITIALIZER;
@@ -16,6 +16,7 @@
 
 #import "CSInput.h"
 #import "CSChannel+Protected.h"
+#import "CSCursor+Protected.h"
 #import "CocoaSpice.h"
 #import <glib.h>
 #import <spice-client.h>
@@ -252,10 +253,22 @@ static int cs_button_to_spice(CSInputButton button)
         } else {
             spice_inputs_channel_position(self.channel, absolutePoint.x, absolutePoint.y, (int)monitorID,
                                           cs_button_mask_to_spice(buttonMask));
+            // show it now rather than after the round trip
+            [[self cursorForMonitorID:monitorID] predictPosition:absolutePoint];
         }
     }];
 }
 
+/// Must be called on the SPICE thread
+- (nullable CSCursor *)cursorForMonitorID:(NSInteger)monitorID {
+    for (CSChannel *channel in self.connection.channels) {
+        if ([channel isKindOfClass:CSCursor.class] && channel.channelID == monitorID) {
+            return (CSCursor *)channel;
+        }
+    }
+    return nil;
+}
+
 - (void)sendMousePosition:(CSInputButton)buttonMask absolutePoint:(CGPoint)absolutePoint {
     [self sendMousePosition:buttonMask absolutePoint:absolutePoint forMonitorID:0];
 }
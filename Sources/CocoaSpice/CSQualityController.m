@@ -0,0 +1,318 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSQualityController+Protected.h"
+#import "CocoaSpice.h"
+#import "CSChannel+Protected.h"
+#import "CSDisplay+Protected.h"
+#import "CSDisplayStatistics+Protected.h"
+#import "CSSession+Protected.h"
+#import <glib.h>
+#import <spice-client.h>
+
+// How often the controller samples and decides, in milliseconds
+static const guint kCSQualitySampleInterval = 1000;
+// Share of the peak throughput kept each sample, so a quiet link only slowly lowers it
+static const double kCSQualityPeakDecay = 0.9;
+// Throughput at this share of the peak counts as a saturated link
+static const double kCSQualitySaturation = 0.8;
+// Samples over target in a row before acting, so one slow frame does not flip the encoding
+static const NSUInteger kCSQualityOverTargetSamples = 2;
+// Budget change when over target, down for the network and up for decoding
+static const double kCSQualityBackoff = 0.7;
+// Share of the distance to the peak the budget recovers each sample under half the target
+static const double kCSQualityRecovery = 0.25;
+// Budget bounds in bytes per second
+static const double kCSQualityMinimumBudget = 64 * 1024;
+static const double kCSQualityMaximumBudget = 128 * 1024 * 1024;
+// Frame loss rate that counts as over target whatever the latency
+static const double kCSQualityMaximumLoss = 0.1;
+// Playback delay bounds in milliseconds
+static const uint32_t kCSQualityMinimumPlaybackDelay = 20;
+static const uint32_t kCSQualityMaximumPlaybackDelay = 500;
+
+@interface CSQualitySample ()
+
+@property (nonatomic, readwrite) NSTimeInterval interval;
+@property (nonatomic, readwrite) double displayBandwidth;
+@property (nonatomic, readwrite) double audioBandwidth;
+@property (nonatomic, readwrite) double peakBandwidth;
+@property (nonatomic, readwrite) NSTimeInterval frameLatency;
+@property (nonatomic, readwrite) double frameLossRate;
+@property (nonatomic, readwrite) BOOL isNetworkBound;
+@property (nonatomic, readwrite) double bandwidthBudget;
+@property (nonatomic, readwrite) CSDisplayImageCompression imageCompression;
+@property (nonatomic, readwrite, copy) NSArray<NSNumber *> *videoCodecs;
+@property (nonatomic, readwrite) uint32_t playbackDelay;
+
+@end
+
+@implementation CSQualitySample
+
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation {
+    return @{
+        @"interval": @(self.interval),
+        @"displayBandwidth": @(self.displayBandwidth),
+        @"audioBandwidth": @(self.audioBandwidth),
+        @"peakBandwidth": @(self.peakBandwidth),
+        @"frameLatency": @(self.frameLatency),
+        @"frameLossRate": @(self.frameLossRate),
+        @"isNetworkBound": @(self.isNetworkBound),
+        @"bandwidthBudget": @(self.bandwidthBudget),
+        @"imageCompression": @(self.imageCompression),
+        @"videoCodecs": self.videoCodecs,
+        @"playbackDelay": @(self.playbackDelay),
+    };
+}
+
+@end
+
+@interface CSQualityController ()
+
+@property (nonatomic, weak, readwrite) CSConnection *connection;
+@property (atomic, nullable, readwrite) CSQualitySample *latestSample;
+
+@end
+
+@implementation CSQualityController {
+    // Everything below is only touched on the SPICE thread
+    GSource *_timer;
+    uint64_t _lastSampleAt;
+    // Counters at the last sample, keyed weakly so displays can come and go
+    NSMapTable<CSDisplay *, NSNumber *> *_lastReadBytes;
+    NSMapTable<CSDisplay *, NSNumber *> *_lastFramesReceived;
+    NSMapTable<CSDisplay *, NSNumber *> *_lastFramesLost;
+    NSNumber *_lastPlaybackReadBytes;
+    double _peakBandwidth;
+    double _budget;
+    NSUInteger _overTargetSamples;
+    uint32_t _playbackDelay;
+}
+
+@synthesize isEnabled = _isEnabled;
+
+static gboolean cs_quality_sample(gpointer data) {
+    CSQualityController *self = (__bridge CSQualityController *)data;
+
+    g_assert(CSMain.sharedInstance.isCurrentContextMain);
+    [self sample];
+    return G_SOURCE_CONTINUE;
+}
+
+/// Bytes read by a channel since its total was `previous`, the new total goes in `total`
+static double cs_read_bytes_since(SpiceChannel *channel, NSNumber *previous, gulong *total) {
+    *total = 0;
+    g_object_get(channel, "total-read-bytes", total, NULL);
+    // the counter starts over when the channel reconnects
+    if (!previous || *total < previous.unsignedLongValue) {
+        return 0;
+    }
+    return *total - previous.unsignedLongValue;
+}
+
+#pragma mark - Properties
+
+- (BOOL)isEnabled {
+    @synchronized (self) {
+        return _isEnabled;
+    }
+}
+
+- (void)setIsEnabled:(BOOL)isEnabled {
+    @synchronized (self) {
+        if (_isEnabled == isEnabled) {
+            return;
+        }
+        _isEnabled = isEnabled;
+    }
+    [CSMain.sharedInstance asyncWith:^{
+        if (isEnabled) {
+            [self start];
+        } else {
+            [self stop];
+        }
+    }];
+}
+
+#pragma mark - Methods
+
+- (instancetype)initWithConnection:(CSConnection *)connection {
+    if (self = [super init]) {
+        _connection = connection;
+        _targetFrameLatency = 0.050;
+        _lastReadBytes = [NSMapTable weakToStrongObjectsMapTable];
+        _lastFramesReceived = [NSMapTable weakToStrongObjectsMapTable];
+        _lastFramesLost = [NSMapTable weakToStrongObjectsMapTable];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    GSource *timer = _timer;
+    if (timer) {
+        [CSMain.sharedInstance syncWith:^{
+            g_source_destroy(timer);
+            g_source_unref(timer);
+        }];
+    }
+}
+
+/// Must be called on the SPICE thread
+- (void)start {
+    if (_timer) {
+        return;
+    }
+    _lastSampleAt = 0;
+    _peakBandwidth = 0;
+    _budget = 0;
+    _overTargetSamples = 0;
+    _playbackDelay = 0;
+    [_lastReadBytes removeAllObjects];
+    [_lastFramesReceived removeAllObjects];
+    [_lastFramesLost removeAllObjects];
+    _lastPlaybackReadBytes = nil;
+    _timer = g_timeout_source_new(kCSQualitySampleInterval);
+    g_source_set_callback(_timer, cs_quality_sample, (__bridge void *)self, NULL);
+    g_source_attach(_timer, CSMain.sharedInstance.glibMainContext);
+    // record the starting counters
+    [self sample];
+}
+
+/// Must be called on the SPICE thread
+- (void)stop {
+    if (_timer) {
+        g_source_destroy(_timer);
+        g_source_unref(_timer);
+        _timer = NULL;
+    }
+}
+
+/// Must be called on the SPICE thread
+- (void)sample {
+    CSConnection *connection = self.connection;
+    uint64_t now = cs_display_statistics_now();
+    double displayBytes = 0;
+    double audioBytes = 0;
+    NSTimeInterval frameLatency = 0;
+    uint64_t framesReceived = 0;
+    uint64_t framesLost = 0;
+    NSMutableArray<CSDisplay *> *displays = [NSMutableArray array];
+
+    for (CSChannel *channel in connection.channels) {
+        if (![channel isKindOfClass:CSDisplay.class]) {
+            continue;
+        }
+        CSDisplay *display = (CSDisplay *)channel;
+        CSDisplayStatistics *statistics = display.statistics;
+        uint64_t received = statistics.framesReceived;
+        uint64_t lost = statistics.framesMerged + statistics.framesDropped;
+        NSNumber *lastReceived = [_lastFramesReceived objectForKey:display];
+        NSNumber *lastLost = [_lastFramesLost objectForKey:display];
+        [_lastFramesReceived setObject:@(received) forKey:display];
+        [_lastFramesLost setObject:@(lost) forKey:display];
+        gulong readBytes;
+        displayBytes += cs_read_bytes_since(display.spiceChannel, [_lastReadBytes objectForKey:display], &readBytes);
+        [_lastReadBytes setObject:@(readBytes) forKey:display];
+        [displays addObject:display];
+        if (!lastReceived || received <= lastReceived.unsignedLongLongValue) {
+            // an idle display has only stale latencies to offer
+            continue;
+        }
+        framesReceived += received - lastReceived.unsignedLongLongValue;
+        framesLost += lost - MIN(lost, lastLost.unsignedLongLongValue);
+        frameLatency = MAX(frameLatency, [statistics latency:kCSDisplayLatencyPresent atPercentile:95]);
+    }
+    GList *channels = connection.session.session ? spice_session_get_channels(connection.session.session) : NULL;
+    SpicePlaybackChannel *playback = NULL;
+    for (GList *l = channels; l != NULL; l = l->next) {
+        if (SPICE_IS_PLAYBACK_CHANNEL(l->data)) {
+            gulong readBytes;
+            playback = SPICE_PLAYBACK_CHANNEL(l->data);
+            audioBytes = cs_read_bytes_since(SPICE_CHANNEL(playback), _lastPlaybackReadBytes, &readBytes);
+            _lastPlaybackReadBytes = @(readBytes);
+            break;
+        }
+    }
+    g_list_free(channels);
+
+    uint64_t lastSampleAt = _lastSampleAt;
+    _lastSampleAt = now;
+    if (lastSampleAt == 0) {
+        return;
+    }
+    NSTimeInterval interval = (now - lastSampleAt) / (double)NSEC_PER_SEC;
+    double bandwidth = (displayBytes + audioBytes) / interval;
+    double lossRate = framesReceived > 0 ? (double)framesLost / framesReceived : 0;
+    NSTimeInterval target = self.targetFrameLatency;
+    BOOL networkBound = bandwidth >= kCSQualitySaturation * _peakBandwidth && bandwidth > 0;
+
+    _peakBandwidth = MAX(bandwidth, _peakBandwidth * kCSQualityPeakDecay);
+    if (_budget == 0) {
+        _budget = MAX(_peakBandwidth, kCSQualityMinimumBudget);
+    }
+    if (frameLatency > target || lossRate > kCSQualityMaximumLoss) {
+        if (++_overTargetSamples >= kCSQualityOverTargetSamples) {
+            if (networkBound) {
+                // the link is full, ask for fewer bytes
+                _budget = MIN(_budget, bandwidth) * kCSQualityBackoff;
+            } else {
+                // the link has room, so decoding is what takes the time
+                _budget /= kCSQualityBackoff;
+            }
+            _overTargetSamples = 0;
+        }
+    } else {
+        _overTargetSamples = 0;
+        if (frameLatency < target / 2) {
+            _budget += (_peakBandwidth - _budget) * kCSQualityRecovery;
+        }
+    }
+    _budget = MAX(kCSQualityMinimumBudget, MIN(_budget, kCSQualityMaximumBudget));
+
+    CSDisplayImageCompression compression = [CSDisplay imageCompressionForBandwidth:_budget];
+    NSArray<NSNumber *> *codecs = [CSDisplay videoCodecsForBandwidth:_budget];
+    for (CSDisplay *display in displays) {
+        if (display.preferredImageCompression != compression) {
+            display.preferredImageCompression = compression;
+        }
+        if (![display.preferredVideoCodecs isEqualToArray:codecs]) {
+            display.preferredVideoCodecs = codecs;
+        }
+    }
+
+    // audio waits for video to reach the screen, so the server keeps both in step
+    uint32_t delay = (uint32_t)MAX(kCSQualityMinimumPlaybackDelay, MIN(frameLatency * 1000, kCSQualityMaximumPlaybackDelay));
+    if (playback && delay != _playbackDelay) {
+        spice_playback_channel_set_delay(playback, delay);
+        _playbackDelay = delay;
+    }
+
+    CSQualitySample *sample = [[CSQualitySample alloc] init];
+    sample.interval = interval;
+    sample.displayBandwidth = displayBytes / interval;
+    sample.audioBandwidth = audioBytes / interval;
+    sample.peakBandwidth = _peakBandwidth;
+    sample.frameLatency = frameLatency;
+    sample.frameLossRate = lossRate;
+    sample.isNetworkBound = networkBound;
+    sample.bandwidthBudget = _budget;
+    sample.imageCompression = compression;
+    sample.videoCodecs = codecs;
+    sample.playbackDelay = _playbackDelay;
+    self.latestSample = sample;
+}
+
+@end
@@ -14,10 +14,73 @@
 // limitations under the License.
 //
 
+@import ImageIO;
 #import "TargetConditionals.h"
 #import "CSScreenshot.h"
 
-@implementation CSScreenshot
+@implementation CSScreenshot {
+    CGImageRef _cgImage;
+}
+
+static CFStringRef cs_screenshot_type(CSScreenshotFormat format) {
+    switch (format) {
+        case kCSScreenshotFormatJPEG:
+            return CFSTR("public.jpeg");
+        case kCSScreenshotFormatPNG:
+        default:
+            return CFSTR("public.png");
+    }
+}
+
+- (void)dealloc {
+    CGImageRelease(_cgImage);
+}
+
+- (CGImageRef)cgImage {
+    if (_cgImage) {
+        return _cgImage;
+    }
+#if TARGET_OS_IPHONE
+    return self.image.CGImage;
+#else
+    return [self.image CGImageForProposedRect:NULL context:nil hints:nil];
+#endif
+}
+
+- (BOOL)encodeToDestination:(CGImageDestinationRef)destination quality:(CGFloat)quality {
+    CGImageRef image = self.cgImage;
+    if (!image) {
+        return NO;
+    }
+    NSDictionary *properties = @{(__bridge NSString *)kCGImageDestinationLossyCompressionQuality: @(quality)};
+    CGImageDestinationAddImage(destination, image, (__bridge CFDictionaryRef)properties);
+    return CGImageDestinationFinalize(destination);
+}
+
+- (NSData *)dataWithFormat:(CSScreenshotFormat)format quality:(CGFloat)quality {
+    NSMutableData *data = [NSMutableData data];
+    CGImageDestinationRef destination = CGImageDestinationCreateWithData((__bridge CFMutableDataRef)data, cs_screenshot_type(format), 1, NULL);
+    if (!destination) {
+        return nil;
+    }
+    BOOL success = [self encodeToDestination:destination quality:quality];
+    CFRelease(destination);
+    return success ? data : nil;
+}
+
+- (BOOL)writeToURL:(NSURL *)url format:(CSScreenshotFormat)format quality:(CGFloat)quality {
+    CGImageDestinationRef destination = CGImageDestinationCreateWithURL((__bridge CFURLRef)url, cs_screenshot_type(format), 1, NULL);
+    if (!destination) {
+        return NO;
+    }
+    BOOL success = [self encodeToDestination:destination quality:quality];
+    CFRelease(destination);
+    return success;
+}
+
+- (void)writeToURL:(NSURL *)url atomically:(BOOL)atomically {
+    [[self dataWithFormat:kCSScreenshotFormatPNG quality:1.0] writeToURL:url atomically:atomically];
+}
 
 #if TARGET_OS_IPHONE
 - (instancetype)initWithImage:(UIImage *)image {
@@ -36,8 +99,11 @@
     }
 }
 
-- (void)writeToURL:(NSURL *)url atomically:(BOOL)atomically {
-    [UIImagePNGRepresentation(_image) writeToURL:url atomically:atomically];
+- (instancetype)initWithCGImage:(CGImageRef)image {
+    if (self = [self initWithImage:[UIImage imageWithCGImage:image]]) {
+        _cgImage = CGImageRetain(image);
+    }
+    return self;
 }
 #else
 - (instancetype)initWithImage:(NSImage *)image {
@@ -52,14 +118,11 @@
     return [self initWithImage:image];
 }
 
-- (void)writeToURL:(NSURL *)url atomically:(BOOL)atomically {
-    CGImageRef cgRef = [self.image CGImageForProposedRect:NULL
-                                                  context:nil
-                                                    hints:nil];
-    NSBitmapImageRep *newRep = [[NSBitmapImageRep alloc] initWithCGImage:cgRef];
-    [newRep setSize:[self.image size]];   // if you want the same resolution
-    NSData *pngData = [newRep representationUsingType:NSBitmapImageFileTypePNG properties:@{}];
-    [pngData writeToURL:url atomically:atomically];
+- (instancetype)initWithCGImage:(CGImageRef)image {
+    if (self = [self initWithImage:[[NSImage alloc] initWithCGImage:image size:NSZeroSize]]) {
+        _cgImage = CGImageRetain(image);
+    }
+    return self;
 }
 #endif
 
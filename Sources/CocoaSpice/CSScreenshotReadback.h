@@ -0,0 +1,90 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import CoreGraphics;
+@import Metal;
+
+@class CSScreenshotBuffer;
+@class CSScreenshotReadback;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Receives a frame copied into a readback buffer, or a nil buffer if the copy failed
+typedef void (^captureCallback_t)(CSScreenshotBuffer * _Nullable buffer, NSUInteger width, NSUInteger height, NSUInteger bytesPerRow, MTLPixelFormat pixelFormat);
+
+/// Page aligned memory a screenshot is copied into
+@interface CSScreenshotBuffer : NSObject
+
+/// Start of the memory
+@property (nonatomic, readonly) void *bytes;
+
+/// Size of the memory in bytes
+@property (nonatomic, readonly) NSUInteger length;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The same memory as a Metal buffer, so the GPU can copy a texture into it
+/// @param device Device to copy on
+- (nullable id<MTLBuffer>)metalBufferForDevice:(id<MTLDevice>)device;
+
+/// Hand the buffer back to its readback, it must not be used after this
+- (void)recycle;
+
+/// Make an image of the pixels in the buffer without copying them
+///
+/// The buffer goes back to its readback once the image is released. When no image could
+/// be made it is still the caller's to recycle.
+/// @param width Width in pixels
+/// @param height Height in pixels
+/// @param bytesPerRow Stride of the pixels
+/// @param pixelFormat Either `MTLPixelFormatBGRA8Unorm` or `MTLPixelFormatRGBA8Unorm`, alpha is ignored
+- (nullable CGImageRef)createImageWithWidth:(NSUInteger)width
+                                     height:(NSUInteger)height
+                                bytesPerRow:(NSUInteger)bytesPerRow
+                                pixelFormat:(MTLPixelFormat)pixelFormat CF_RETURNS_RETAINED;
+
+@end
+
+/// Buffers screenshots are copied into and the queue they are turned into images on
+///
+/// Taking a screenshot only copies pixels on the SPICE thread, everything else happens on
+/// `queue`. Buffers are recycled once the image made from them is released, so a display
+/// captured periodically keeps reusing the same memory rather than allocating a frame's
+/// worth every time.
+@interface CSScreenshotReadback : NSObject
+
+/// Serial queue images are made and encoded on
+@property (nonatomic, readonly) dispatch_queue_t queue;
+
+/// Create a readback keeping two free buffers
+- (instancetype)init;
+
+/// Create a readback
+/// @param freeBuffers Most free buffers kept for reuse, enough for every buffer expected in use at once
+- (instancetype)initWithFreeBuffers:(NSUInteger)freeBuffers NS_DESIGNATED_INITIALIZER;
+
+/// Get a buffer of at least `length` bytes, a free one if there is one large enough
+/// @param length Bytes needed
+- (nullable CSScreenshotBuffer *)bufferWithLength:(NSUInteger)length;
+
+/// Command queue for copies when the display has no renderer to submit them on
+/// @param device Device to copy on
+- (id<MTLCommandQueue>)commandQueueForDevice:(id<MTLDevice>)device;
+
+@end
+
+NS_ASSUME_NONNULL_END
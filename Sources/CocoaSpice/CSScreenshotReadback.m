@@ -0,0 +1,165 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSScreenshotReadback.h"
+#import <mach/vm_page_size.h>
+#import <stdlib.h>
+
+// Free buffers kept for the next screenshot by default, one per image that may be in flight
+static const NSUInteger kCSScreenshotReadbackFreeBuffers = 2;
+
+@interface CSScreenshotReadback ()
+
+- (void)recycleBuffer:(CSScreenshotBuffer *)buffer;
+
+@end
+
+@interface CSScreenshotBuffer ()
+
+@property (nonatomic, weak) CSScreenshotReadback *readback;
+@property (nonatomic, nullable) id<MTLBuffer> metalBuffer;
+
+@end
+
+@implementation CSScreenshotBuffer
+
+static void cs_screenshot_buffer_release(void *info, const void *data, size_t size) {
+    CSScreenshotBuffer *buffer = (__bridge_transfer CSScreenshotBuffer *)info;
+    [buffer recycle];
+}
+
+- (nullable instancetype)initWithLength:(NSUInteger)length readback:(CSScreenshotReadback *)readback {
+    if (self = [super init]) {
+        // page aligned so Metal can copy into it without another copy
+        _length = (length + vm_page_size - 1) & ~(vm_page_size - 1);
+        if (posix_memalign(&_bytes, vm_page_size, _length) != 0) {
+            return nil;
+        }
+        _readback = readback;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_bytes);
+}
+
+- (void)recycle {
+    [self.readback recycleBuffer:self];
+}
+
+- (nullable id<MTLBuffer>)metalBufferForDevice:(id<MTLDevice>)device {
+    @synchronized (self) {
+        if (self.metalBuffer.device != device) {
+            self.metalBuffer = [device newBufferWithBytesNoCopy:_bytes
+                                                         length:_length
+                                                        options:MTLResourceStorageModeShared
+                                                    deallocator:nil];
+        }
+        return self.metalBuffer;
+    }
+}
+
+- (nullable CGImageRef)createImageWithWidth:(NSUInteger)width
+                                     height:(NSUInteger)height
+                                bytesPerRow:(NSUInteger)bytesPerRow
+                                pixelFormat:(MTLPixelFormat)pixelFormat {
+    CGBitmapInfo bitmapInfo;
+    if (pixelFormat == MTLPixelFormatBGRA8Unorm) {
+        bitmapInfo = kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst;
+    } else if (pixelFormat == MTLPixelFormatRGBA8Unorm) {
+        bitmapInfo = kCGBitmapByteOrder32Big | kCGImageAlphaNoneSkipLast;
+    } else {
+        return NULL;
+    }
+    if (bytesPerRow * height > _length) {
+        return NULL;
+    }
+    CGDataProviderRef dataProviderRef = CGDataProviderCreateWithData((__bridge_retained void *)self,
+                                                                     _bytes,
+                                                                     bytesPerRow * height,
+                                                                     cs_screenshot_buffer_release);
+    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+    CGImageRef img = CGImageCreate(width,
+                                   height,
+                                   8,
+                                   32,
+                                   bytesPerRow,
+                                   colorSpaceRef,
+                                   bitmapInfo,
+                                   dataProviderRef,
+                                   NULL,
+                                   NO,
+                                   kCGRenderingIntentDefault);
+    CGDataProviderRelease(dataProviderRef);
+    CGColorSpaceRelease(colorSpaceRef);
+    return img;
+}
+
+@end
+
+@implementation CSScreenshotReadback {
+    NSMutableArray<CSScreenshotBuffer *> *_freeBuffers;
+    NSUInteger _maxFreeBuffers;
+    id<MTLCommandQueue> _commandQueue;
+}
+
+- (instancetype)init {
+    return [self initWithFreeBuffers:kCSScreenshotReadbackFreeBuffers];
+}
+
+- (instancetype)initWithFreeBuffers:(NSUInteger)freeBuffers {
+    if (self = [super init]) {
+        _queue = dispatch_queue_create("CSScreenshotReadback", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        _maxFreeBuffers = freeBuffers;
+        _freeBuffers = [NSMutableArray arrayWithCapacity:freeBuffers];
+    }
+    return self;
+}
+
+- (nullable CSScreenshotBuffer *)bufferWithLength:(NSUInteger)length {
+    @synchronized (_freeBuffers) {
+        for (NSUInteger i = 0; i < _freeBuffers.count; i++) {
+            CSScreenshotBuffer *buffer = _freeBuffers[i];
+            if (buffer.length >= length) {
+                [_freeBuffers removeObjectAtIndex:i];
+                return buffer;
+            }
+        }
+    }
+    return [[CSScreenshotBuffer alloc] initWithLength:length readback:self];
+}
+
+- (void)recycleBuffer:(CSScreenshotBuffer *)buffer {
+    @synchronized (_freeBuffers) {
+        [_freeBuffers insertObject:buffer atIndex:0];
+        if (_freeBuffers.count > _maxFreeBuffers) {
+            // the least recently used is likely the size of a resolution long gone
+            [_freeBuffers removeLastObject];
+        }
+    }
+}
+
+- (id<MTLCommandQueue>)commandQueueForDevice:(id<MTLDevice>)device {
+    @synchronized (self) {
+        if (_commandQueue.device != device) {
+            _commandQueue = [device newCommandQueue];
+        }
+        return _commandQueue;
+    }
+}
+
+@end
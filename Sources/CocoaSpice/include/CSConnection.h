@@ -19,6 +19,7 @@
 #import "CSChannel.h"
 
 @class CSDisplay;
+@class CSQualityController;
 @class CSUSBManager;
 
 NS_ASSUME_NONNULL_BEGIN
@@ -37,6 +38,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// USB forwarding options
 @property (nonatomic, readonly) CSUSBManager *usbManager;
 
+/// Adapts display encoding and audio delay to the link, disabled until its `isEnabled` is set
+@property (nonatomic, readonly) CSQualityController *qualityController;
+
 /// Delegate for handling connection events
 @property (nonatomic, weak, nullable) id<CSConnectionDelegate> delegate;
 
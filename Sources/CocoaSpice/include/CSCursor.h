@@ -37,6 +37,20 @@ NS_ASSUME_NONNULL_BEGIN
 /// Cursor is visible if it is not inhibited (by the host) and is not hidden (by the guest) and is drawn (by the guest)
 @property (nonatomic, readonly) BOOL isVisible;
 
+/// Number of cursor shapes uploaded to the GPU
+///
+/// Recently seen shapes are cached, so a guest switching back to one of them does not add to this.
+@property (nonatomic, readonly) NSUInteger shapeUploadCount;
+
+/// Draw the cursor where the client last sent the mouse, without waiting for the guest to echo it back, defaults to YES
+///
+/// Only applies in client mouse mode, where positions are absolute. The cursor then keeps up
+/// with the pointer however slow the link is. Positions the guest reports that we predicted
+/// are ignored, others (such as the guest warping the cursor) are drawn as usual.
+///
+/// Can be set from any thread, it is read on the SPICE thread.
+@property (atomic, assign) BOOL predictsPosition;
+
 - (instancetype)init NS_UNAVAILABLE;
 
 /// Set the cursor to a new location (only appliable if client side cursor rendering is in use)
@@ -16,20 +16,51 @@
 
 #import <Foundation/Foundation.h>
 #import "CSChannel.h"
+#import "CSScreenshot.h"
 @import CoreGraphics;
 @import CocoaSpiceRenderer;
 
 @class CSCursor;
-@class CSScreenshot;
+@class CSDisplayMonitor;
+@class CSDisplayStatistics;
 
 typedef void (^screenshotCallback_t)(CSScreenshot * _Nullable);
+typedef void (^recordingCallback_t)(NSError * _Nullable);
+
+/// Upper bound for `CSDisplay.maxCanvasUploadsInFlight`
+enum { kCSDisplayMaxCanvasUploadsInFlight = 3 };
+
+/// Image compression the server uses for display updates, same values as `SpiceImageCompression`
+typedef NS_ENUM(NSInteger, CSDisplayImageCompression) {
+    /// Whatever the server is configured with
+    kCSDisplayImageCompressionDefault = 0,
+    kCSDisplayImageCompressionOff,
+    /// GLZ or QUIC picked per image by the server
+    kCSDisplayImageCompressionAutoGLZ,
+    /// LZ or QUIC picked per image by the server
+    kCSDisplayImageCompressionAutoLZ,
+    kCSDisplayImageCompressionQuic,
+    kCSDisplayImageCompressionGLZ,
+    kCSDisplayImageCompressionLZ,
+    kCSDisplayImageCompressionLZ4,
+};
+
+/// Codec the server streams video regions with, same values as `SpiceVideoCodecType`
+typedef NS_ENUM(NSInteger, CSDisplayVideoCodec) {
+    kCSDisplayVideoCodecMJPEG = 1,
+    kCSDisplayVideoCodecVP8,
+    kCSDisplayVideoCodecH264,
+    kCSDisplayVideoCodecVP9,
+    kCSDisplayVideoCodecH265,
+};
 
 NS_ASSUME_NONNULL_BEGIN
 
 /// Handles display rendering and resolution
 ///
 /// This implements the `CSRenderSource` protocol which can be used to render to a Metal device.
-/// Note: multiple monitors on a single display channel is not supported.
+/// When the channel has several monitors, the display presents the first one and
+/// `secondaryMonitors` the others, all cropped from the same texture.
 @interface CSDisplay : CSChannel <CSRenderSource>
 
 /// The current size of the display.
@@ -47,12 +78,94 @@ NS_ASSUME_NONNULL_BEGIN
 ///
 /// The id starts at 0 up to the number of heads in the first QXL device.
 /// Next, it will increment by 1 for each additional display channel.
-/// Note currently we only support 1 head per QXL device.
+/// Further heads of the same QXL device are in `secondaryMonitors`.
 @property (nonatomic, readonly) NSInteger monitorID;
 
+/// Heads of this display channel after the first, which the display itself presents
+///
+/// You can add an observer on this property to detect when heads come and go.
+@property (atomic, readonly) NSArray<CSDisplayMonitor *> *secondaryMonitors;
+
 /// If false, this display will not be used
 @property (nonatomic) BOOL isEnabled;
 
+/// Bytes of the non-GL canvas changed by the server, not counting changes already pending upload
+///
+/// Compare with `canvasBytesUploaded` to see how much merging damage rectangles costs.
+@property (nonatomic, readonly) uint64_t canvasBytesDamaged;
+
+/// Bytes of the non-GL canvas copied to the GPU
+@property (nonatomic, readonly) uint64_t canvasBytesUploaded;
+
+/// True if the GPU reads the non-GL canvas straight from memory SPICE draws into
+///
+/// This is the case on unified memory, where updates need no synchronisation at all. Otherwise
+/// each damaged rectangle is marked modified with a single range before it is copied.
+@property (nonatomic, readonly) BOOL canvasUsesSharedStorage;
+
+/// Number of GL scanout surfaces wrapped in a texture
+///
+/// Recently used scanouts are cached, so a guest flipping between a few buffers does
+/// not add to this once it has shown each of them.
+@property (nonatomic, readonly) uint64_t scanoutTextureCount;
+
+/// How many non-GL canvas uploads may be queued to the renderer before new damage has to wait
+///
+/// With more than one, damage decoded while the previous upload is still on its way to
+/// the screen goes out right away instead of waiting for it to complete. Clamped to
+/// between 1 and `kCSDisplayMaxCanvasUploadsInFlight`, defaults to 2.
+@property (atomic) NSUInteger maxCanvasUploadsInFlight;
+
+/// Number of non-GL canvas uploads submitted with 1, 2, ... `kCSDisplayMaxCanvasUploadsInFlight` in flight
+///
+/// Element `i` counts uploads that were submitted while `i + 1` uploads (including itself) were in flight.
+@property (nonatomic, readonly) NSArray<NSNumber *> *canvasUploadsInFlightHistogram;
+
+/// Frame timing for this display, from a frame arriving from the server to it being drawn
+@property (nonatomic, readonly) CSDisplayStatistics *statistics;
+
+/// Image compression the server is asked to use for this display
+///
+/// Sent as soon as the server says it takes preferences and again whenever the display
+/// reconnects. `kCSDisplayImageCompressionDefault` sends nothing, so the server keeps its own
+/// choice or the last one sent on this connection. Setting this turns `automaticEncoding` off.
+@property (atomic) CSDisplayImageCompression preferredImageCompression;
+
+/// Video codecs (`CSDisplayVideoCodec`) the server is asked to stream with, most preferred first
+///
+/// Empty leaves the choice to the server, which also skips any codec either side cannot handle.
+/// Setting this turns `automaticEncoding` off.
+@property (atomic, copy) NSArray<NSNumber *> *preferredVideoCodecs;
+
+/// Pick `preferredImageCompression` and `preferredVideoCodecs` from the measured bandwidth and decode cost
+///
+/// While on, the display channel's throughput is sampled every few seconds. Slow links get the
+/// codecs that need the fewest bytes, fast links the ones cheapest to decode, and codecs
+/// nothing here can decode are left out. Defaults to NO.
+@property (atomic) BOOL automaticEncoding;
+
+/// Width in pixels of a downscaled copy of the display kept live for `thumbnailWithGeneration:`, 0 (the default) keeps none
+///
+/// Something like 256 is enough for a list of VMs. The thumbnail is only resampled where the
+/// guest drew, a few times a second at most, and at a cost that follows the size of the
+/// thumbnail rather than of the display. Guest video shown through an overlay is not in it.
+@property (atomic) NSUInteger thumbnailWidth;
+
+/// True between `startRecordingToURL:completion:` and `stopRecordingWithCompletion:`
+@property (nonatomic, readonly) BOOL isRecording;
+
+/// Number of frames the current recording skipped because the encoder was behind
+@property (nonatomic, readonly) uint64_t recordingDroppedFrameCount;
+
+/// Changes whenever the thumbnail does, so callers can skip thumbnails they already have
+@property (nonatomic, readonly) uint64_t thumbnailGeneration;
+
+/// Best throughput seen recently on the display channel in bytes per second, only measured with `automaticEncoding` on
+///
+/// The server only sends what changed, so this is a lower bound on what the link can carry
+/// and it decays slowly rather than dropping whenever the guest screen goes still.
+@property (atomic, readonly) double measuredBandwidth;
+
 - (instancetype)init NS_UNAVAILABLE;
 
 /// Request a new screen resolution from SPICE guest agent
@@ -63,10 +176,51 @@ NS_ASSUME_NONNULL_BEGIN
 
 /// Take a snapshot of the current framebuffer
 ///
-/// This is slow and should NOT be used for presenting the framebuffer.
+/// This is slow and should NOT be used for presenting the framebuffer. Only copying the
+/// pixels happens on the SPICE thread, the completion handler is called on a background queue.
 /// @param completion Handler to recieve a screenshot (on success) or nil (when failed).
 - (void)screenshotWithCompletion:(screenshotCallback_t)completion;
 
+/// Take a snapshot of the current framebuffer and encode it in memory
+///
+/// Encoding happens on a background queue, which the completion handler is called on.
+/// @param format Image format
+/// @param quality Compression quality from 0.0 (smallest) to 1.0 (best), only used for lossy formats
+/// @param completion Handler to recieve the encoded image (on success) or nil (when failed).
+- (void)screenshotDataWithFormat:(CSScreenshotFormat)format quality:(CGFloat)quality completion:(void (^)(NSData * _Nullable))completion;
+
+/// Take a snapshot of the current framebuffer and encode it straight to a file
+///
+/// Encoding happens on a background queue, which the completion handler is called on.
+/// @param url File URL of destination
+/// @param format Image format
+/// @param quality Compression quality from 0.0 (smallest) to 1.0 (best), only used for lossy formats
+/// @param completion Handler to recieve YES if the file was written
+- (void)writeScreenshotToURL:(NSURL *)url format:(CSScreenshotFormat)format quality:(CGFloat)quality completion:(void (^)(BOOL))completion;
+
+/// Start recording the display to a video file
+///
+/// Frames are H.264, in the container the extension of `url` names: mp4, mov or mkv, and
+/// MPEG-TS for anything else. Those other than MPEG-TS are only playable once the recording
+/// is stopped. A frame is recorded whenever the display changes, up to 30 times a second,
+/// so an idle display costs nothing. Copying a frame is all that happens on the SPICE
+/// thread, and if the encoder falls behind frames are skipped instead of waited for.
+/// @param url File to write
+/// @param completion Handler to recieve nil once recording or an error if it could not start
+- (void)startRecordingToURL:(NSURL *)url completion:(recordingCallback_t)completion;
+
+/// Stop recording and finish the file
+/// @param completion Handler to recieve nil once the file is written or the error the recording ended with
+- (void)stopRecordingWithCompletion:(recordingCallback_t)completion;
+
+/// Get the thumbnail as it is now
+///
+/// This is cheap and can be called from any thread. The image is only made once for each
+/// generation, so calling this for an unchanged thumbnail returns the same pixels.
+/// @param generation Set to the `thumbnailGeneration` of the thumbnail returned
+/// @returns The thumbnail, or nil if `thumbnailWidth` is 0 or the display has nothing to show yet
+- (nullable CSScreenshot *)thumbnailWithGeneration:(nullable uint64_t *)generation;
+
 @end
 
 NS_ASSUME_NONNULL_END
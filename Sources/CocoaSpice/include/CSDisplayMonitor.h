@@ -0,0 +1,65 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import CoreGraphics;
+@import CocoaSpiceRenderer;
+
+@class CSDisplay;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Another head of a display channel with several monitors
+///
+/// Presents its part of the display's texture, so every head is updated by the same upload.
+/// The cursor is only drawn by the display itself.
+@interface CSDisplayMonitor : NSObject <CSRenderSource>
+
+/// Display channel this head belongs to
+@property (nonatomic, weak, readonly) CSDisplay *display;
+
+/// Id of this head, derived from the display's channel and the head's id in that channel
+///
+/// For the first display channel this is the head's id, as SPICE numbers those heads. Heads
+/// after the first of other channels are numbered past any id SPICE uses, so no two heads share one.
+@property (nonatomic, readonly) NSInteger monitorID;
+
+/// Part of the display surface shown by this head
+@property (nonatomic, readonly) CGRect area;
+
+/// The current size of this head
+@property (nonatomic, readonly) CGSize displaySize;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Request a new resolution for this head from SPICE guest agent
+///
+/// SPICE can only address heads of the first display channel, so for heads of other channels
+/// this does nothing.
+/// @param bounds The requested display bounds
+- (void)requestResolution:(CGRect)bounds;
+
+/// Add a renderer that will present this head, it must use the same MTLDevice as the display's renderers
+/// @param renderer Renderer to add.
+- (void)addRenderer:(id<CSRenderer>)renderer NS_SWIFT_NAME(addRenderer(_:));
+
+/// Remove a renderer and stop presenting to it
+/// @param renderer Renderer to remove.
+- (void)removeRenderer:(id<CSRenderer>)renderer NS_SWIFT_NAME(removeRenderer(_:));
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,97 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+/// A stage of the display pipeline whose latency is measured
+///
+/// Every latency is measured from the moment the frame arrives on the SPICE thread
+/// (`display-invalidate` for the canvas, `gl-draw` for a GL scanout).
+typedef NS_ENUM(NSInteger, CSDisplayLatency) {
+    /// Until the copy of a GL scanout into our own texture has landed on the GPU
+    ///
+    /// Canvas uploads are encoded into the frame that presents them, so they only
+    /// report `kCSDisplayLatencyPresent`.
+    kCSDisplayLatencyUpload,
+
+    /// Until the renderer has drawn a frame containing the update
+    kCSDisplayLatencyPresent,
+
+    /// Until `gl_draw_done` is sent, releasing the server to draw the next GL frame
+    ///
+    /// This is the acknowledgement the guest's GPU queue waits on, compare it with
+    /// `kCSDisplayLatencyPresent` and `acksWaitedForPresent` to see whether the two are coupled.
+    kCSDisplayLatencyDrawDone
+};
+
+/// Samples kept for each stage
+enum { kCSDisplayStatisticsSampleCount = 256 };
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Frame timing for a single display
+///
+/// Latencies are kept for the most recent `kCSDisplayStatisticsSampleCount` frames of each
+/// stage, counters cover the display's lifetime (or since `reset`). All properties and
+/// methods are thread safe and cheap enough to poll every second.
+@interface CSDisplayStatistics : NSObject
+
+/// Frames (damage updates) received from the server
+@property (nonatomic, readonly) uint64_t framesReceived;
+
+/// Frames the renderer has drawn
+@property (nonatomic, readonly) uint64_t framesPresented;
+
+/// Frames that arrived while an earlier one was still waiting to be uploaded or presented
+///
+/// These share an upload or a present with the frame before them, so they never reach
+/// the screen on their own.
+@property (nonatomic, readonly) uint64_t framesMerged;
+
+/// Frames that were thrown away before reaching the screen
+///
+/// This happens when a GL copy fails or is superseded by a new scanout, and when the
+/// canvas is destroyed with damage still pending.
+@property (nonatomic, readonly) uint64_t framesDropped;
+
+/// GL frames whose `gl_draw_done` had to wait for the renderer
+///
+/// Normally a GL frame is copied and acknowledged without waiting on any render pass.
+/// This counts the ones that could not be: when every shadow copy was still being
+/// presented, or when there was nowhere to copy the frame to.
+@property (nonatomic, readonly) uint64_t acksWaitedForPresent;
+
+/// Number of samples currently held for a stage
+/// @param latency Stage to query
+- (NSUInteger)sampleCountForLatency:(CSDisplayLatency)latency;
+
+/// Latency of a stage at a percentile of the recent samples
+/// @param latency Stage to query
+/// @param percentile Between 0 and 100, for example 50 for the median
+/// @returns Latency in seconds, or 0 if there are no samples yet
+- (NSTimeInterval)latency:(CSDisplayLatency)latency atPercentile:(double)percentile;
+
+/// Snapshot of every counter plus p50/p95/p99 of every stage, suitable for logging or exporting as JSON
+///
+/// Latencies are in seconds.
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+/// Clear all samples and counters
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,97 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+#import "CSDisplay.h"
+
+@class CSConnection;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// What the quality controller measured over one interval and what it decided
+@interface CSQualitySample : NSObject
+
+/// Seconds covered by this sample
+@property (nonatomic, readonly) NSTimeInterval interval;
+
+/// Bytes per second received on all display channels
+@property (nonatomic, readonly) double displayBandwidth;
+
+/// Bytes per second received on the audio playback channel
+@property (nonatomic, readonly) double audioBandwidth;
+
+/// Best recent throughput, decaying slowly while the link is quiet
+@property (nonatomic, readonly) double peakBandwidth;
+
+/// Worst 95th percentile present latency over the displays that received frames, in seconds
+@property (nonatomic, readonly) NSTimeInterval frameLatency;
+
+/// Share of frames received in this interval that were merged or dropped rather than presented on their own
+@property (nonatomic, readonly) double frameLossRate;
+
+/// True if the link looked saturated, so latency was blamed on the network rather than on decoding
+@property (nonatomic, readonly) BOOL isNetworkBound;
+
+/// Bandwidth the encoding was chosen for, in bytes per second
+@property (nonatomic, readonly) double bandwidthBudget;
+
+/// Image compression asked of every display
+@property (nonatomic, readonly) CSDisplayImageCompression imageCompression;
+
+/// Video codecs asked of every display, most preferred first
+@property (nonatomic, readonly) NSArray<NSNumber *> *videoCodecs;
+
+/// Audio playback delay reported to the server, in milliseconds
+@property (nonatomic, readonly) uint32_t playbackDelay;
+
+/// Inputs and decisions as a dictionary, suitable for logging or exporting as JSON
+- (NSDictionary<NSString *, id> *)dictionaryRepresentation;
+
+@end
+
+/// Adapts encoding to link conditions to hold a target frame latency
+///
+/// Once a second the controller samples the throughput of the display and playback channels
+/// and the present latency and frame loss of every display. While latency is over target it
+/// works out whether the link or the client is the bottleneck: a saturated link lowers the
+/// bandwidth budget so displays prefer codecs that need fewer bytes, an idle one raises it so
+/// they prefer codecs that are cheaper to decode. With latency comfortably under target the
+/// budget creeps back towards the measured peak. The audio playback delay follows the frame
+/// latency so the server keeps audio and video in step.
+///
+/// Enabling the controller takes over `preferredImageCompression` and `preferredVideoCodecs`
+/// of every display, turning their `automaticEncoding` off.
+@interface CSQualityController : NSObject
+
+/// Connection being controlled
+@property (nonatomic, weak, readonly) CSConnection *connection;
+
+/// Start or stop adapting, defaults to NO
+@property (atomic) BOOL isEnabled;
+
+/// Present latency to hold in seconds, defaults to 50ms
+@property (atomic) NSTimeInterval targetFrameLatency;
+
+/// The most recent sample, nil until the first interval has passed
+///
+/// Observe with KVO for a stream of samples. Changes are posted on the SPICE thread.
+@property (atomic, nullable, readonly) CSQualitySample *latestSample;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
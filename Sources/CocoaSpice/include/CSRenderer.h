@@ -40,17 +40,21 @@ typedef void (^completionCallback_t)(void);
 @property (nonatomic, readwrite) CGFloat viewportScale;
 
 /// Update the existing texture with pixel data and invalidate
+///
+/// All regions are copied with a single command buffer.
 /// - Parameters:
 ///   - renderSource: Source to render
 ///   - sourceBuffer: Buffer to draw to the source texture
-///   - region: Region in the source texture to draw to
-///   - sourceOffset: Offset in the source buffer to copy from
+///   - regions: Regions in the source texture to draw to
+///   - sourceOffsets: Offset in the source buffer to copy each region from
+///   - count: Number of entries in `regions` and `sourceOffsets`
 ///   - sourceBytesPerRow: Stride of the source buffer
-///   - completion: Block to run after the texture is rendered
+///   - completion: Block to run once the GPU is done with the copy, other renderers can draw the texture from then on
 - (void)renderSouce:(id<CSRenderSource>)renderSource
          copyBuffer:(id<MTLBuffer>)sourceBuffer
-             region:(MTLRegion)region
-       sourceOffset:(NSUInteger)sourceOffset
+            regions:(const MTLRegion *)regions
+      sourceOffsets:(const NSUInteger *)sourceOffsets
+              count:(NSUInteger)count
   sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
          completion:(nullable completionCallback_t)completion;
 
@@ -64,6 +68,15 @@ typedef void (^completionCallback_t)(void);
 /// Clear the render source
 - (void)disableRender;
 
+@optional
+
+/// Mark only the cursor of a source pending to be rendered
+///
+/// For a cursor that moved, changed shape or was shown or hidden over an unchanged source,
+/// so a renderer can redraw just what is under the cursor.
+/// - Parameter renderSource: Source whose cursor changed
+- (void)invalidateCursorOfRenderSource:(id<CSRenderSource>)renderSource;
+
 @end
 
 NS_ASSUME_NONNULL_END
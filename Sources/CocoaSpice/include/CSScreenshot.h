@@ -23,6 +23,12 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// Image file format a screenshot is encoded to
+typedef NS_ENUM(NSInteger, CSScreenshotFormat) {
+    kCSScreenshotFormatPNG,
+    kCSScreenshotFormatJPEG,
+};
+
 /// Platform agnostic way to represent a screenshot PNG image
 @interface CSScreenshot : NSObject
 
@@ -54,6 +60,10 @@ NS_ASSUME_NONNULL_BEGIN
 
 #endif
 
+/// Create a screenshot from a CoreGraphics image
+/// @param image Screenshot image, retained
+- (instancetype)initWithCGImage:(CGImageRef)image;
+
 /// Create a screenshot from a PNG file
 /// @param url File URL of PNG
 - (nullable instancetype)initWithContentsOfURL:(NSURL *)url;
@@ -63,6 +73,23 @@ NS_ASSUME_NONNULL_BEGIN
 /// @param atomically If true, the write should be atomic
 - (void)writeToURL:(NSURL *)url atomically:(BOOL)atomically;
 
+/// Encode the screenshot in memory
+///
+/// This can be slow for large images, avoid calling it on the main thread.
+/// @param format Image format
+/// @param quality Compression quality from 0.0 (smallest) to 1.0 (best), only used for lossy formats
+/// @returns Encoded image or nil on failure
+- (nullable NSData *)dataWithFormat:(CSScreenshotFormat)format quality:(CGFloat)quality;
+
+/// Encode the screenshot straight to a file
+///
+/// This can be slow for large images, avoid calling it on the main thread.
+/// @param url File URL of destination
+/// @param format Image format
+/// @param quality Compression quality from 0.0 (smallest) to 1.0 (best), only used for lossy formats
+/// @returns YES if the file was written
+- (BOOL)writeToURL:(NSURL *)url format:(CSScreenshotFormat)format quality:(CGFloat)quality;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -23,11 +23,14 @@
 #include "CSCursor.h"
 #include "CSDisplay.h"
 #include "CSDisplay+Renderer.h"
+#include "CSDisplayMonitor.h"
+#include "CSDisplayStatistics.h"
 #include "CSInput.h"
 #include "CSMain.h"
 #include "CSPasteboardDelegate.h"
 #include "CSPort.h"
 #include "CSPortDelegate.h"
+#include "CSQualityController.h"
 #include "CSScreenshot.h"
 #include "CSSession.h"
 #include "CSSession+Sharing.h"
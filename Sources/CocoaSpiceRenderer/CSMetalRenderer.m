@@ -18,83 +18,70 @@
 @import MetalKit;
 
 #import "CSMetalRenderer.h"
+#import "CSRendererPipelineCache.h"
+#import "CSRendererDisplayLink.h"
 #import "CSRenderSource.h"
 #import "CSRenderer.h"
+#import "CSRendererSourceData.h"
 
 // Header shared between C code here, which executes Metal API commands, and .metal files, which
 //   uses these types as inputs to the shaders
 #import "CSShaderTypes.h"
 
-NS_ASSUME_NONNULL_BEGIN
+// Consecutive refreshes with nothing to draw before `adaptiveFrameRate` pauses the view
+static const NSUInteger kCSMetalRendererIdleFrames = 30;
 
-/// Helper class to retain fields from a renderer source
-@interface _CSRendererSourceData : NSObject<CSRenderSource>
+// Weight of the newest sample in `averageGPUTime`
+static const double kCSMetalRendererGPUTimeWeight = 0.1;
 
-@property (nonatomic, readonly) CGPoint offset;
-@property (nonatomic, readonly) id<MTLBuffer> vertices;
-@property (nonatomic, readonly) NSUInteger numVertices;
-@property (nonatomic, readonly) id<MTLTexture> texture;
-@property (nonatomic, readonly) BOOL hasAlpha;
-@property (nonatomic, readonly) BOOL isInverted;
-@property (nonatomic, readonly) BOOL isVisible;
-@property (nonatomic, strong, readonly) _CSRendererSourceData *cursorSource;
+// Most texels across one pixel a downscaling kernel is widened to, past this it skips some
+static const float kCSMetalRendererMaxFootprint = 4.0f;
 
-- (instancetype)init NS_UNAVAILABLE;
-- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource device:(id<MTLDevice>)device;
-- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset device:(id<MTLDevice>)device NS_DESIGNATED_INITIALIZER;
-
-@end
-
-NS_ASSUME_NONNULL_END
-
-@implementation _CSRendererSourceData
-
-/// Retain a copy of the render source data
-/// - Parameter renderSource: Render source to read from
-- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource {
-    return [self initWithRenderSource:renderSource atOffset:CGPointZero];
-}
-
-/// Retain a copy of the render source data
-/// - Parameters:
-///   - renderSource: Render source to read from
-///   - offset: Offset to add to `viewportOrigin`, can be zero
-- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset {
-    id<CSRenderSource> cursorSource = renderSource.cursorSource;
-    if (self = [super init]) {
-        _offset = CGPointMake(renderSource.offset.x +
-                              offset.x,
-                              renderSource.offset.y +
-                              offset.y);
-        _vertices = renderSource.vertices;
-        _numVertices = renderSource.numVertices;
-        _texture = renderSource.texture;
-        _hasAlpha = renderSource.hasAlpha;
-        _isInverted = renderSource.isInverted;
-        _isVisible = renderSource.isVisible;
-        if (!_vertices || !_texture) {
-            return nil;
-        }
-        if (cursorSource) {
-            _cursorSource = [[_CSRendererSourceData alloc] initWithRenderSource:cursorSource
-                                                                       atOffset:renderSource.offset];
-        }
-    }
-    return self;
-}
-
-@end
+// Frames of damage remembered for bringing drawables up to date, more than a layer has drawables
+#define kCSMetalRendererDamageHistory 4
 
 @interface CSMetalRenderer ()
 
-// Thses must only be accessed by main thread
-@property (nonatomic, nullable) const _CSRendererSourceData *renderSourceData;
+// The main queue, or a queue of our own with `usesRenderThread`
+@property (nonatomic, readonly) dispatch_queue_t renderQueue;
+@property (nonatomic, readonly, nullable) _CSRendererDisplayLink *renderDisplayLink;
+@property (nonatomic, readonly, nullable) CAMetalLayer *renderLayer;
+@property (nonatomic, readonly) MTLPixelFormat renderLayerPixelFormat;
+
+// These must only be accessed on `renderQueue`
+@property (nonatomic, readonly) _CSRendererTile *renderMainTile;
 @property (nonatomic, assign) vector_uint2 renderViewportSize;
 @property (nonatomic) id<MTLSamplerState> renderSampler;
+@property (nonatomic) CSMetalRendererKernel renderUpscalingKernel;
+@property (nonatomic) CSMetalRendererKernel renderDownscalingKernel;
 @property (nonatomic) CGPoint renderViewportOrigin;
 @property (nonatomic) CGFloat renderViewportScale;
 @property (nonatomic) BOOL renderNeedsUpdate;
-@property (nonatomic, readonly) NSMutableArray<completionCallback_t> *renderCompletions;
+@property (nonatomic) NSUInteger renderPendingUpdates;
+@property (nonatomic) NSUInteger renderIdleFrames;
+@property (nonatomic) BOOL renderPausedWhileIdle;
+@property (nonatomic, weak) MTKView *renderView;
+@property (nonatomic) _CSRendererCompletions *renderCompletions;
+@property (nonatomic, readonly) NSMutableArray<_CSRendererCompletions *> *renderFreeCompletions;
+@property (nonatomic, nullable) _CSRendererCopy *renderPendingCopies;
+@property (nonatomic, nullable) _CSRendererCopy *renderLastPendingCopy;
+@property (nonatomic, readonly) NSMutableArray<_CSRendererTile *> *renderTiles;
+@property (nonatomic, nullable) id<MTLTexture> renderFrameTexture;
+@property (nonatomic, readonly) MTLRenderPassDescriptor *renderFramePassDescriptor;
+@property (nonatomic, readonly, nullable) MTLRenderPassDescriptor *renderLayerPassDescriptor;
+@property (nonatomic, readonly) NSMutableArray<_CSRendererTile *> *renderDirtyTiles;
+@property (nonatomic) BOOL renderFrameNeedsClear;
+
+@property (atomic, readwrite) uint64_t copyCommitCount;
+@property (atomic, readwrite) uint64_t copyRectCount;
+@property (atomic, readwrite) uint64_t presentedFrameCount;
+@property (atomic, readwrite) uint64_t coalescedFrameCount;
+@property (atomic, readwrite) uint64_t missedDeadlineCount;
+@property (atomic, readwrite) CFTimeInterval lastGPUTime;
+@property (atomic, readwrite) CFTimeInterval averageGPUTime;
+@property (atomic, readwrite) uint64_t redrawnTileCount;
+@property (atomic, readwrite) uint64_t fullFrameCount;
+@property (atomic, readwrite) uint64_t partialFrameCount;
 
 @end
 
@@ -104,77 +91,165 @@ NS_ASSUME_NONNULL_END
     // The device (aka GPU) we're using to render
     id<MTLDevice> _device;
 
-    // Our render pipeline composed of our vertex and fragment shaders in the .metal shader file
-    id<MTLRenderPipelineState> _pipelineState;
+    // Our render pipelines, the shaders in the .metal shader file specialized for each
+    // way we draw, shared with every other renderer on the device
+    _CSRendererPipelineCache *_pipelineCache;
+
+    // Frame texture is drawn to the view pixel for pixel
+    id<MTLSamplerState> _frameSampler;
+
+    // Trilinear, for mipmapped copies of sources
+    id<MTLSamplerState> _mipmapSampler;
+
+    // A single black pixel, stretched over a tile to clear it
+    id<MTLTexture> _clearTexture;
 
     // The command Queue from which we'll obtain command buffers
     id<MTLCommandQueue> _commandQueue;
+
+    // Updates from sources waiting for `renderQueue`, see `_applyUpdates`. All of
+    // these are only touched while holding `_updates`.
+    NSMutableArray<_CSRendererUpdate *> *_updates;
+    _CSRendererCompletions *_updateCompletions;
+    _CSRendererCopy *_updateCopies;
+    _CSRendererCopy *_updateLastCopy;
+    _CSRendererCopy *_freeCopies;
+    uint64_t _updateSequence;
+    BOOL _updateScheduled;
+    BOOL _updateDisablesRender;
+
+    // Held while a completed frame updates the GPU statistics, see `_completeFrame:`
+    NSObject *_frameStatisticsLock;
+
+    // What each of the last few frames changed in the frame texture, and the frame each
+    // recently seen drawable holds, see `_damageOfDrawable:`. Only touched on `renderQueue`.
+    CGRect _frameDamage[kCSMetalRendererDamageHistory];
+    CGRect _frameDamageInProgress;
+    uint64_t _frameNumber;
+    __weak id<MTLTexture> _drawableTextures[kCSMetalRendererDamageHistory];
+    uint64_t _drawableFrames[kCSMetalRendererDamageHistory];
+    NSUInteger _drawableNext;
 }
 
 @synthesize device = _device;
 @synthesize commandQueue = _commandQueue;
 @synthesize viewportOrigin = _viewportOrigin;
 @synthesize viewportScale = _viewportScale;
+@synthesize adaptiveFrameRate = _adaptiveFrameRate;
 
 /// Initialize with the MetalKit view from which we'll obtain our Metal device
 - (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView
+{
+    return [self initWithMetalKitView:mtkView usesRenderThread:NO];
+}
+
+- (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView usesRenderThread:(BOOL)usesRenderThread
 {
     self = [super init];
     if(self)
     {
-        NSError *error = NULL;
-        
         _device = mtkView.device;
+        _usesRenderThread = usesRenderThread;
+        _renderView = mtkView;
         [self _setViewportCGSize:mtkView.drawableSize];
-        _renderCompletions = [NSMutableArray array];
+        _renderCompletions = [[_CSRendererCompletions alloc] init];
+        _renderFreeCompletions = [NSMutableArray array];
+        _updates = [NSMutableArray array];
+        _frameStatisticsLock = [[NSObject alloc] init];
+        _updateCompletions = [[_CSRendererCompletions alloc] init];
+        _renderTiles = [NSMutableArray array];
+        _renderFramePassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+        _renderDirtyTiles = [NSMutableArray array];
+        _renderMainTile = [[_CSRendererTile alloc] initWithRenderSource:nil];
         _viewportScale = 1.0f;
         _renderViewportScale = 1.0f;
 
-        /// Create our render pipeline
-        
-        // Load all the shader files with a .metal file extension in the project
-        // FIXME: on Swift we have `Bundle.module` generated by SPM but it doesn't appear to be the case for Obj-C
-        NSURL *modulePath = [NSBundle.mainBundle.resourceURL URLByAppendingPathComponent:@"CocoaSpice_CocoaSpiceRenderer.bundle"];
-        NSBundle *bundle = [NSBundle bundleWithURL:modulePath];
-        id<MTLLibrary> defaultLibrary = [_device newDefaultLibraryWithBundle:bundle error:&error];
-        NSAssert(defaultLibrary, @"Failed to get library from bundle: %@", error);
-
-        // Load the vertex function from the library
-        id<MTLFunction> vertexFunction = [defaultLibrary newFunctionWithName:@"vertexShader"];
-
-        // Load the fragment function from the library
-        id<MTLFunction> fragmentFunction = [defaultLibrary newFunctionWithName:@"samplingShader"];
-
-        // Set up a descriptor for creating a pipeline state object
-        MTLRenderPipelineDescriptor *pipelineStateDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
-        pipelineStateDescriptor.label = @"Renderer Pipeline";
-        pipelineStateDescriptor.vertexFunction = vertexFunction;
-        pipelineStateDescriptor.fragmentFunction = fragmentFunction;
-        pipelineStateDescriptor.colorAttachments[0].pixelFormat = mtkView.colorPixelFormat;
-        pipelineStateDescriptor.colorAttachments[0].blendingEnabled = YES;
-        pipelineStateDescriptor.colorAttachments[0].rgbBlendOperation = MTLBlendOperationAdd;
-        pipelineStateDescriptor.colorAttachments[0].alphaBlendOperation = MTLBlendOperationAdd;
-        pipelineStateDescriptor.colorAttachments[0].sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
-        pipelineStateDescriptor.colorAttachments[0].destinationRGBBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
-        pipelineStateDescriptor.colorAttachments[0].sourceAlphaBlendFactor = MTLBlendFactorOne;
-        pipelineStateDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOne;
-        pipelineStateDescriptor.depthAttachmentPixelFormat = mtkView.depthStencilPixelFormat;
-        pipelineStateDescriptor.vertexBuffers[CSRenderVertexInputIndexVertices].mutability = MTLMutabilityImmutable;
-
-        _pipelineState = [_device newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
-                                                                 error:&error];
-        NSAssert(_pipelineState, @"Failed to create pipeline state to render to texture: %@", error);
+        /// Create our render pipelines
+        _pipelineCache = [_CSRendererPipelineCache pipelineCacheForDevice:_device];
+
+        // The ones every frame is drawn with, the kernels are left until they are chosen
+        [_pipelineCache pipelineWithColorFormat:mtkView.colorPixelFormat
+                                    depthFormat:usesRenderThread ? MTLPixelFormatInvalid : mtkView.depthStencilPixelFormat
+                                         filter:CSRenderFilterSampler
+                                       hasAlpha:NO
+                                     isInverted:NO];
+        for (NSUInteger i = 0; i < 4; i++) {
+            [_pipelineCache pipelineWithColorFormat:mtkView.colorPixelFormat
+                                        depthFormat:MTLPixelFormatInvalid
+                                             filter:CSRenderFilterSampler
+                                           hasAlpha:(i & 1) != 0
+                                         isInverted:(i & 2) != 0];
+        }
 
         // Create the command queue
         _commandQueue = [_device newCommandQueue];
 
         // Sampler
         [self _initializeUpscaler:MTLSamplerMinMagFilterLinear downscaler:MTLSamplerMinMagFilterLinear];
+        MTLSamplerDescriptor *samplerDescriptor = [MTLSamplerDescriptor new];
+        samplerDescriptor.minFilter = MTLSamplerMinMagFilterNearest;
+        samplerDescriptor.magFilter = MTLSamplerMinMagFilterNearest;
+        _frameSampler = [_device newSamplerStateWithDescriptor:samplerDescriptor];
+        samplerDescriptor.minFilter = MTLSamplerMinMagFilterLinear;
+        samplerDescriptor.magFilter = MTLSamplerMinMagFilterLinear;
+        samplerDescriptor.mipFilter = MTLSamplerMipFilterLinear;
+        _mipmapSampler = [_device newSamplerStateWithDescriptor:samplerDescriptor];
+
+        // Background under and around the sources
+        const uint8_t black[4] = { 0, 0, 0, 0xff };
+        MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatBGRA8Unorm
+                                                                                                     width:1
+                                                                                                    height:1
+                                                                                                 mipmapped:NO];
+        _clearTexture = [_device newTextureWithDescriptor:textureDescriptor];
+        [_clearTexture replaceRegion:MTLRegionMake2D(0, 0, 1, 1) mipmapLevel:0 withBytes:black bytesPerRow:sizeof(black)];
+
+        if (usesRenderThread) {
+            [self _initializeRenderThreadWithView:mtkView];
+        } else {
+            _renderQueue = dispatch_get_main_queue();
+        }
     }
 
     return self;
 }
 
+/// Must be called from main thread
+///
+/// The view is only left to lay out the layer, frames go straight to the layer from
+/// `renderQueue` as the display refreshes.
+- (void)_initializeRenderThreadWithView:(MTKView *)mtkView {
+    NSAssert([mtkView.layer isKindOfClass:CAMetalLayer.class], @"View is not backed by a CAMetalLayer");
+    mtkView.paused = YES;
+    mtkView.enableSetNeedsDisplay = NO;
+    _renderLayer = (CAMetalLayer *)mtkView.layer;
+    _renderLayerPixelFormat = mtkView.colorPixelFormat;
+    _renderLayerPassDescriptor = [MTLRenderPassDescriptor renderPassDescriptor];
+    _renderLayerPassDescriptor.colorAttachments[0].loadAction = MTLLoadActionClear;
+    _renderLayerPassDescriptor.colorAttachments[0].clearColor = mtkView.clearColor;
+    _renderLayerPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+    _renderQueue = dispatch_queue_create("CSMetalRenderer", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INTERACTIVE, 0));
+    __weak typeof(self) weakSelf = self;
+    _renderDisplayLink = [[_CSRendererDisplayLink alloc] initWithQueue:_renderQueue handler:^{
+        [weakSelf _drawFromDisplayLink];
+    }];
+    [self _updateDisplayOfView:mtkView];
+}
+
+/// Must be called from main thread
+- (void)_updateDisplayOfView:(MTKView *)view {
+#if TARGET_OS_OSX
+    NSNumber *screenNumber = view.window.screen.deviceDescription[@"NSScreenNumber"];
+    if (screenNumber) {
+        [self.renderDisplayLink setDisplayID:screenNumber.unsignedIntValue];
+    }
+#endif
+}
+
+- (void)dealloc {
+    [_renderDisplayLink invalidate];
+}
+
 - (void)_initializeUpscaler:(MTLSamplerMinMagFilter)upscaler downscaler:(MTLSamplerMinMagFilter)downscaler {
     MTLSamplerDescriptor *samplerDescriptor = [MTLSamplerDescriptor new];
     samplerDescriptor.minFilter = downscaler;
@@ -185,11 +260,34 @@ NS_ASSUME_NONNULL_END
 
 /// Scalers from VM settings
 - (void)changeUpscaler:(MTLSamplerMinMagFilter)upscaler downscaler:(MTLSamplerMinMagFilter)downscaler {
-    dispatch_async(dispatch_get_main_queue(), ^{
+    dispatch_async(self.renderQueue, ^{
         [self _initializeUpscaler:upscaler downscaler:downscaler];
+        // the kept frame was drawn with the old ones
+        self.renderFrameNeedsClear = YES;
+    });
+}
+
+- (void)changeUpscalingKernel:(CSMetalRendererKernel)upscaling downscalingKernel:(CSMetalRendererKernel)downscaling {
+    dispatch_async(self.renderQueue, ^{
+        self.renderUpscalingKernel = upscaling;
+        self.renderDownscalingKernel = downscaling;
+        // the kept frame was drawn with the old ones
+        self.renderFrameNeedsClear = YES;
+        [self _setNeedsUpdate];
     });
 }
 
+/// Must be called on `renderQueue`
+- (CSMetalRendererKernel)_kernelForScale:(CGFloat)scale {
+    if (scale > 1.0f) {
+        return self.renderUpscalingKernel;
+    } else if (scale < 1.0f) {
+        return self.renderDownscalingKernel;
+    } else {
+        return kCSMetalRendererKernelSampler;
+    }
+}
+
 - (void)_setViewportCGSize:(CGSize)size {
     vector_uint2 viewportSize;
 
@@ -200,17 +298,29 @@ NS_ASSUME_NONNULL_END
 
 /// Called whenever view changes orientation or is resized
 - (void)mtkView:(nonnull MTKView *)view drawableSizeWillChange:(CGSize)size {
+    if (self.usesRenderThread) {
+        // the view may have moved to another screen as well
+        [self _updateDisplayOfView:view];
+        dispatch_async(self.renderQueue, ^{
+            [self _setViewportCGSize:size];
+            [self _setNeedsUpdate];
+        });
+        return;
+    }
     // Save the size of the drawable as we'll pass these
     //   values to our vertex shader when we draw
     [self _setViewportCGSize:size];
+    // the old frame is stretched until we draw again
+    [self _setNeedsUpdate];
 }
 
 - (void)setViewportOrigin:(CGPoint)viewportOrigin {
     if (!CGPointEqualToPoint(_viewportOrigin, viewportOrigin)) {
         _viewportOrigin = viewportOrigin;
-        dispatch_async(dispatch_get_main_queue(), ^{
+        dispatch_async(self.renderQueue, ^{
             self.renderViewportOrigin = viewportOrigin;
-            self.renderNeedsUpdate = YES;
+            self.renderFrameNeedsClear = YES;
+            [self _setNeedsUpdate];
         });
     }
 }
@@ -218,24 +328,155 @@ NS_ASSUME_NONNULL_END
 - (void)setViewportScale:(CGFloat)viewportScale {
     if (_viewportScale != viewportScale) {
         _viewportScale = viewportScale;
-        dispatch_async(dispatch_get_main_queue(), ^{
+        dispatch_async(self.renderQueue, ^{
             self.renderViewportScale = viewportScale;
-            self.renderNeedsUpdate = YES;
+            self.renderFrameNeedsClear = YES;
+            [self _setNeedsUpdate];
         });
     }
 }
 
-/// Must be called from main thread
-- (void)_addDrawCompletion:(completionCallback_t)completion {
-    [self.renderCompletions addObject:completion];
+- (BOOL)adaptiveFrameRate {
+    @synchronized (self) {
+        return _adaptiveFrameRate;
+    }
 }
 
-/// Must be called from main thread
-- (void)_completeDraw {
-    for (completionCallback_t completion in _renderCompletions) {
-        completion();
+- (void)setAdaptiveFrameRate:(BOOL)adaptiveFrameRate {
+    @synchronized (self) {
+        _adaptiveFrameRate = adaptiveFrameRate;
+    }
+    if (!adaptiveFrameRate) {
+        dispatch_async(self.renderQueue, ^{
+            [self _resumeIfIdle];
+        });
     }
-    [self.renderCompletions removeAllObjects];
+}
+
+/// Must be called on `renderQueue`
+- (void)_setNeedsUpdate {
+    self.renderNeedsUpdate = YES;
+    [self _resumeIfIdle];
+}
+
+/// Must be called on `renderQueue`
+///
+/// Only undoes a pause of our own, a view the caller paused stays paused.
+- (void)_resumeIfIdle {
+    self.renderIdleFrames = 0;
+    if (self.renderPausedWhileIdle) {
+        self.renderPausedWhileIdle = NO;
+        [self _setPaused:NO];
+    }
+}
+
+/// Must be called on `renderQueue`
+- (BOOL)_isPaused {
+    if (self.usesRenderThread) {
+        return self.renderDisplayLink.paused;
+    } else {
+        return self.renderView.paused;
+    }
+}
+
+/// Must be called on `renderQueue`
+- (void)_setPaused:(BOOL)paused {
+    if (self.usesRenderThread) {
+        self.renderDisplayLink.paused = paused;
+    } else {
+        self.renderView.paused = paused;
+    }
+}
+
+/// Must be called on `renderQueue`
+///
+/// Called for every refresh with nothing to draw. With `adaptiveFrameRate`, once enough of
+/// them go by the view is paused so an idle guest costs no wakeups at all, and the next
+/// update resumes it in time for the following refresh.
+- (void)_idleFrame {
+    self.renderIdleFrames++;
+    if (self.adaptiveFrameRate && ![self _isPaused] && self.renderIdleFrames >= kCSMetalRendererIdleFrames) {
+        self.renderPausedWhileIdle = YES;
+        [self _setPaused:YES];
+    }
+}
+
+/// Called on completion of a frame that was presented
+///
+/// A frame misses its deadline when the GPU is still working on it after the refresh it
+/// was meant for, so it is shown one refresh late (or more).
+///
+/// Completion handlers of different command buffers can run at the same time, so the
+/// statistics are updated under `_frameStatisticsLock`. Readers only need the atomic getters.
+- (void)_completeFrame:(id<MTLCommandBuffer>)commandBuffer
+             startTime:(CFTimeInterval)startTime
+         frameInterval:(CFTimeInterval)frameInterval {
+    @synchronized (_frameStatisticsLock) {
+        self.presentedFrameCount++;
+        if (@available(iOS 10.3, macOS 10.15, *)) {
+            CFTimeInterval gpuTime = commandBuffer.GPUEndTime - commandBuffer.GPUStartTime;
+            self.lastGPUTime = gpuTime;
+            if (self.averageGPUTime == 0) {
+                self.averageGPUTime = gpuTime;
+            } else {
+                self.averageGPUTime += (gpuTime - self.averageGPUTime) * kCSMetalRendererGPUTimeWeight;
+            }
+            if (commandBuffer.GPUEndTime > startTime + frameInterval) {
+                self.missedDeadlineCount++;
+            }
+        }
+    }
+}
+
+/// Must be called on `renderQueue`
+- (void)_completeDraw {
+    [self.renderCompletions runAll];
+}
+
+/// Must be called on `renderQueue`
+///
+/// Take everything waiting on the frame being encoded, to run once the GPU is done with it.
+/// Completions that come in later belong to a later frame, whose copies are not encoded yet.
+- (_CSRendererCompletions *)_takeCompletions {
+    _CSRendererCompletions *completions = self.renderCompletions;
+    self.renderCompletions = self.renderFreeCompletions.lastObject ?: [[_CSRendererCompletions alloc] init];
+    [self.renderFreeCompletions removeLastObject];
+    return completions;
+}
+
+/// Must be called on `renderQueue`
+- (void)_runCompletions:(_CSRendererCompletions *)completions {
+    [completions runAll];
+    [self.renderFreeCompletions addObject:completions];
+}
+
+/// Must be called on `renderQueue`
+///
+/// Anyone waiting on the copies in `commandBuffer` is only told once they are done: until
+/// then, other renderers drawing the same texture from their own queues could show it stale.
+- (void)_completeDrawAfterCommandBuffer:(id<MTLCommandBuffer>)commandBuffer {
+    _CSRendererCompletions *completions = [self _takeCompletions];
+    [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
+        dispatch_async(self.renderQueue, ^{
+            [self _runCompletions:completions];
+        });
+    }];
+}
+
+/// A quad of `size` pixels around the origin showing a whole texture
+static void cs_quad_vertices(CSRenderVertex vertices[6], CGSize size)
+{
+    float w = size.width / 2.0f;
+    float h = size.height / 2.0f;
+
+    // Pixel positions, texture coordinates
+    vertices[0] = (CSRenderVertex){ {  w,  h }, { 1.f, 0.f } }; // Top Right
+    vertices[1] = (CSRenderVertex){ { -w,  h }, { 0.f, 0.f } }; // Top Left
+    vertices[2] = (CSRenderVertex){ { -w, -h }, { 0.f, 1.f } }; // Bottom Left
+
+    vertices[3] = (CSRenderVertex){ {  w,  h }, { 1.f, 0.f } }; // Top Right
+    vertices[4] = (CSRenderVertex){ { -w, -h }, { 0.f, 1.f } }; // Bottom Left
+    vertices[5] = (CSRenderVertex){ {  w, -h }, { 1.f, 1.f } }; // Bottom Right
 }
 
 /// Create a translation+scale matrix
@@ -271,21 +512,120 @@ static matrix_float4x4 matrix_scale_translate(CGFloat scale, CGPoint translate)
     return m;
 }
 
+/// Must be called on `renderQueue`
+///
+/// Encode every copy received since the last frame into `commandBuffer`, so a burst of
+/// updates costs one command buffer per refresh rather than one per update.
+- (void)_encodePendingCopies:(id<MTLCommandBuffer>)commandBuffer {
+    NSUInteger numRects = 0;
+    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+    blitEncoder.label = @"Renderer Canvas Updates";
+
+    for (_CSRendererCopy *copy = self.renderPendingCopies; copy; copy = copy.next) {
+        for (NSUInteger i = 0; i < copy.count; i++) {
+            [blitEncoder copyFromBuffer:copy.sourceBuffer
+                           sourceOffset:copy.sourceOffsets[i]
+                      sourceBytesPerRow:copy.sourceBytesPerRow
+                    sourceBytesPerImage:0
+                             sourceSize:copy.regions[i].size
+                              toTexture:copy.texture
+                       destinationSlice:0
+                       destinationLevel:0
+                      destinationOrigin:copy.regions[i].origin];
+        }
+        numRects += copy.count;
+        // the command buffer holds on to what it needs
+        [copy reset];
+    }
+
+    [blitEncoder endEncoding];
+    // back to the sources for their next copies
+    @synchronized (_updates) {
+        self.renderLastPendingCopy.next = _freeCopies;
+        _freeCopies = self.renderPendingCopies;
+    }
+    self.renderPendingCopies = nil;
+    self.renderLastPendingCopy = nil;
+    self.copyCommitCount++;
+    self.copyRectCount += numRects;
+}
+
 /// Called whenever the view needs to render a frame
 - (void)drawInMTKView:(nonnull MTKView *)view
 {
-    // Obtain a renderPassDescriptor generated from the view's drawable textures
-    MTLRenderPassDescriptor *renderPassDescriptor = view.currentRenderPassDescriptor;
-    id<CAMetalDrawable> currentDrawable = view.currentDrawable;
+    if (self.usesRenderThread) {
+        // drawn from `renderDisplayLink` instead
+        return;
+    }
+    [self _drawInView:view
+          colorFormat:view.colorPixelFormat
+          depthFormat:view.depthStencilPixelFormat
+        frameInterval:1.0 / MAX(view.preferredFramesPerSecond, 1)];
+}
 
-    if (renderPassDescriptor == nil || currentDrawable == nil) {
+/// Must be called on `renderQueue`
+- (void)_drawFromDisplayLink {
+    [self _drawInView:nil
+          colorFormat:self.renderLayerPixelFormat
+          depthFormat:MTLPixelFormatInvalid
+        frameInterval:self.renderDisplayLink.refreshPeriod];
+}
+
+/// Must be called on `renderQueue`
+///
+/// Draws into the view's drawable, or without a view into the next drawable of `renderLayer`.
+- (void)_drawInView:(nullable MTKView *)view
+        colorFormat:(MTLPixelFormat)colorFormat
+        depthFormat:(MTLPixelFormat)depthFormat
+      frameInterval:(CFTimeInterval)frameInterval
+{
+    id<MTLCommandBuffer> commandBuffer = nil;
+
+    // Copies go out even if nothing is presented below: the texture must be
+    // current by the time it is next drawn.
+    if (self.renderPendingCopies) {
+        commandBuffer = [_commandQueue commandBuffer];
+        commandBuffer.label = @"Draw Frame";
+        [self _encodePendingCopies:commandBuffer];
+    }
+
+    NSArray<_CSRendererTile *> *dirtyTiles = nil;
+    if (self.renderNeedsUpdate && [self _prepareFrameTexture:colorFormat]) {
+        dirtyTiles = [self _dirtyTiles];
+        if (dirtyTiles && dirtyTiles.count == 0 && !self.renderFrameNeedsClear) {
+            // nothing that is drawn changed, such as a source outside the mosaic
+            self.renderNeedsUpdate = NO;
+            self.renderPendingUpdates = 0;
+        }
+    }
+
+    if (!dirtyTiles || !self.renderNeedsUpdate) {
+        if (commandBuffer) {
+            [self _completeDrawAfterCommandBuffer:commandBuffer];
+            [commandBuffer commit];
+        } else {
+            [self _completeDraw];
+        }
+        [self _idleFrame];
         return;
     }
 
-    const _CSRendererSourceData *sourceData = self.renderSourceData;
+    // Only now ask for a drawable: that can block until one is free, which an idle
+    // refresh has no reason to wait for
+    MTLRenderPassDescriptor *renderPassDescriptor;
+    id<CAMetalDrawable> currentDrawable;
+    if (view) {
+        renderPassDescriptor = view.currentRenderPassDescriptor;
+        currentDrawable = view.currentDrawable;
+    } else {
+        currentDrawable = [self.renderLayer nextDrawable];
+        renderPassDescriptor = currentDrawable ? self.renderLayerPassDescriptor : nil;
+        renderPassDescriptor.colorAttachments[0].texture = currentDrawable.texture;
+    }
 
-    if (!self.renderNeedsUpdate || !sourceData.isVisible) {
-        [self _completeDraw];
+    if (renderPassDescriptor == nil || currentDrawable == nil) {
+        // try again next refresh
+        [commandBuffer commit];
         return;
     }
 
@@ -293,166 +633,765 @@ static matrix_float4x4 matrix_scale_translate(CGFloat scale, CGPoint translate)
     // invalidateRenderSource:, so without this the view keeps re-rendering
     // an unchanged frame on every vsync forever.
     self.renderNeedsUpdate = NO;
+    self.renderIdleFrames = 0;
+    // everything that changed since the last refresh is in this one frame
+    if (self.renderPendingUpdates > 1) {
+        self.coalescedFrameCount += self.renderPendingUpdates - 1;
+    }
+    self.renderPendingUpdates = 0;
 
-    // synchronize with rendererQueue in order to access currentCommandBuffer
-    id<MTLCommandBuffer> commandBuffer = [_commandQueue commandBuffer];
-    commandBuffer.label = @"Draw Frame";
+    if (!commandBuffer) {
+        commandBuffer = [_commandQueue commandBuffer];
+        commandBuffer.label = @"Draw Frame";
+    }
 
-    [self _renderCommand:commandBuffer
-              drawSource:sourceData
-          viewportOrigin:self.renderViewportOrigin
-           viewportScale:self.renderViewportScale
-            viewportSize:self.renderViewportSize
-                 sampler:self.renderSampler
-    renderPassDescriptor:renderPassDescriptor];
+    if ([self _renderCommand:commandBuffer drawTiles:dirtyTiles]) {
+        self.fullFrameCount++;
+    } else {
+        self.partialFrameCount++;
+    }
+
+    // only what changed since the drawable was last presented is copied into it
+    CGRect damage = [self _damageOfDrawable:currentDrawable.texture];
+    BOOL copiesAll = CGRectEqualToRect(damage, CGRectMake(0, 0, currentDrawable.texture.width, currentDrawable.texture.height));
+    renderPassDescriptor.colorAttachments[0].loadAction = copiesAll ? MTLLoadActionClear : MTLLoadActionLoad;
+    id<MTLRenderCommandEncoder> renderEncoder =
+        [commandBuffer renderCommandEncoderWithDescriptor:renderPassDescriptor];
+    renderEncoder.label = @"View Presentation";
+    if (!view) {
+        // holding on to the texture would keep the drawable from going back to the layer
+        renderPassDescriptor.colorAttachments[0].texture = nil;
+    }
+    // an empty damage means the drawable already shows this frame
+    if (!CGRectIsEmpty(damage)) {
+        [renderEncoder setScissorRect:(MTLScissorRect){
+            .x = damage.origin.x,
+            .y = damage.origin.y,
+            .width = damage.size.width,
+            .height = damage.size.height,
+        }];
+        // Texture covering the whole drawable
+        CSRenderVertex frameVertices[6];
+        cs_quad_vertices(frameVertices, CGSizeMake(self.renderFrameTexture.width, self.renderFrameTexture.height));
+        [renderEncoder setVertexBytes:frameVertices
+                               length:sizeof(frameVertices)
+                              atIndex:CSRenderVertexInputIndexVertices];
+        [self _renderEncoder:renderEncoder
+                drawAtOrigin:CGPointZero
+                       scale:1.0f
+                    vertices:nil
+                numVerticies:6
+                    pipeline:[_pipelineCache pipelineWithColorFormat:colorFormat
+                                                         depthFormat:depthFormat
+                                                              filter:CSRenderFilterSampler
+                                                            hasAlpha:NO
+                                                          isInverted:NO]
+                     texture:self.renderFrameTexture
+                viewportSize:self.renderViewportSize
+                     sampler:_frameSampler];
+    }
+    [renderEncoder endEncoding];
 
     [commandBuffer presentDrawable:currentDrawable];
 
+    CFTimeInterval startTime = CACurrentMediaTime();
     [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
-        dispatch_async(dispatch_get_main_queue(), ^{
-            [self _completeDraw];
-        });
+        [self _completeFrame:commandBuffer startTime:startTime frameInterval:frameInterval];
     }];
+    [self _completeDrawAfterCommandBuffer:commandBuffer];
 
     // Finalize rendering here & push the command buffer to the GPU
     [commandBuffer commit];
 }
 
-- (void)renderSouce:(id<CSRenderSource>)renderSource
-         copyBuffer:(id<MTLBuffer>)sourceBuffer
-             region:(MTLRegion)region
-       sourceOffset:(NSUInteger)sourceOffset
-  sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
-         completion:(nullable completionCallback_t)completion {
+#pragma mark - Frame
 
-    _CSRendererSourceData *sourceData = [[_CSRendererSourceData alloc] initWithRenderSource:renderSource];
+/// Must be called on `renderQueue`
+///
+/// Make sure the frame texture matches the drawable, a new one is cleared when drawn.
+/// @returns NO if there is nothing to draw into
+- (BOOL)_prepareFrameTexture:(MTLPixelFormat)pixelFormat {
+    vector_uint2 size = self.renderViewportSize;
+    id<MTLTexture> texture = self.renderFrameTexture;
 
-    if (!sourceData) {
-        if (completion) {
-            completion();
-        }
-        return;
+    if (texture && texture.width == size.x && texture.height == size.y && texture.pixelFormat == pixelFormat) {
+        return YES;
     }
+    if (size.x == 0 || size.y == 0) {
+        return NO;
+    }
+    MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:pixelFormat
+                                                                                                 width:size.x
+                                                                                                height:size.y
+                                                                                             mipmapped:NO];
+    textureDescriptor.usage = MTLTextureUsageRenderTarget | MTLTextureUsageShaderRead;
+    textureDescriptor.storageMode = MTLStorageModePrivate;
+    self.renderFrameTexture = [_device newTextureWithDescriptor:textureDescriptor];
+    if (!self.renderFrameTexture) {
+        return NO;
+    }
+    self.renderFrameNeedsClear = YES;
+    return YES;
+}
 
-    id<MTLCommandBuffer> commandBuffer = [_commandQueue commandBuffer];
-    commandBuffer.label = @"Blit Command Buffer";
-    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
-    blitEncoder.label = @"Renderer Canvas Updates";
-
-    [blitEncoder copyFromBuffer:sourceBuffer
-                   sourceOffset:sourceOffset
-              sourceBytesPerRow:sourceBytesPerRow
-            sourceBytesPerImage:0
-                     sourceSize:region.size
-                      toTexture:sourceData.texture
-               destinationSlice:0
-               destinationLevel:0
-              destinationOrigin:region.origin];
-
-    [blitEncoder endEncoding];
-
-    [commandBuffer commit];
-
-    dispatch_async(dispatch_get_main_queue(), ^{
-        if (completion) {
-            [self _addDrawCompletion:completion];
+/// Must be called on `renderQueue`
+///
+/// Pixels of a drawable that are out of date, once the frame texture is, and remember
+/// that the drawable is about to be brought up to date.
+///
+/// A layer cycles through a few drawables that keep what was last drawn into them, so a
+/// drawable seen within the last few frames only needs what changed since. A drawable
+/// that is new, of a different size or last seen too long ago is copied in full.
+/// @returns Pixels to copy with the origin at the top left, all of the drawable if its contents are unknown
+- (CGRect)_damageOfDrawable:(id<MTLTexture>)drawableTexture {
+    id<MTLTexture> frameTexture = self.renderFrameTexture;
+    CGRect bounds = CGRectMake(0, 0, drawableTexture.width, drawableTexture.height);
+    CGRect damage = bounds;
+    NSUInteger slot = _drawableNext;
+    BOOL found = NO;
+
+    for (NSUInteger i = 0; i < kCSMetalRendererDamageHistory; i++) {
+        if (_drawableTextures[i] == drawableTexture) {
+            slot = i;
+            found = YES;
+            break;
         }
-        self.renderSourceData = sourceData;
-        self.renderNeedsUpdate = YES;
-    });
+    }
+    if (found && _frameNumber - _drawableFrames[slot] < kCSMetalRendererDamageHistory &&
+        drawableTexture.width == frameTexture.width && drawableTexture.height == frameTexture.height) {
+        damage = CGRectNull;
+        for (uint64_t frame = _drawableFrames[slot] + 1; frame <= _frameNumber; frame++) {
+            damage = CGRectUnion(damage, _frameDamage[frame % kCSMetalRendererDamageHistory]);
+        }
+        damage = CGRectIntersection(damage, bounds);
+    }
+    if (!found) {
+        _drawableNext = (_drawableNext + 1) % kCSMetalRendererDamageHistory;
+    }
+    _drawableTextures[slot] = drawableTexture;
+    _drawableFrames[slot] = _frameNumber;
+    return damage;
 }
 
-- (void)invalidateRenderSource:(id<CSRenderSource>)renderSource
-                withCompletion:(nullable completionCallback_t)completion {
-    _CSRendererSourceData *sourceData = [[_CSRendererSourceData alloc] initWithRenderSource:renderSource];
-    if (!sourceData || !sourceData.isVisible) {
-        if (completion) {
-            completion();
+/// Must be called on `renderQueue`
+///
+/// Outside of the mosaic there is a single tile covering the view, which is not drawn at
+/// all while its source is hidden: the last frame stays up instead.
+/// The array returned is reused by the next call.
+/// @returns Tiles to draw, or nil if nothing can be drawn
+- (nullable NSArray<_CSRendererTile *> *)_dirtyTiles {
+    NSMutableArray<_CSRendererTile *> *dirtyTiles = self.renderDirtyTiles;
+    for (NSInteger i = self.renderTiles.count - 1; i >= 0; i--) {
+        if (!self.renderTiles[i].renderSource) {
+            // source is gone, so is its tile
+            [self.renderTiles removeObjectAtIndex:i];
+            self.renderFrameNeedsClear = YES;
         }
-        return;
     }
-
-    dispatch_async(dispatch_get_main_queue(), ^{
-        if (completion) {
-            [self _addDrawCompletion:completion];
+    [dirtyTiles removeAllObjects];
+    if (self.renderTiles.count > 0) {
+        for (_CSRendererTile *tile in self.renderTiles) {
+            if (self.renderFrameNeedsClear || tile.needsRedraw || tile.needsCursorRedraw) {
+                [dirtyTiles addObject:tile];
+            }
         }
-        self.renderSourceData = sourceData;
-        self.renderNeedsUpdate = YES;
-    });
+    } else if (self.renderMainTile.sourceData.isVisible) {
+        _CSRendererTile *tile = self.renderMainTile;
+        if (self.renderFrameNeedsClear || tile.needsRedraw || tile.needsCursorRedraw) {
+            [dirtyTiles addObject:tile];
+        }
+    } else {
+        return nil;
+    }
+    return dirtyTiles;
 }
 
-- (void)disableRender {
-    dispatch_async(dispatch_get_main_queue(), ^{
-        self.renderSourceData = nil;
-        self.renderNeedsUpdate = NO;
-    });
+/// Must be called on `renderQueue`
+///
+/// Where a tile's source is drawn: its frame clipped to the view, and the position and
+/// scale of the source relative to the centre of the view.
+- (CGRect)_getTile:(_CSRendererTile *)tile center:(CGPoint *)center scale:(CGFloat *)scale {
+    vector_uint2 viewportSize = self.renderViewportSize;
+    CGRect bounds = CGRectMake(0, 0, viewportSize.x, viewportSize.y);
+
+    CGRect frame;
+    if (tile == self.renderMainTile) {
+        *center = self.renderViewportOrigin;
+        *scale = self.renderViewportScale;
+        frame = bounds;
+    } else {
+        *center = CGPointMake(CGRectGetMidX(tile.frame) - viewportSize.x / 2.0f,
+                              CGRectGetMidY(tile.frame) - viewportSize.y / 2.0f);
+        *scale = tile.scale;
+        frame = CGRectIntersection(CGRectIntegral(tile.frame), bounds);
+    }
+    if ([self _kernelForScale:*scale] == kCSMetalRendererKernelPixelPerfect && *scale > 1.0f) {
+        // whole pixels for every texel, on whole pixels of the view
+        *scale = floor(*scale);
+        *center = CGPointMake(round(center->x), round(center->y));
+    }
+    return frame;
 }
 
+/// Must be called on `renderQueue`
+///
+/// Find the pixels of the view covered by the cursor of a tile.
+/// @param rect Set to the cursor rectangle with the origin at the top left, or null if no cursor is shown
+/// @returns NO if the bounds of the cursor vertices are unknown, so the cursor could be anywhere
+- (BOOL)_getCursorRect:(CGRect *)rect ofTile:(_CSRendererTile *)tile center:(CGPoint)center scale:(CGFloat)scale {
+    _CSRendererSourceData *source = tile.sourceData;
+    _CSRendererSourceData *cursor = source.cursorSource;
+    vector_uint2 viewportSize = self.renderViewportSize;
+    CGRect bounds = cursor.vertexBounds;
+
+    *rect = CGRectNull;
+    if (!source.isVisible || !cursor.isVisible) {
+        return YES;
+    }
+    if (CGRectIsNull(bounds)) {
+        return NO;
+    }
+    CGPoint origin = CGPointMake(center.x + (source.offset.x + cursor.offset.x) * scale,
+                                 center.y + (source.offset.y + cursor.offset.y) * scale);
+    // vertices are y up from the centre, the rectangle is y down from the top left
+    *rect = CGRectMake(viewportSize.x / 2.0f + origin.x + CGRectGetMinX(bounds) * scale,
+                       viewportSize.y / 2.0f + origin.y - CGRectGetMaxY(bounds) * scale,
+                       bounds.size.width * scale,
+                       bounds.size.height * scale);
+    // filtering reaches one pixel past the edge
+    *rect = CGRectIntegral(CGRectInset(*rect, -1, -1));
+    return YES;
+}
+
+/// Must be called on `renderQueue`
+///
+/// The frame texture outlives the drawable, since what a drawable held when it was last
+/// presented is unknown, so only what changed is drawn into it. A tile whose source was
+/// updated is redrawn within its frame. A tile where only the cursor changed is redrawn
+/// within where the cursor was and where it is now, which for a moving pointer is a few
+/// thousand pixels rather than the whole display.
+/// @returns YES if any tile was redrawn in full
 - (BOOL)_renderCommand:(id<MTLCommandBuffer>)commandBuffer
-            drawSource:(id<CSRenderSource>)source
-        viewportOrigin:(CGPoint)viewportOrigin
-         viewportScale:(CGFloat)viewportScale
-          viewportSize:(vector_uint2)viewportSize
-               sampler:(id<MTLSamplerState>)sampler
-  renderPassDescriptor:(MTLRenderPassDescriptor *)renderPassDescriptor {
+             drawTiles:(NSArray<_CSRendererTile *> *)tiles {
+    BOOL redrawnTile = NO;
+    vector_uint2 viewportSize = self.renderViewportSize;
+    [self _updateMipmapsOfTiles:tiles commandBuffer:commandBuffer];
+    // a clear changes every pixel, otherwise only what the tiles draw changes
+    _frameDamageInProgress = self.renderFrameNeedsClear ? CGRectMake(0, 0, viewportSize.x, viewportSize.y) : CGRectNull;
+    MTLRenderPassDescriptor *renderPassDescriptor = self.renderFramePassDescriptor;
+    renderPassDescriptor.colorAttachments[0].texture = self.renderFrameTexture;
+    renderPassDescriptor.colorAttachments[0].loadAction = self.renderFrameNeedsClear ? MTLLoadActionClear : MTLLoadActionLoad;
+    renderPassDescriptor.colorAttachments[0].clearColor = MTLClearColorMake(0, 0, 0, 1);
+    renderPassDescriptor.colorAttachments[0].storeAction = MTLStoreActionStore;
+
     id<MTLRenderCommandEncoder> renderEncoder =
         [commandBuffer renderCommandEncoderWithDescriptor:renderPassDescriptor];
-    renderEncoder.label = @"View Presentation";
+    renderEncoder.label = @"Frame Update";
+
+    for (_CSRendererTile *tile in tiles) {
+        CGPoint center;
+        CGFloat scale;
+        CGRect cursorRect;
+        CGRect frame = [self _getTile:tile center:&center scale:&scale];
+        BOOL cursorKnown = [self _getCursorRect:&cursorRect ofTile:tile center:center scale:scale];
+
+        if (self.renderFrameNeedsClear || tile.needsRedraw || !cursorKnown) {
+            [self _renderEncoder:renderEncoder drawTile:tile inRect:frame frame:frame center:center scale:scale];
+            self.redrawnTileCount++;
+            redrawnTile = YES;
+        } else if (CGRectIntersectsRect(tile.cursorRect, cursorRect)) {
+            [self _renderEncoder:renderEncoder
+                        drawTile:tile
+                          inRect:CGRectIntersection(CGRectUnion(tile.cursorRect, cursorRect), frame)
+                           frame:frame
+                          center:center
+                           scale:scale];
+        } else {
+            [self _renderEncoder:renderEncoder
+                        drawTile:tile
+                          inRect:CGRectIntersection(tile.cursorRect, frame)
+                           frame:frame
+                          center:center
+                           scale:scale];
+            [self _renderEncoder:renderEncoder
+                        drawTile:tile
+                          inRect:CGRectIntersection(cursorRect, frame)
+                           frame:frame
+                          center:center
+                           scale:scale];
+        }
+        tile.cursorRect = cursorKnown ? cursorRect : CGRectNull;
+        tile.needsRedraw = NO;
+        tile.needsCursorRedraw = NO;
+    }
 
-    [renderEncoder setRenderPipelineState:_pipelineState];
+    [renderEncoder endEncoding];
+    self.renderFrameNeedsClear = NO;
+    _frameNumber++;
+    _frameDamage[_frameNumber % kCSMetalRendererDamageHistory] = CGRectIntegral(_frameDamageInProgress);
+    return redrawnTile;
+}
 
-    NSAssert(source.isVisible, @"Screen should be visible at this point!");
+/// Must be called on `renderQueue`
+///
+/// Bring the mipmapped copy of every tile downscaled with `kCSMetalRendererKernelMipmap` up
+/// to date. A copy is only rebuilt when its source was updated, so cursor redraws and a
+/// source that holds still reuse it.
+- (void)_updateMipmapsOfTiles:(NSArray<_CSRendererTile *> *)tiles commandBuffer:(id<MTLCommandBuffer>)commandBuffer {
+    id<MTLBlitCommandEncoder> blitEncoder = nil;
+
+    for (_CSRendererTile *tile in tiles) {
+        CGPoint center;
+        CGFloat scale;
+        [self _getTile:tile center:&center scale:&scale];
+        id<MTLTexture> texture = tile.sourceData.texture;
+        if ([self _kernelForScale:scale] != kCSMetalRendererKernelMipmap || !tile.sourceData.isVisible || !texture) {
+            tile.mipmapTexture = nil;
+            continue;
+        }
+        id<MTLTexture> mipmapTexture = tile.mipmapTexture;
+        if (!mipmapTexture || mipmapTexture.width != texture.width || mipmapTexture.height != texture.height ||
+            mipmapTexture.pixelFormat != texture.pixelFormat) {
+            MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:texture.pixelFormat
+                                                                                                         width:texture.width
+                                                                                                        height:texture.height
+                                                                                                     mipmapped:YES];
+            textureDescriptor.usage = MTLTextureUsageShaderRead;
+            textureDescriptor.storageMode = MTLStorageModePrivate;
+            mipmapTexture = [_device newTextureWithDescriptor:textureDescriptor];
+            tile.mipmapTexture = mipmapTexture;
+            tile.mipmapSourceTexture = nil;
+        } else if (!tile.needsRedraw && tile.mipmapSourceTexture == texture) {
+            continue;
+        }
+        if (!blitEncoder) {
+            blitEncoder = [commandBuffer blitCommandEncoder];
+            blitEncoder.label = @"Renderer Mipmaps";
+        }
+        [blitEncoder copyFromTexture:texture
+                         sourceSlice:0
+                         sourceLevel:0
+                        sourceOrigin:MTLOriginMake(0, 0, 0)
+                          sourceSize:MTLSizeMake(texture.width, texture.height, 1)
+                           toTexture:mipmapTexture
+                    destinationSlice:0
+                    destinationLevel:0
+                   destinationOrigin:MTLOriginMake(0, 0, 0)];
+        [blitEncoder generateMipmapsForTexture:mipmapTexture];
+        tile.mipmapSourceTexture = texture;
+    }
+    [blitEncoder endEncoding];
+}
 
-    CGPoint origin = CGPointMake(viewportOrigin.x + source.offset.x * viewportScale,
-                                 viewportOrigin.y + source.offset.y * viewportScale);
+/// Must be called on `renderQueue`
+///
+/// Draw the part of a tile inside a rectangle over what was there before.
+/// @param rect Pixels to draw, with the origin at the top left
+/// @param frame Pixels of the tile, with the origin at the top left
+- (void)_renderEncoder:(id<MTLRenderCommandEncoder>)renderEncoder
+              drawTile:(_CSRendererTile *)tile
+                inRect:(CGRect)rect
+                 frame:(CGRect)frame
+                center:(CGPoint)center
+                 scale:(CGFloat)scale {
+    vector_uint2 viewportSize = self.renderViewportSize;
+    _CSRendererSourceData *source = tile.sourceData;
+
+    if (CGRectIsEmpty(rect)) {
+        return;
+    }
+    _frameDamageInProgress = CGRectUnion(_frameDamageInProgress, rect);
+    MTLScissorRect scissor = {
+        .x = rect.origin.x,
+        .y = rect.origin.y,
+        .width = rect.size.width,
+        .height = rect.size.height,
+    };
+    [renderEncoder setScissorRect:scissor];
+
+    if (!self.renderFrameNeedsClear) {
+        CSRenderVertex clearVertices[6];
+        cs_quad_vertices(clearVertices, frame.size);
+        [renderEncoder setVertexBytes:clearVertices
+                               length:sizeof(clearVertices)
+                              atIndex:CSRenderVertexInputIndexVertices];
+        [self _renderEncoder:renderEncoder
+                drawAtOrigin:CGPointMake(CGRectGetMidX(frame) - viewportSize.x / 2.0f,
+                                         CGRectGetMidY(frame) - viewportSize.y / 2.0f)
+                       scale:1.0f
+                    vertices:nil
+                numVerticies:6
+                    pipeline:[self _framePipelineWithFilter:CSRenderFilterSampler hasAlpha:NO isInverted:NO]
+                     texture:_clearTexture
+                viewportSize:viewportSize
+                     sampler:_frameSampler];
+    }
 
+    if (!source.isVisible) {
+        return;
+    }
+    CGPoint origin = CGPointMake(center.x + source.offset.x * scale,
+                                 center.y + source.offset.y * scale);
+    id<MTLTexture> texture = source.texture;
+    id<MTLSamplerState> sampler = self.renderSampler;
+    CSRenderFilter filter = CSRenderFilterSampler;
+    switch ([self _kernelForScale:scale]) {
+        case kCSMetalRendererKernelPixelPerfect:
+            sampler = _frameSampler;
+            break;
+        case kCSMetalRendererKernelBicubic:
+        case kCSMetalRendererKernelLanczos: {
+            float footprint = MIN(MAX(1.0f / scale, 1.0f), kCSMetalRendererMaxFootprint);
+            filter = [self _kernelForScale:scale] == kCSMetalRendererKernelBicubic ? CSRenderFilterBicubic : CSRenderFilterLanczos;
+            [renderEncoder setFragmentBytes:&footprint
+                                     length:sizeof(footprint)
+                                    atIndex:CSRenderFragmentBufferIndexFootprint];
+            break;
+        }
+        case kCSMetalRendererKernelMipmap:
+            if (tile.mipmapTexture) {
+                texture = tile.mipmapTexture;
+                sampler = _mipmapSampler;
+            }
+            break;
+        case kCSMetalRendererKernelSampler:
+            break;
+    }
     [self _renderEncoder:renderEncoder
             drawAtOrigin:origin
-                   scale:viewportScale
+                   scale:scale
                 vertices:source.vertices
             numVerticies:source.numVertices
-                hasAlpha:source.hasAlpha
-              isInverted:source.isInverted
-                 texture:source.texture
+                pipeline:[self _framePipelineWithFilter:filter hasAlpha:source.hasAlpha isInverted:source.isInverted]
+                 texture:texture
             viewportSize:viewportSize
                  sampler:sampler];
 
     // Draw cursor
     if (source.cursorSource.isVisible) {
-        CGPoint cursorOrigin = CGPointMake(viewportOrigin.x + (source.offset.x + source.cursorSource.offset.x) * viewportScale,
-                                           viewportOrigin.y + (source.offset.y + source.cursorSource.offset.y) * viewportScale);
-        // Next render the cursor
+        CGPoint cursorOrigin = CGPointMake(center.x + (source.offset.x + source.cursorSource.offset.x) * scale,
+                                           center.y + (source.offset.y + source.cursorSource.offset.y) * scale);
         [self _renderEncoder:renderEncoder
                 drawAtOrigin:cursorOrigin
-                       scale:viewportScale
+                       scale:scale
                     vertices:source.cursorSource.vertices
                 numVerticies:source.cursorSource.numVertices
-                    hasAlpha:source.cursorSource.hasAlpha
-                  isInverted:source.cursorSource.isInverted
+                    pipeline:[self _framePipelineWithFilter:CSRenderFilterSampler
+                                                   hasAlpha:source.cursorSource.hasAlpha
+                                                 isInverted:source.cursorSource.isInverted]
                      texture:source.cursorSource.texture
                 viewportSize:viewportSize
-                     sampler:sampler];
+                     sampler:self.renderSampler];
     }
+}
 
-    [renderEncoder endEncoding];
+#pragma mark - Mosaic
+
+/// Must be called on `renderQueue`
+- (nullable _CSRendererTile *)_tileForRenderSource:(id<CSRenderSource>)renderSource {
+    for (_CSRendererTile *tile in self.renderTiles) {
+        if (tile.renderSource == renderSource) {
+            return tile;
+        }
+    }
+    return nil;
+}
+
+- (void)addRenderSource:(id<CSRenderSource>)renderSource frame:(CGRect)frame scale:(CGFloat)scale {
+    _CSRendererSourceData *sourceData = [[_CSRendererSourceData alloc] initWithRenderSource:renderSource];
+    dispatch_async(self.renderQueue, ^{
+        _CSRendererTile *tile = [self _tileForRenderSource:renderSource];
+        if (!tile) {
+            tile = [[_CSRendererTile alloc] initWithRenderSource:renderSource];
+            tile.sourceData = sourceData;
+            [self.renderTiles addObject:tile];
+        }
+        tile.frame = frame;
+        tile.scale = scale;
+        // whatever the tile covered before has to go as well
+        self.renderFrameNeedsClear = YES;
+        [self _setNeedsUpdate];
+    });
+}
+
+- (void)removeRenderSource:(id<CSRenderSource>)renderSource {
+    dispatch_async(self.renderQueue, ^{
+        _CSRendererTile *tile = [self _tileForRenderSource:renderSource];
+        if (!tile) {
+            return;
+        }
+        [self.renderTiles removeObject:tile];
+        self.renderFrameNeedsClear = YES;
+        [self _setNeedsUpdate];
+    });
+}
+
+#pragma mark - Render sources
+
+/// Must be called on `renderQueue`
+///
+/// The tile an update from a source goes to: its own in the mosaic, or the one covering the
+/// view that shows whichever source was updated last.
+- (_CSRendererTile *)_tileForUpdatedRenderSource:(id<CSRenderSource>)renderSource {
+    return [self _tileForRenderSource:renderSource] ?: self.renderMainTile;
+}
+
+static void cs_metal_renderer_apply_updates(void *context) {
+    CSMetalRenderer *self = (__bridge_transfer CSMetalRenderer *)context;
+    [self _applyUpdates];
+}
+
+/// Must be called holding `_updates`
+///
+/// The update a source is merged into until `renderQueue` takes it, there is one per
+/// source for as long as the source is around.
+- (_CSRendererUpdate *)_updateForRenderSource:(id<CSRenderSource>)renderSource {
+    for (_CSRendererUpdate *update in _updates) {
+        if (update.renderSource == renderSource) {
+            return update;
+        }
+    }
+    _CSRendererUpdate *update = [[_CSRendererUpdate alloc] initWithRenderSource:renderSource];
+    [_updates addObject:update];
+    return update;
+}
+
+/// Must be called holding `_updates`
+- (void)_postUpdate:(_CSRendererUpdate *)update {
+    update.isPending = YES;
+    update.count++;
+    update.sequence = ++_updateSequence;
+    [self _scheduleApplyUpdates];
+}
+
+/// Must be called holding `_updates`
+- (void)_scheduleApplyUpdates {
+    if (!_updateScheduled) {
+        // a function rather than a block, so posting allocates nothing
+        _updateScheduled = YES;
+        dispatch_async_f(self.renderQueue, (__bridge_retained void *)self, cs_metal_renderer_apply_updates);
+    }
+}
+
+/// Must be called on `renderQueue`
+///
+/// Take everything sources posted since the last time. Updates are merged per source
+/// while they wait, and applied in the order they were last posted in, so the view still
+/// shows whichever source was updated last. Copies and completions keep their order.
+- (void)_applyUpdates {
+    BOOL needsUpdate = NO;
+    @synchronized (_updates) {
+        _updateScheduled = NO;
+        if (_updateDisablesRender) {
+            // anything posted before it was dropped by `disableRender`
+            _updateDisablesRender = NO;
+            needsUpdate = [self _disableRender];
+        }
+        if (_updateCopies) {
+            if (self.renderLastPendingCopy) {
+                self.renderLastPendingCopy.next = _updateCopies;
+            } else {
+                self.renderPendingCopies = _updateCopies;
+            }
+            self.renderLastPendingCopy = _updateLastCopy;
+            _updateCopies = nil;
+            _updateLastCopy = nil;
+        }
+        [_updateCompletions moveToCompletions:self.renderCompletions];
+        for (;;) {
+            _CSRendererUpdate *next = nil;
+            for (_CSRendererUpdate *update in _updates) {
+                if (update.isPending && (!next || update.sequence < next.sequence)) {
+                    next = update;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            [self _applyUpdate:next];
+            needsUpdate = YES;
+        }
+        for (NSInteger i = _updates.count - 1; i >= 0; i--) {
+            if (!_updates[i].renderSource) {
+                [_updates removeObjectAtIndex:i];
+            }
+        }
+    }
+    if (needsUpdate) {
+        [self _setNeedsUpdate];
+    }
+}
+
+/// Must be called on `renderQueue` holding `_updates`
+- (void)_applyUpdate:(_CSRendererUpdate *)update {
+    id<CSRenderSource> renderSource = update.renderSource;
+    _CSRendererSourceData *sourceData = update.sourceData;
+
+    if (renderSource) {
+        _CSRendererTile *tile = [self _tileForUpdatedRenderSource:renderSource];
+        if (update.needsRedraw ||
+            tile.sourceData.texture != sourceData.texture ||
+            tile.sourceData.vertices != sourceData.vertices) {
+            // for a cursor update, the source changed under the cursor too
+            tile.needsRedraw = YES;
+        }
+        if (update.needsCursorRedraw) {
+            tile.needsCursorRedraw = YES;
+        }
+        if (!tile.sourceData) {
+            tile.sourceData = [[_CSRendererSourceData alloc] init];
+        }
+        [tile.sourceData updateWithSourceData:sourceData];
+        self.renderPendingUpdates += update.count;
+    }
+    update.isPending = NO;
+    update.needsRedraw = NO;
+    update.needsCursorRedraw = NO;
+    update.count = 0;
+}
+
+- (void)renderSouce:(id<CSRenderSource>)renderSource
+         copyBuffer:(id<MTLBuffer>)sourceBuffer
+            regions:(const MTLRegion *)regions
+      sourceOffsets:(const NSUInteger *)sourceOffsets
+              count:(NSUInteger)count
+  sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
+         completion:(nullable completionCallback_t)completion {
+    BOOL posted = NO;
+
+    @synchronized (_updates) {
+        _CSRendererUpdate *update = [self _updateForRenderSource:renderSource];
+        if ([update.sourceData updateWithRenderSource:renderSource atOffset:CGPointZero]) {
+            // encoded by the next `drawInMTKView:` together with the frame that presents it
+            _CSRendererCopy *copy = _freeCopies ?: [[_CSRendererCopy alloc] init];
+            _freeCopies = copy.next;
+            copy.next = nil;
+            if ([copy setBuffer:sourceBuffer
+                      toTexture:update.sourceData.texture
+                        regions:regions
+                  sourceOffsets:sourceOffsets
+                          count:count
+              sourceBytesPerRow:sourceBytesPerRow]) {
+                if (_updateLastCopy) {
+                    _updateLastCopy.next = copy;
+                } else {
+                    _updateCopies = copy;
+                }
+                _updateLastCopy = copy;
+                if (completion) {
+                    [_updateCompletions addCompletion:completion];
+                }
+                update.needsRedraw = YES;
+                [self _postUpdate:update];
+                posted = YES;
+            } else {
+                copy.next = _freeCopies;
+                _freeCopies = copy;
+            }
+        }
+    }
+    if (!posted && completion) {
+        completion();
+    }
+}
+
+- (void)invalidateRenderSource:(id<CSRenderSource>)renderSource
+                withCompletion:(nullable completionCallback_t)completion {
+    BOOL posted = NO;
+
+    if (renderSource.isVisible) {
+        @synchronized (_updates) {
+            _CSRendererUpdate *update = [self _updateForRenderSource:renderSource];
+            if ([update.sourceData updateWithRenderSource:renderSource atOffset:CGPointZero]) {
+                if (completion) {
+                    [_updateCompletions addCompletion:completion];
+                }
+                update.needsRedraw = YES;
+                [self _postUpdate:update];
+                posted = YES;
+            }
+        }
+    }
+    if (!posted && completion) {
+        completion();
+    }
+}
+
+- (void)invalidateCursorOfRenderSource:(id<CSRenderSource>)renderSource {
+    if (!renderSource.isVisible) {
+        return;
+    }
+    @synchronized (_updates) {
+        _CSRendererUpdate *update = [self _updateForRenderSource:renderSource];
+        if ([update.sourceData updateWithRenderSource:renderSource atOffset:CGPointZero]) {
+            update.needsCursorRedraw = YES;
+            [self _postUpdate:update];
+        }
+    }
+}
+
+- (void)disableRender {
+    @synchronized (_updates) {
+        // whatever is still waiting would be thrown away anyway, but not its completions
+        for (_CSRendererUpdate *update in _updates) {
+            update.isPending = NO;
+            update.needsRedraw = NO;
+            update.needsCursorRedraw = NO;
+            update.count = 0;
+        }
+        _updateDisablesRender = YES;
+        [self _scheduleApplyUpdates];
+    }
+}
+
+/// Must be called on `renderQueue`
+/// @returns YES if the mosaic has to be drawn again
+- (BOOL)_disableRender {
+    self.renderMainTile.sourceData = nil;
+    self.renderNeedsUpdate = NO;
+    if (self.renderTiles.count == 0) {
+        return NO;
+    }
+    // we are not told which source went away, so look at all of them again
+    for (_CSRendererTile *tile in self.renderTiles) {
+        id<CSRenderSource> renderSource = tile.renderSource;
+        tile.sourceData = renderSource ? [[_CSRendererSourceData alloc] initWithRenderSource:renderSource] : nil;
+        tile.needsRedraw = YES;
+    }
+    return YES;
+}
+
+/// Must be called on `renderQueue`
+- (id<MTLRenderPipelineState>)_framePipelineWithFilter:(CSRenderFilter)filter
+                                              hasAlpha:(BOOL)hasAlpha
+                                            isInverted:(BOOL)isInverted {
+    // the frame texture has no depth attachment
+    return [_pipelineCache pipelineWithColorFormat:self.renderFrameTexture.pixelFormat
+                                       depthFormat:MTLPixelFormatInvalid
+                                            filter:filter
+                                          hasAlpha:hasAlpha
+                                        isInverted:isInverted];
 }
 
 - (void)_renderEncoder:(id<MTLRenderCommandEncoder>)renderEncoder
           drawAtOrigin:(CGPoint)origin
                  scale:(CGFloat)scale
-              vertices:(id<MTLBuffer>)vertices
+              vertices:(nullable id<MTLBuffer>)vertices
           numVerticies:(NSUInteger)numVerticies
-              hasAlpha:(BOOL)hasAlpha
-            isInverted:(BOOL)isInverted
+              pipeline:(id<MTLRenderPipelineState>)pipeline
                texture:(id<MTLTexture>)texture
           viewportSize:(vector_uint2)viewportSize
                sampler:(id<MTLSamplerState>)sampler {
     matrix_float4x4 transform = matrix_scale_translate(scale,
                                                        origin);
 
-    [renderEncoder setVertexBuffer:vertices
-                            offset:0
-                          atIndex:CSRenderVertexInputIndexVertices];
+    [renderEncoder setRenderPipelineState:pipeline];
+
+    if (vertices) {
+        [renderEncoder setVertexBuffer:vertices
+                                offset:0
+                              atIndex:CSRenderVertexInputIndexVertices];
+    }
 
     [renderEncoder setVertexBytes:&viewportSize
                            length:sizeof(viewportSize)
@@ -462,10 +1401,6 @@ static matrix_float4x4 matrix_scale_translate(CGFloat scale, CGPoint translate)
                            length:sizeof(transform)
                           atIndex:CSRenderVertexInputIndexTransform];
 
-    [renderEncoder setVertexBytes:&hasAlpha
-                           length:sizeof(hasAlpha)
-                          atIndex:CSRenderVertexInputIndexHasAlpha];
-    
     // Set the texture object.  The CSRenderTextureIndexBaseColor enum value corresponds
     ///  to the 'colorMap' argument in our 'samplingShader' function because its
     //   texture attribute qualifier also uses CSRenderTextureIndexBaseColor for its index
@@ -475,10 +1410,6 @@ static matrix_float4x4 matrix_scale_translate(CGFloat scale, CGPoint translate)
     [renderEncoder setFragmentSamplerState:sampler
                                    atIndex:CSRenderSamplerIndexTexture];
     
-    [renderEncoder setFragmentBytes:&isInverted
-                             length:sizeof(isInverted)
-                            atIndex:CSRenderFragmentBufferIndexIsInverted];
-
     // Draw the vertices of our triangles
     [renderEncoder drawPrimitives:MTLPrimitiveTypeTriangle
                       vertexStart:0
@@ -0,0 +1,184 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CSPixelConversion.h"
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Nearest 8-bit value to c * 255 / 31, what the GPU gives when sampling a 5-bit unorm
+static inline uint8_t widen5(uint16_t c) {
+    return (uint8_t)((c * 527 + 23) >> 6);
+}
+
+static void convert_row_scalar(uint8_t *dst, const uint8_t *src, size_t width) {
+    for (size_t x = 0; x < width; x++) {
+        uint16_t v = (uint16_t)(src[x * 2] | (src[x * 2 + 1] << 8));
+        dst[x * 4 + 0] = widen5(v & 0x1f);
+        dst[x * 4 + 1] = widen5((v >> 5) & 0x1f);
+        dst[x * 4 + 2] = widen5((v >> 10) & 0x1f);
+        dst[x * 4 + 3] = 0xff;
+    }
+}
+
+#if defined(__ARM_NEON)
+
+// 8 pixels at a time, widened in 16-bit lanes then narrowed and stored interleaved
+static size_t convert_row_vector(uint8_t *dst, const uint8_t *src, size_t width) {
+    const uint16x8_t mask = vdupq_n_u16(0x1f);
+    const uint16x8_t bias = vdupq_n_u16(23);
+    uint8x8x4_t out;
+    size_t x = 0;
+
+    out.val[3] = vdup_n_u8(0xff);
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + x * 2));
+        uint16x8_t b = vandq_u16(v, mask);
+        uint16x8_t g = vandq_u16(vshrq_n_u16(v, 5), mask);
+        uint16x8_t r = vandq_u16(vshrq_n_u16(v, 10), mask);
+        out.val[0] = vshrn_n_u16(vmlaq_n_u16(bias, b, 527), 6);
+        out.val[1] = vshrn_n_u16(vmlaq_n_u16(bias, g, 527), 6);
+        out.val[2] = vshrn_n_u16(vmlaq_n_u16(bias, r, 527), 6);
+        vst4_u8(dst + x * 4, out);
+    }
+    return x;
+}
+
+#elif defined(__SSE2__)
+
+// 8 pixels at a time: B | G << 8 and R | 0xff00 in 16-bit lanes, interleaved into 32-bit pixels
+static size_t convert_row_vector(uint8_t *dst, const uint8_t *src, size_t width) {
+    const __m128i mask = _mm_set1_epi16(0x1f);
+    const __m128i scale = _mm_set1_epi16(527);
+    const __m128i bias = _mm_set1_epi16(23);
+    const __m128i alpha = _mm_set1_epi16((short)0xff00);
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 2));
+        __m128i b = _mm_and_si128(v, mask);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask);
+        __m128i r = _mm_and_si128(_mm_srli_epi16(v, 10), mask);
+        b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, scale), bias), 6);
+        g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, scale), bias), 6);
+        r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, scale), bias), 6);
+        __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+        __m128i ra = _mm_or_si128(r, alpha);
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128((__m128i *)(dst + x * 4 + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+    return x;
+}
+
+#else
+
+static size_t convert_row_vector(uint8_t *dst, const uint8_t *src, size_t width) {
+    return 0;
+}
+
+#endif
+
+void cs_convert_xrgb1555_to_bgra8(uint8_t *dst,
+                                  size_t dstBytesPerRow,
+                                  const void *src,
+                                  size_t srcBytesPerRow,
+                                  size_t width,
+                                  size_t height) {
+    const uint8_t *srcRow = src;
+
+    for (size_t y = 0; y < height; y++) {
+        size_t done = convert_row_vector(dst, srcRow, width);
+        convert_row_scalar(dst + done * 4, srcRow + done * 2, width - done);
+        dst += dstBytesPerRow;
+        srcRow += srcBytesPerRow;
+    }
+}
+
+// Source column or row of the sample a quarter (`quarter` 1) or three quarters (3) into
+// destination pixel `d`
+static inline size_t sample_position(size_t d, size_t quarter, size_t srcSize, size_t dstSize) {
+    size_t s = ((4 * d + quarter) * srcSize) / (4 * dstSize);
+    return s < srcSize ? s : srcSize - 1;
+}
+
+// Adds the blue, green and red of one source pixel to `sum`
+static inline void accumulate(uint32_t sum[3], const uint8_t *row, size_t x, CSDownscaleSource format) {
+    switch (format) {
+        case kCSDownscaleSourceBGRX8:
+            sum[0] += row[x * 4 + 0];
+            sum[1] += row[x * 4 + 1];
+            sum[2] += row[x * 4 + 2];
+            break;
+        case kCSDownscaleSourceRGBX8:
+            sum[0] += row[x * 4 + 2];
+            sum[1] += row[x * 4 + 1];
+            sum[2] += row[x * 4 + 0];
+            break;
+        case kCSDownscaleSourceXRGB1555: {
+            uint16_t v = (uint16_t)(row[x * 2] | (row[x * 2 + 1] << 8));
+            sum[0] += widen5(v & 0x1f);
+            sum[1] += widen5((v >> 5) & 0x1f);
+            sum[2] += widen5((v >> 10) & 0x1f);
+            break;
+        }
+    }
+}
+
+void cs_downscale_to_bgra8(uint8_t *dst,
+                           size_t dstBytesPerRow,
+                           size_t dstWidth,
+                           size_t dstHeight,
+                           const void *src,
+                           size_t srcBytesPerRow,
+                           size_t srcWidth,
+                           size_t srcHeight,
+                           CSDownscaleSource format,
+                           size_t x,
+                           size_t y,
+                           size_t width,
+                           size_t height) {
+    if (dstWidth == 0 || dstHeight == 0 || srcWidth == 0 || srcHeight == 0 || width == 0 || height == 0) {
+        return;
+    }
+    // every destination pixel whose footprint overlaps the rectangle
+    size_t dx0 = x * dstWidth / srcWidth;
+    size_t dy0 = y * dstHeight / srcHeight;
+    size_t dx1 = ((x + width) * dstWidth + srcWidth - 1) / srcWidth;
+    size_t dy1 = ((y + height) * dstHeight + srcHeight - 1) / srcHeight;
+    dx1 = dx1 < dstWidth ? dx1 : dstWidth;
+    dy1 = dy1 < dstHeight ? dy1 : dstHeight;
+
+    for (size_t dy = dy0; dy < dy1; dy++) {
+        const uint8_t *top = (const uint8_t *)src + sample_position(dy, 1, srcHeight, dstHeight) * srcBytesPerRow;
+        const uint8_t *bottom = (const uint8_t *)src + sample_position(dy, 3, srcHeight, dstHeight) * srcBytesPerRow;
+        uint8_t *out = dst + dy * dstBytesPerRow;
+        for (size_t dx = dx0; dx < dx1; dx++) {
+            size_t left = sample_position(dx, 1, srcWidth, dstWidth);
+            size_t right = sample_position(dx, 3, srcWidth, dstWidth);
+            uint32_t sum[3] = { 2, 2, 2 };
+            accumulate(sum, top, left, format);
+            accumulate(sum, top, right, format);
+            accumulate(sum, bottom, left, format);
+            accumulate(sum, bottom, right, format);
+            out[dx * 4 + 0] = (uint8_t)(sum[0] >> 2);
+            out[dx * 4 + 1] = (uint8_t)(sum[1] >> 2);
+            out[dx * 4 + 2] = (uint8_t)(sum[2] >> 2);
+            out[dx * 4 + 3] = 0xff;
+        }
+    }
+}
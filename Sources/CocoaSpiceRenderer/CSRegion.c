@@ -0,0 +1,308 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CSRegion.h"
+#include <string.h>
+
+// A merge wasting no more than this many pixels is always taken: one larger copy is
+//   cheaper than two small ones at that size
+#define CS_REGION_MERGE_SLACK (64 * 64)
+
+// Otherwise a merge is taken when damage fills at least 7/8 of the bounding box
+#define CS_REGION_MERGE_FILL_SHIFT 3
+
+// Splitting a rectangle against every pending one yields at most this many pieces
+//   before we give up on precision and merge instead
+#define CS_REGION_MAX_PIECES (4 * CS_REGION_MAX_RECTS)
+
+static inline int32_t rect_right(CSRegionRect r) {
+    return r.x + r.width;
+}
+
+static inline int32_t rect_bottom(CSRegionRect r) {
+    return r.y + r.height;
+}
+
+static inline bool rect_is_empty(CSRegionRect r) {
+    return r.width <= 0 || r.height <= 0;
+}
+
+static inline uint64_t rect_area(CSRegionRect r) {
+    return rect_is_empty(r) ? 0 : (uint64_t)r.width * (uint64_t)r.height;
+}
+
+/// True if the rectangles share at least one pixel, touching edges do not count
+static inline bool rect_intersects(CSRegionRect a, CSRegionRect b) {
+    return a.x < rect_right(b) && b.x < rect_right(a) &&
+           a.y < rect_bottom(b) && b.y < rect_bottom(a);
+}
+
+static inline bool rect_contains(CSRegionRect outer, CSRegionRect inner) {
+    return outer.x <= inner.x && outer.y <= inner.y &&
+           rect_right(inner) <= rect_right(outer) && rect_bottom(inner) <= rect_bottom(outer);
+}
+
+static inline CSRegionRect rect_union(CSRegionRect a, CSRegionRect b) {
+    int32_t x = a.x < b.x ? a.x : b.x;
+    int32_t y = a.y < b.y ? a.y : b.y;
+    int32_t right = rect_right(a) > rect_right(b) ? rect_right(a) : rect_right(b);
+    int32_t bottom = rect_bottom(a) > rect_bottom(b) ? rect_bottom(a) : rect_bottom(b);
+    return (CSRegionRect){ x, y, right - x, bottom - y };
+}
+
+static inline CSRegionRect rect_intersection(CSRegionRect a, CSRegionRect b) {
+    int32_t x = a.x > b.x ? a.x : b.x;
+    int32_t y = a.y > b.y ? a.y : b.y;
+    int32_t right = rect_right(a) < rect_right(b) ? rect_right(a) : rect_right(b);
+    int32_t bottom = rect_bottom(a) < rect_bottom(b) ? rect_bottom(a) : rect_bottom(b);
+    if (right <= x || bottom <= y) {
+        return (CSRegionRect){ 0, 0, 0, 0 };
+    }
+    return (CSRegionRect){ x, y, right - x, bottom - y };
+}
+
+/// Grow `box` until it contains every pending rectangle it touches.
+///
+/// Returns a mask of the rectangles swallowed, and in `covered` how many pixels of the
+/// box they account for. Pending rectangles are disjoint so the sum is exact.
+static uint32_t region_absorb(const CSRegion *region, CSRegionRect *box, uint64_t *covered) {
+    uint32_t mask = 0;
+    bool grew;
+
+    *covered = 0;
+    do {
+        grew = false;
+        for (size_t i = 0; i < region->count; i++) {
+            if (!(mask & (1u << i)) && rect_intersects(*box, region->rects[i])) {
+                mask |= 1u << i;
+                *covered += rect_area(region->rects[i]);
+                *box = rect_union(*box, region->rects[i]);
+                grew = true;
+            }
+        }
+    } while (grew);
+    return mask;
+}
+
+/// Replace the rectangles in `mask` by `box`, which must contain all of them
+static void region_replace(CSRegion *region, uint32_t mask, CSRegionRect box) {
+    size_t count = 0;
+
+    for (size_t i = 0; i < region->count; i++) {
+        if (!(mask & (1u << i))) {
+            region->rects[count++] = region->rects[i];
+        }
+    }
+    region->rects[count++] = box;
+    region->count = count;
+}
+
+/// Pixels that would be uploaded without being damaged if rectangles `i` and `j` (and
+/// anything in between) were replaced by their bounding box
+static uint64_t region_merge_waste(const CSRegion *region, size_t i, size_t j,
+                                   CSRegionRect *box, uint32_t *mask) {
+    uint64_t covered;
+
+    *box = rect_union(region->rects[i], region->rects[j]);
+    *mask = region_absorb(region, box, &covered);
+    return rect_area(*box) - covered;
+}
+
+static inline bool merge_is_cheap(uint64_t waste, CSRegionRect box) {
+    return waste <= CS_REGION_MERGE_SLACK ||
+           waste <= (rect_area(box) >> CS_REGION_MERGE_FILL_SHIFT);
+}
+
+/// Merge the cheapest pairs until the region is back within `CS_REGION_MAX_RECTS`
+///
+/// Pairs are ranked by the waste of their own bounding box alone, which is quadratic
+/// rather than cubic in the number of rectangles and only overestimates the waste of
+/// boxes that happen to enclose other pending damage.
+static void region_shrink(CSRegion *region) {
+    while (region->count > CS_REGION_MAX_RECTS) {
+        uint64_t bestWaste = UINT64_MAX;
+        size_t bestI = 0, bestJ = 1;
+        CSRegionRect box;
+        uint32_t mask;
+
+        for (size_t i = 0; i < region->count; i++) {
+            for (size_t j = i + 1; j < region->count; j++) {
+                uint64_t waste = rect_area(rect_union(region->rects[i], region->rects[j])) -
+                                 rect_area(region->rects[i]) - rect_area(region->rects[j]);
+                if (waste < bestWaste) {
+                    bestWaste = waste;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+        }
+        region_merge_waste(region, bestI, bestJ, &box, &mask);
+        region_replace(region, mask, box);
+    }
+}
+
+/// Append a rectangle that intersects nothing pending, folding it into a neighbour
+/// when that is cheap
+static void region_insert(CSRegion *region, CSRegionRect rect) {
+    bool merged;
+
+    region->rects[region->count++] = rect;
+    do {
+        // a merged box is always appended last, so it stays the newcomer
+        size_t last = region->count - 1;
+        merged = false;
+        for (size_t i = 0; i < last; i++) {
+            CSRegionRect box;
+            uint32_t mask;
+            uint64_t waste = region_merge_waste(region, i, last, &box, &mask);
+            if (merge_is_cheap(waste, box)) {
+                region_replace(region, mask, box);
+                merged = true;
+                break;
+            }
+        }
+    } while (merged);
+    region_shrink(region);
+}
+
+/// Split `rect` into the pieces no pending rectangle covers.
+///
+/// Returns the number of pieces, or `SIZE_MAX` if there would be more than
+/// `CS_REGION_MAX_PIECES`.
+static size_t region_subtract(const CSRegion *region, CSRegionRect rect,
+                              CSRegionRect pieces[CS_REGION_MAX_PIECES]) {
+    CSRegionRect next[CS_REGION_MAX_PIECES];
+    size_t count = 1;
+
+    pieces[0] = rect;
+    for (size_t i = 0; i < region->count && count > 0; i++) {
+        CSRegionRect e = region->rects[i];
+        size_t nextCount = 0;
+
+        for (size_t k = 0; k < count; k++) {
+            CSRegionRect p = pieces[k];
+            CSRegionRect split[4];
+            size_t splitCount = 0;
+
+            if (!rect_intersects(p, e)) {
+                split[splitCount++] = p;
+            } else {
+                int32_t top = p.y > e.y ? p.y : e.y;
+                int32_t bottom = rect_bottom(p) < rect_bottom(e) ? rect_bottom(p) : rect_bottom(e);
+                // full width bands above and below, then what is left and right of `e`
+                if (p.y < e.y) {
+                    split[splitCount++] = (CSRegionRect){ p.x, p.y, p.width, e.y - p.y };
+                }
+                if (rect_bottom(p) > rect_bottom(e)) {
+                    split[splitCount++] = (CSRegionRect){ p.x, rect_bottom(e), p.width, rect_bottom(p) - rect_bottom(e) };
+                }
+                if (p.x < e.x) {
+                    split[splitCount++] = (CSRegionRect){ p.x, top, e.x - p.x, bottom - top };
+                }
+                if (rect_right(p) > rect_right(e)) {
+                    split[splitCount++] = (CSRegionRect){ rect_right(e), top, rect_right(p) - rect_right(e), bottom - top };
+                }
+            }
+            if (nextCount + splitCount > CS_REGION_MAX_PIECES) {
+                return SIZE_MAX;
+            }
+            memcpy(&next[nextCount], split, splitCount * sizeof(CSRegionRect));
+            nextCount += splitCount;
+        }
+        memcpy(pieces, next, nextCount * sizeof(CSRegionRect));
+        count = nextCount;
+    }
+    return count;
+}
+
+static void region_add_uncovered(CSRegion *region, CSRegionRect rect) {
+    CSRegionRect pieces[CS_REGION_MAX_PIECES];
+    size_t count = region_subtract(region, rect, pieces);
+
+    if (count == SIZE_MAX) {
+        // too fragmented to be worth it, swallow everything it touches instead
+        uint64_t covered;
+        uint32_t mask = region_absorb(region, &rect, &covered);
+        region_replace(region, mask, rect);
+        region_shrink(region);
+        return;
+    }
+    for (size_t k = 0; k < count; k++) {
+        CSRegionRect box = pieces[k];
+        uint64_t covered;
+        // inserting an earlier piece may have grown a neighbour over this one
+        if (region_absorb(region, &box, &covered) != 0) {
+            region_add_uncovered(region, pieces[k]);
+        } else {
+            region_insert(region, pieces[k]);
+        }
+    }
+}
+
+void cs_region_init(CSRegion *region) {
+    memset(region, 0, sizeof(*region));
+}
+
+void cs_region_clear(CSRegion *region) {
+    region->count = 0;
+}
+
+bool cs_region_is_empty(const CSRegion *region) {
+    return region->count == 0;
+}
+
+uint64_t cs_region_area(const CSRegion *region) {
+    uint64_t area = 0;
+
+    for (size_t i = 0; i < region->count; i++) {
+        area += rect_area(region->rects[i]);
+    }
+    return area;
+}
+
+CSRegionRect cs_region_extents(const CSRegion *region) {
+    CSRegionRect extents = { 0, 0, 0, 0 };
+
+    for (size_t i = 0; i < region->count; i++) {
+        extents = i == 0 ? region->rects[0] : rect_union(extents, region->rects[i]);
+    }
+    return extents;
+}
+
+void cs_region_add(CSRegion *region, CSRegionRect rect) {
+    uint64_t damaged = rect_area(rect);
+
+    if (damaged == 0) {
+        return;
+    }
+    for (size_t i = 0; i < region->count; i++) {
+        if (rect_contains(region->rects[i], rect)) {
+            return; // already pending, the common case for repeated updates
+        }
+        damaged -= rect_area(rect_intersection(rect, region->rects[i]));
+    }
+    region->damagedPixels += damaged;
+    region_add_uncovered(region, rect);
+}
+
+size_t cs_region_flush(CSRegion *region, CSRegionRect rects[CS_REGION_MAX_RECTS]) {
+    size_t count = region->count;
+
+    memcpy(rects, region->rects, count * sizeof(CSRegionRect));
+    region->uploadedPixels += cs_region_area(region);
+    region->count = 0;
+    return count;
+}
@@ -0,0 +1,53 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+#import <TargetConditionals.h>
+@import CoreGraphics;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Calls back once per display refresh on a queue of our choosing
+///
+/// Refreshes come from CVDisplayLink on macOS and from a CADisplayLink on a thread of its
+/// own elsewhere, so neither depends on the main thread being free.
+@interface _CSRendererDisplayLink : NSObject
+
+/// Seconds between refreshes of the display, 0 until the first one
+@property (atomic, readonly) CFTimeInterval refreshPeriod;
+
+/// No callbacks at all while paused, defaults to NO
+@property (atomic, getter=isPaused) BOOL paused;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Start calling back
+/// @param queue Serial queue to call back on
+/// @param handler Called on `queue` for every refresh, a refresh that comes before the handler ran for the last one is skipped
+- (instancetype)initWithQueue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler NS_DESIGNATED_INITIALIZER;
+
+#if TARGET_OS_OSX
+/// Follow the refreshes of another display
+/// @param displayID Display the view is on
+- (void)setDisplayID:(CGDirectDisplayID)displayID;
+#endif
+
+/// Stop for good, must be called before the last reference to it goes
+- (void)invalidate;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,210 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <stdatomic.h>
+#import "CSRendererDisplayLink.h"
+#if TARGET_OS_OSX
+@import CoreVideo;
+#else
+@import QuartzCore;
+#endif
+
+@interface _CSRendererDisplayLink ()
+
+@property (nonatomic, readonly) dispatch_queue_t queue;
+@property (nonatomic, readonly) dispatch_block_t handler;
+@property (atomic, readwrite) CFTimeInterval refreshPeriod;
+@property (atomic) BOOL isInvalidated;
+#if !TARGET_OS_OSX
+// These must only be accessed on `thread`
+@property (nonatomic, readonly) NSThread *thread;
+@property (nonatomic, nullable) CADisplayLink *displayLink;
+#endif
+
+@end
+
+@implementation _CSRendererDisplayLink {
+    // a refresh is waiting for `queue`
+    atomic_bool _firePending;
+#if TARGET_OS_OSX
+    CVDisplayLinkRef _displayLink;
+#endif
+}
+
+@synthesize paused = _paused;
+
+static void cs_renderer_display_link_fire(void *context) {
+    _CSRendererDisplayLink *self = (__bridge_transfer _CSRendererDisplayLink *)context;
+    atomic_store(&self->_firePending, false);
+    if (!self.isPaused && !self.isInvalidated) {
+        self.handler();
+    }
+}
+
+/// Called from the display link's thread for every refresh
+- (void)fire {
+    // a handler that is running late only runs once more, not once per refresh missed
+    if (!atomic_exchange(&_firePending, true)) {
+        dispatch_async_f(self.queue, (__bridge_retained void *)self, cs_renderer_display_link_fire);
+    }
+}
+
+#if TARGET_OS_OSX
+
+static CVReturn cs_renderer_display_link_output(CVDisplayLinkRef displayLink,
+                                                const CVTimeStamp *now,
+                                                const CVTimeStamp *outputTime,
+                                                CVOptionFlags flagsIn,
+                                                CVOptionFlags *flagsOut,
+                                                void *context) {
+    _CSRendererDisplayLink *self = (__bridge _CSRendererDisplayLink *)context;
+    if (outputTime->videoTimeScale > 0 && outputTime->videoRefreshPeriod > 0) {
+        self.refreshPeriod = (CFTimeInterval)outputTime->videoRefreshPeriod / outputTime->videoTimeScale;
+    }
+    [self fire];
+    return kCVReturnSuccess;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler {
+    if (self = [super init]) {
+        _queue = queue;
+        _handler = handler;
+        atomic_init(&_firePending, false);
+        if (CVDisplayLinkCreateWithActiveCGDisplays(&_displayLink) != kCVReturnSuccess) {
+            return nil;
+        }
+        // unretained, `invalidate` stops the callbacks before we can go away
+        CVDisplayLinkSetOutputCallback(_displayLink, cs_renderer_display_link_output, (__bridge void *)self);
+        CVDisplayLinkStart(_displayLink);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    CVDisplayLinkRelease(_displayLink);
+}
+
+- (void)setDisplayID:(CGDirectDisplayID)displayID {
+    CVDisplayLinkSetCurrentCGDisplay(_displayLink, displayID);
+}
+
+- (BOOL)isPaused {
+    @synchronized (self) {
+        return _paused;
+    }
+}
+
+- (void)setPaused:(BOOL)paused {
+    @synchronized (self) {
+        if (_paused == paused || self.isInvalidated) {
+            return;
+        }
+        _paused = paused;
+        if (paused) {
+            CVDisplayLinkStop(_displayLink);
+        } else {
+            CVDisplayLinkStart(_displayLink);
+        }
+    }
+}
+
+- (void)invalidate {
+    @synchronized (self) {
+        self.isInvalidated = YES;
+        CVDisplayLinkStop(_displayLink);
+    }
+}
+
+#pragma clang diagnostic pop
+
+#else /* !TARGET_OS_OSX */
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue handler:(dispatch_block_t)handler {
+    if (self = [super init]) {
+        _queue = queue;
+        _handler = handler;
+        atomic_init(&_firePending, false);
+        // the thread holds on to us until `invalidate` lets it finish
+        _thread = [[NSThread alloc] initWithTarget:self selector:@selector(runDisplayLink) object:nil];
+        _thread.name = @"CSRendererDisplayLink";
+        _thread.qualityOfService = NSQualityOfServiceUserInteractive;
+        [_thread start];
+    }
+    return self;
+}
+
+/// Must be called on `thread`
+- (void)runDisplayLink {
+    @autoreleasepool {
+        self.displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(displayLinkDidFire:)];
+        [self updatePaused];
+        [self.displayLink addToRunLoop:NSRunLoop.currentRunLoop forMode:NSRunLoopCommonModes];
+        // keeps the run loop waiting rather than spinning while the display link is paused
+        [NSRunLoop.currentRunLoop addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+    }
+    while (!self.isInvalidated) {
+        @autoreleasepool {
+            [NSRunLoop.currentRunLoop runMode:NSDefaultRunLoopMode beforeDate:NSDate.distantFuture];
+        }
+    }
+}
+
+/// Must be called on `thread`
+- (void)displayLinkDidFire:(CADisplayLink *)displayLink {
+    self.refreshPeriod = displayLink.duration;
+    [self fire];
+}
+
+/// Must be called on `thread`
+- (void)updatePaused {
+    self.displayLink.paused = self.isPaused;
+}
+
+/// Must be called on `thread`
+- (void)stopDisplayLink {
+    // the display link holds on to us as well
+    [self.displayLink invalidate];
+    self.displayLink = nil;
+}
+
+- (BOOL)isPaused {
+    @synchronized (self) {
+        return _paused;
+    }
+}
+
+- (void)setPaused:(BOOL)paused {
+    @synchronized (self) {
+        if (_paused == paused || self.isInvalidated) {
+            return;
+        }
+        _paused = paused;
+    }
+    [self performSelector:@selector(updatePaused) onThread:self.thread withObject:nil waitUntilDone:NO];
+}
+
+- (void)invalidate {
+    self.isInvalidated = YES;
+    // also wakes the run loop so the thread sees it is done
+    [self performSelector:@selector(stopDisplayLink) onThread:self.thread withObject:nil waitUntilDone:NO];
+}
+
+#endif /* TARGET_OS_OSX */
+
+@end
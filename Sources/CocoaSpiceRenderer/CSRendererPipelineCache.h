@@ -0,0 +1,53 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import Metal;
+#import "CSShaderTypes.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Render pipelines shared by every renderer on a device
+///
+/// Each pipeline is the sampling shader specialized for one combination of filter, alpha
+/// and inversion, and is only created the first time a renderer asks for it. Where binary
+/// archives are supported (macOS 11, iOS 14), pipelines are also kept on disk so the next
+/// launch does not compile them again.
+@interface _CSRendererPipelineCache : NSObject
+
+@property (nonatomic, readonly) id<MTLDevice> device;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The cache for a device, created on first use and kept for the life of the process
+/// @param device Device to create pipelines on
++ (instancetype)pipelineCacheForDevice:(id<MTLDevice>)device;
+
+/// Find or create a pipeline
+/// @param colorFormat Pixel format of the color attachment
+/// @param depthFormat Pixel format of the depth attachment, can be `MTLPixelFormatInvalid`
+/// @param filter How the texture is read
+/// @param hasAlpha NO to draw the texture opaque
+/// @param isInverted YES to swap the red and blue channels
+- (id<MTLRenderPipelineState>)pipelineWithColorFormat:(MTLPixelFormat)colorFormat
+                                          depthFormat:(MTLPixelFormat)depthFormat
+                                               filter:(CSRenderFilter)filter
+                                             hasAlpha:(BOOL)hasAlpha
+                                           isInverted:(BOOL)isInverted;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,228 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSRendererPipelineCache.h"
+
+/// Seconds to wait for more pipelines before writing the archive
+static const NSTimeInterval kCSRendererPipelineArchiveDelay = 1.0;
+
+@interface _CSRendererPipelineCache ()
+
+@property (nonatomic, readonly) id<MTLLibrary> library;
+@property (nonatomic, readonly) id<MTLFunction> vertexFunction;
+@property (nonatomic, readonly) NSMutableDictionary<NSNumber *, id<MTLRenderPipelineState>> *pipelines;
+@property (nonatomic, nullable) id<MTLBinaryArchive> archive API_AVAILABLE(macos(11.0), ios(14.0));
+@property (nonatomic, nullable) NSURL *archiveURL;
+@property (nonatomic) BOOL archiveSaveScheduled;
+
+@end
+
+@implementation _CSRendererPipelineCache
+
++ (instancetype)pipelineCacheForDevice:(id<MTLDevice>)device {
+    // there is one per GPU, and they are meant to be shared for as long as it is around
+    static NSMapTable<id<MTLDevice>, _CSRendererPipelineCache *> *caches;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        caches = [NSMapTable strongToStrongObjectsMapTable];
+    });
+    @synchronized (caches) {
+        _CSRendererPipelineCache *cache = [caches objectForKey:device];
+        if (!cache) {
+            cache = [[self alloc] initWithDevice:device];
+            [caches setObject:cache forKey:device];
+        }
+        return cache;
+    }
+}
+
+/// The bundle our shaders are compiled into
++ (NSBundle *)shaderBundle {
+    // FIXME: on Swift we have `Bundle.module` generated by SPM but it doesn't appear to be the case for Obj-C
+    NSURL *modulePath = [NSBundle.mainBundle.resourceURL URLByAppendingPathComponent:@"CocoaSpice_CocoaSpiceRenderer.bundle"];
+    NSBundle *bundle = [NSBundle bundleWithURL:modulePath];
+    if (!bundle) {
+        // outside of an app, such as in tests, the bundle is next to the binary
+        modulePath = [[NSBundle bundleForClass:self].bundleURL.URLByDeletingLastPathComponent URLByAppendingPathComponent:@"CocoaSpice_CocoaSpiceRenderer.bundle"];
+        bundle = [NSBundle bundleWithURL:modulePath];
+    }
+    return bundle;
+}
+
+/// Where the archive of a device is kept
++ (nullable NSURL *)archiveURLForDevice:(id<MTLDevice>)device {
+    NSURL *cachesURL = [NSFileManager.defaultManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask].firstObject;
+    if (!cachesURL) {
+        return nil;
+    }
+    // caches are shared by every app on macOS
+    NSString *bundleIdentifier = NSBundle.mainBundle.bundleIdentifier ?: NSProcessInfo.processInfo.processName;
+    NSURL *directoryURL = [[cachesURL URLByAppendingPathComponent:bundleIdentifier] URLByAppendingPathComponent:@"CocoaSpiceRenderer"];
+    if (![NSFileManager.defaultManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil]) {
+        return nil;
+    }
+    // archives only hold code for the GPU they were made on
+    NSString *name = [device.name stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    return [directoryURL URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"metallib"]];
+}
+
+- (instancetype)initWithDevice:(id<MTLDevice>)device {
+    if (self = [super init]) {
+        NSError *error = nil;
+
+        _device = device;
+        _pipelines = [NSMutableDictionary dictionary];
+
+        // Load all the shader files with a .metal file extension in the project
+        _library = [device newDefaultLibraryWithBundle:[self.class shaderBundle] error:&error];
+        NSAssert(_library, @"Failed to get library from bundle: %@", error);
+
+        // Load the vertex function from the library, it is the same for every pipeline
+        _vertexFunction = [_library newFunctionWithName:@"vertexShader"];
+
+        if (@available(macOS 11, iOS 14, *)) {
+            [self loadArchive];
+        }
+    }
+    return self;
+}
+
+/// Open the archive left by an earlier launch, or start a new one
+- (void)loadArchive API_AVAILABLE(macos(11.0), ios(14.0)) {
+    NSURL *url = [self.class archiveURLForDevice:self.device];
+    if (!url) {
+        return;
+    }
+    MTLBinaryArchiveDescriptor *descriptor = [MTLBinaryArchiveDescriptor new];
+    if ([url checkResourceIsReachableAndReturnError:nil]) {
+        descriptor.url = url;
+        self.archive = [self.device newBinaryArchiveWithDescriptor:descriptor error:nil];
+    }
+    if (!self.archive) {
+        // none yet, or made by another OS or driver version
+        descriptor.url = nil;
+        self.archive = [self.device newBinaryArchiveWithDescriptor:descriptor error:nil];
+    }
+    if (self.archive) {
+        self.archiveURL = url;
+    }
+}
+
+/// Must be called while synchronized
+///
+/// Pipelines tend to be created together, so they are written out together.
+- (void)scheduleArchiveSave API_AVAILABLE(macos(11.0), ios(14.0)) {
+    if (self.archiveSaveScheduled) {
+        return;
+    }
+    self.archiveSaveScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kCSRendererPipelineArchiveDelay * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        @synchronized (self) {
+            self.archiveSaveScheduled = NO;
+            // nothing to do if it fails, the pipelines are compiled again next launch
+            [self.archive serializeToURL:self.archiveURL error:nil];
+        }
+    });
+}
+
+- (id<MTLRenderPipelineState>)pipelineWithColorFormat:(MTLPixelFormat)colorFormat
+                                          depthFormat:(MTLPixelFormat)depthFormat
+                                               filter:(CSRenderFilter)filter
+                                             hasAlpha:(BOOL)hasAlpha
+                                           isInverted:(BOOL)isInverted {
+    // small enough to be a tagged pointer, so finding a pipeline does not allocate
+    NSNumber *key = @((uint64_t)colorFormat |
+                      (uint64_t)depthFormat << 16 |
+                      (uint64_t)filter << 32 |
+                      (uint64_t)(hasAlpha ? 1 : 0) << 40 |
+                      (uint64_t)(isInverted ? 1 : 0) << 41);
+    @synchronized (self) {
+        id<MTLRenderPipelineState> pipeline = self.pipelines[key];
+        if (!pipeline) {
+            pipeline = [self newPipelineWithColorFormat:colorFormat
+                                            depthFormat:depthFormat
+                                                 filter:filter
+                                               hasAlpha:hasAlpha
+                                             isInverted:isInverted];
+            self.pipelines[key] = pipeline;
+        }
+        return pipeline;
+    }
+}
+
+/// Must be called while synchronized
+- (id<MTLRenderPipelineState>)newPipelineWithColorFormat:(MTLPixelFormat)colorFormat
+                                             depthFormat:(MTLPixelFormat)depthFormat
+                                                  filter:(CSRenderFilter)filter
+                                                hasAlpha:(BOOL)hasAlpha
+                                              isInverted:(BOOL)isInverted {
+    NSError *error = nil;
+
+    // Specialize the fragment function so it does not branch on any of these
+    MTLFunctionConstantValues *constantValues = [MTLFunctionConstantValues new];
+    bool alpha = hasAlpha;
+    bool inverted = isInverted;
+    uint32_t textureFilter = filter;
+    [constantValues setConstantValue:&alpha type:MTLDataTypeBool atIndex:CSRenderFunctionConstantIndexHasAlpha];
+    [constantValues setConstantValue:&inverted type:MTLDataTypeBool atIndex:CSRenderFunctionConstantIndexIsInverted];
+    [constantValues setConstantValue:&textureFilter type:MTLDataTypeUInt atIndex:CSRenderFunctionConstantIndexFilter];
+    id<MTLFunction> fragmentFunction = [self.library newFunctionWithName:@"samplingShader"
+                                                          constantValues:constantValues
+                                                                   error:&error];
+    NSAssert(fragmentFunction, @"Failed to specialize fragment function: %@", error);
+
+    // Set up a descriptor for creating a pipeline state object
+    MTLRenderPipelineDescriptor *pipelineStateDescriptor = [[MTLRenderPipelineDescriptor alloc] init];
+    pipelineStateDescriptor.label = [NSString stringWithFormat:@"Renderer Pipeline (filter %u%@%@)",
+                                     textureFilter, hasAlpha ? @", alpha" : @"", isInverted ? @", inverted" : @""];
+    pipelineStateDescriptor.vertexFunction = self.vertexFunction;
+    pipelineStateDescriptor.fragmentFunction = fragmentFunction;
+    pipelineStateDescriptor.colorAttachments[0].pixelFormat = colorFormat;
+    pipelineStateDescriptor.colorAttachments[0].blendingEnabled = YES;
+    pipelineStateDescriptor.colorAttachments[0].rgbBlendOperation = MTLBlendOperationAdd;
+    pipelineStateDescriptor.colorAttachments[0].alphaBlendOperation = MTLBlendOperationAdd;
+    pipelineStateDescriptor.colorAttachments[0].sourceRGBBlendFactor = MTLBlendFactorSourceAlpha;
+    pipelineStateDescriptor.colorAttachments[0].destinationRGBBlendFactor = MTLBlendFactorOneMinusSourceAlpha;
+    pipelineStateDescriptor.colorAttachments[0].sourceAlphaBlendFactor = MTLBlendFactorOne;
+    pipelineStateDescriptor.colorAttachments[0].destinationAlphaBlendFactor = MTLBlendFactorOne;
+    pipelineStateDescriptor.depthAttachmentPixelFormat = depthFormat;
+    pipelineStateDescriptor.vertexBuffers[CSRenderVertexInputIndexVertices].mutability = MTLMutabilityImmutable;
+
+    if (@available(macOS 11, iOS 14, *)) {
+        if (self.archive) {
+            // try the archive alone first, so we know whether to add to it
+            pipelineStateDescriptor.binaryArchives = @[self.archive];
+            id<MTLRenderPipelineState> pipeline = [self.device newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
+                                                                                           options:MTLPipelineOptionFailOnBinaryArchiveMiss
+                                                                                        reflection:nil
+                                                                                             error:nil];
+            if (pipeline) {
+                return pipeline;
+            }
+            if ([self.archive addRenderPipelineFunctionsWithDescriptor:pipelineStateDescriptor error:nil]) {
+                [self scheduleArchiveSave];
+            }
+        }
+    }
+
+    id<MTLRenderPipelineState> pipeline = [self.device newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
+                                                                                      error:&error];
+    NSAssert(pipeline, @"Failed to create pipeline state: %@", error);
+    return pipeline;
+}
+
+@end
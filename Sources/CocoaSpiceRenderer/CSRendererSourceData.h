@@ -0,0 +1,130 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+@import Metal;
+#import "CSRenderSource.h"
+#import "CSRenderer.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Helper class to retain fields from a renderer source
+@interface _CSRendererSourceData : NSObject<CSRenderSource>
+
+@property (nonatomic, readonly) CGPoint offset;
+@property (nonatomic, readonly) id<MTLBuffer> vertices;
+@property (nonatomic, readonly) NSUInteger numVertices;
+@property (nonatomic, readonly) id<MTLTexture> texture;
+@property (nonatomic, readonly) BOOL hasAlpha;
+@property (nonatomic, readonly) BOOL isInverted;
+@property (nonatomic, readonly) BOOL isVisible;
+@property (nonatomic, strong, readonly) _CSRendererSourceData *cursorSource;
+/// Bounds of the vertex positions, y up from the centre, or null if they cannot be read
+///
+/// Taken when the source is invalidated, so drawing never reads the vertices back.
+@property (nonatomic, readonly) CGRect vertexBounds;
+
+- (instancetype)init NS_DESIGNATED_INITIALIZER;
+- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource;
+- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset;
+- (BOOL)updateWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset;
+- (void)updateWithSourceData:(_CSRendererSourceData *)sourceData;
+
+@end
+
+/// Updates from one source waiting for the render queue
+///
+/// Kept for as long as the source is and written over by each update, so a source that
+/// changes many times a refresh costs neither an allocation nor a dispatch per change.
+@interface _CSRendererUpdate : NSObject
+
+@property (nonatomic, weak, readonly, nullable) id<CSRenderSource> renderSource;
+@property (nonatomic, readonly) _CSRendererSourceData *sourceData;
+@property (nonatomic) BOOL isPending;
+@property (nonatomic) BOOL needsRedraw;
+@property (nonatomic) BOOL needsCursorRedraw;
+@property (nonatomic) NSUInteger count;
+@property (nonatomic) uint64_t sequence;
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/// Completion blocks waiting for a frame
+///
+/// The first few are held inline, so in the usual case adding and running them
+/// allocates nothing.
+@interface _CSRendererCompletions : NSObject
+
+@property (nonatomic, readonly) NSUInteger count;
+
+- (void)addCompletion:(completionCallback_t)completion;
+- (void)moveToCompletions:(_CSRendererCompletions *)completions;
+- (void)runAll;
+
+@end
+
+/// Part of the view showing a source, and what of it has to be drawn again
+@interface _CSRendererTile : NSObject
+
+@property (nonatomic, weak, readonly, nullable) id<CSRenderSource> renderSource;
+@property (nonatomic) CGRect frame;
+@property (nonatomic) CGFloat scale;
+@property (nonatomic, nullable) _CSRendererSourceData *sourceData;
+@property (nonatomic) BOOL needsRedraw;
+@property (nonatomic) BOOL needsCursorRedraw;
+@property (nonatomic) CGRect cursorRect;
+@property (nonatomic, nullable) id<MTLTexture> mipmapTexture;
+@property (nonatomic, nullable, weak) id<MTLTexture> mipmapSourceTexture;
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithRenderSource:(nullable id<CSRenderSource>)renderSource NS_DESIGNATED_INITIALIZER;
+
+@end
+
+/// A buffer to texture copy waiting for the next frame
+///
+/// Copies can be chained with `next` and reused once encoded, the regions keep their
+/// storage so a copy of no more rectangles than before allocates nothing.
+@interface _CSRendererCopy : NSObject
+
+@property (nonatomic, nullable, readonly) id<MTLBuffer> sourceBuffer;
+@property (nonatomic, nullable, readonly) id<MTLTexture> texture;
+@property (nonatomic, readonly) NSUInteger sourceBytesPerRow;
+@property (nonatomic, readonly) NSUInteger count;
+@property (nonatomic, readonly) const MTLRegion *regions;
+@property (nonatomic, readonly) const NSUInteger *sourceOffsets;
+@property (nonatomic, nullable) _CSRendererCopy *next;
+
+- (instancetype)init NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithBuffer:(id<MTLBuffer>)sourceBuffer
+                     toTexture:(id<MTLTexture>)texture
+                       regions:(const MTLRegion *)regions
+                 sourceOffsets:(const NSUInteger *)sourceOffsets
+                         count:(NSUInteger)count
+             sourceBytesPerRow:(NSUInteger)sourceBytesPerRow;
+- (BOOL)setBuffer:(id<MTLBuffer>)sourceBuffer
+        toTexture:(id<MTLTexture>)texture
+          regions:(const MTLRegion *)regions
+    sourceOffsets:(const NSUInteger *)sourceOffsets
+            count:(NSUInteger)count
+sourceBytesPerRow:(NSUInteger)sourceBytesPerRow;
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
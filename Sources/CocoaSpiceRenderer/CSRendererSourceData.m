@@ -0,0 +1,279 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSRendererSourceData.h"
+#import "CSShaderTypes.h"
+
+/// Bounds of the positions in a vertex buffer, null if the CPU cannot read it
+static CGRect cs_vertex_bounds(id<MTLBuffer> vertices, NSUInteger numVertices) {
+    if (vertices.storageMode == MTLStorageModePrivate || vertices.length < numVertices * sizeof(CSRenderVertex)) {
+        return CGRectNull;
+    }
+    const CSRenderVertex *vertex = vertices.contents;
+    CGRect bounds = CGRectNull;
+    for (NSUInteger i = 0; i < numVertices; i++) {
+        bounds = CGRectUnion(bounds, CGRectMake(vertex[i].position.x, vertex[i].position.y, 0, 0));
+    }
+    return bounds;
+}
+
+@implementation _CSRendererSourceData
+
+- (instancetype)init {
+    if (self = [super init]) {
+        _vertexBounds = CGRectNull;
+    }
+    return self;
+}
+
+/// Retain a copy of the render source data
+/// - Parameter renderSource: Render source to read from
+- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource {
+    return [self initWithRenderSource:renderSource atOffset:CGPointZero];
+}
+
+/// Retain a copy of the render source data
+/// - Parameters:
+///   - renderSource: Render source to read from
+///   - offset: Offset to add to `viewportOrigin`, can be zero
+- (nullable instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset {
+    if (self = [self init]) {
+        if (![self updateWithRenderSource:renderSource atOffset:offset]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+/// Replace the copy with the current render source data
+///
+/// The cursor's copy is reused as well once there is one.
+/// - Parameters:
+///   - renderSource: Render source to read from
+///   - offset: Offset to add to `viewportOrigin`, can be zero
+/// - Returns: NO and leaves the copy as it was if the source has nothing to draw
+- (BOOL)updateWithRenderSource:(id<CSRenderSource>)renderSource atOffset:(CGPoint)offset {
+    id<CSRenderSource> cursorSource = renderSource.cursorSource;
+    id<MTLBuffer> vertices = renderSource.vertices;
+    id<MTLTexture> texture = renderSource.texture;
+    if (!vertices || !texture) {
+        return NO;
+    }
+    _offset = CGPointMake(renderSource.offset.x +
+                          offset.x,
+                          renderSource.offset.y +
+                          offset.y);
+    _vertices = vertices;
+    _numVertices = renderSource.numVertices;
+    _vertexBounds = cs_vertex_bounds(vertices, _numVertices);
+    _texture = texture;
+    _hasAlpha = renderSource.hasAlpha;
+    _isInverted = renderSource.isInverted;
+    _isVisible = renderSource.isVisible;
+    if (!cursorSource) {
+        _cursorSource = nil;
+    } else if (!_cursorSource) {
+        _cursorSource = [[_CSRendererSourceData alloc] initWithRenderSource:cursorSource
+                                                                   atOffset:renderSource.offset];
+    } else if (![_cursorSource updateWithRenderSource:cursorSource atOffset:renderSource.offset]) {
+        _cursorSource = nil;
+    }
+    return YES;
+}
+
+/// Replace the copy with another one, reusing the cursor's copy once there is one
+/// - Parameter sourceData: Copy to take the data from
+- (void)updateWithSourceData:(_CSRendererSourceData *)sourceData {
+    _offset = sourceData.offset;
+    _vertices = sourceData.vertices;
+    _numVertices = sourceData.numVertices;
+    _vertexBounds = sourceData.vertexBounds;
+    _texture = sourceData.texture;
+    _hasAlpha = sourceData.hasAlpha;
+    _isInverted = sourceData.isInverted;
+    _isVisible = sourceData.isVisible;
+    if (!sourceData.cursorSource) {
+        _cursorSource = nil;
+        return;
+    }
+    if (!_cursorSource) {
+        _cursorSource = [[_CSRendererSourceData alloc] init];
+    }
+    [_cursorSource updateWithSourceData:sourceData.cursorSource];
+}
+
+@end
+
+@implementation _CSRendererUpdate
+
+- (instancetype)initWithRenderSource:(id<CSRenderSource>)renderSource {
+    if (self = [super init]) {
+        _renderSource = renderSource;
+        _sourceData = [[_CSRendererSourceData alloc] init];
+    }
+    return self;
+}
+
+@end
+
+// Completions held without allocating, a few frames' worth of updates
+#define kCSRendererInlineCompletions 16
+
+@implementation _CSRendererCompletions {
+    completionCallback_t _inline[kCSRendererInlineCompletions];
+    NSUInteger _inlineCount;
+    NSMutableArray<completionCallback_t> *_overflow;
+}
+
+- (NSUInteger)count {
+    return _inlineCount + _overflow.count;
+}
+
+- (void)addCompletion:(completionCallback_t)completion {
+    if (_inlineCount < kCSRendererInlineCompletions) {
+        _inline[_inlineCount++] = completion;
+    } else {
+        if (!_overflow) {
+            _overflow = [NSMutableArray array];
+        }
+        [_overflow addObject:completion];
+    }
+}
+
+/// Append every completion to another list, leaving this one empty
+- (void)moveToCompletions:(_CSRendererCompletions *)completions {
+    for (NSUInteger i = 0; i < _inlineCount; i++) {
+        [completions addCompletion:_inline[i]];
+        _inline[i] = nil;
+    }
+    _inlineCount = 0;
+    for (completionCallback_t completion in _overflow) {
+        [completions addCompletion:completion];
+    }
+    [_overflow removeAllObjects];
+}
+
+/// Run every completion in the order they were added, leaving the list empty
+- (void)runAll {
+    for (NSUInteger i = 0; i < _inlineCount; i++) {
+        completionCallback_t completion = _inline[i];
+        _inline[i] = nil;
+        completion();
+    }
+    _inlineCount = 0;
+    for (completionCallback_t completion in _overflow) {
+        completion();
+    }
+    [_overflow removeAllObjects];
+}
+
+@end
+
+@implementation _CSRendererTile
+
+- (instancetype)initWithRenderSource:(nullable id<CSRenderSource>)renderSource {
+    if (self = [super init]) {
+        _renderSource = renderSource;
+        _scale = 1.0f;
+        _cursorRect = CGRectNull;
+    }
+    return self;
+}
+
+@end
+
+@implementation _CSRendererCopy {
+    MTLRegion *_regions;
+    NSUInteger *_sourceOffsets;
+    NSUInteger _capacity;
+}
+
+- (instancetype)init {
+    return [super init];
+}
+
+- (instancetype)initWithBuffer:(id<MTLBuffer>)sourceBuffer
+                     toTexture:(id<MTLTexture>)texture
+                       regions:(const MTLRegion *)regions
+                 sourceOffsets:(const NSUInteger *)sourceOffsets
+                         count:(NSUInteger)count
+             sourceBytesPerRow:(NSUInteger)sourceBytesPerRow {
+    if (self = [self init]) {
+        if (![self setBuffer:sourceBuffer
+                   toTexture:texture
+                     regions:regions
+               sourceOffsets:sourceOffsets
+                       count:count
+           sourceBytesPerRow:sourceBytesPerRow]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_regions);
+    free(_sourceOffsets);
+}
+
+/// Describe a new copy, growing the region storage only if it is too small
+/// - Returns: NO if the storage could not grow, the copy is then empty
+- (BOOL)setBuffer:(id<MTLBuffer>)sourceBuffer
+        toTexture:(id<MTLTexture>)texture
+          regions:(const MTLRegion *)regions
+    sourceOffsets:(const NSUInteger *)sourceOffsets
+            count:(NSUInteger)count
+sourceBytesPerRow:(NSUInteger)sourceBytesPerRow {
+    if (count > _capacity) {
+        MTLRegion *newRegions = realloc(_regions, count * sizeof(MTLRegion));
+        if (newRegions) {
+            _regions = newRegions;
+        }
+        NSUInteger *newSourceOffsets = realloc(_sourceOffsets, count * sizeof(NSUInteger));
+        if (newSourceOffsets) {
+            _sourceOffsets = newSourceOffsets;
+        }
+        if (!newRegions || !newSourceOffsets) {
+            [self reset];
+            return NO;
+        }
+        _capacity = count;
+    }
+    _sourceBuffer = sourceBuffer;
+    _texture = texture;
+    _sourceBytesPerRow = sourceBytesPerRow;
+    _count = count;
+    memcpy(_regions, regions, count * sizeof(MTLRegion));
+    memcpy(_sourceOffsets, sourceOffsets, count * sizeof(NSUInteger));
+    return YES;
+}
+
+/// Let go of the buffer and texture, keeping the storage for the next copy
+- (void)reset {
+    _sourceBuffer = nil;
+    _texture = nil;
+    _count = 0;
+}
+
+- (const MTLRegion *)regions {
+    return _regions;
+}
+
+- (const NSUInteger *)sourceOffsets {
+    return _sourceOffsets;
+}
+
+@end
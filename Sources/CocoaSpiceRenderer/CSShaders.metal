@@ -22,6 +22,12 @@ using namespace metal;
 // Include header shared between this Metal shader code and C code executing Metal API commands
 #import "include/CSShaderTypes.h"
 
+// Specialization of the fragment shader, set when the pipeline is created
+constant bool hasAlpha [[ function_constant(CSRenderFunctionConstantIndexHasAlpha) ]];
+constant bool isInverted [[ function_constant(CSRenderFunctionConstantIndexIsInverted) ]];
+constant uint textureFilter [[ function_constant(CSRenderFunctionConstantIndexFilter) ]];
+constant bool isConvolved = textureFilter != CSRenderFilterSampler;
+
 // Vertex shader outputs and per-fragment inputs. Includes clip-space position and vertex outputs
 //  interpolated by rasterizer and fed to each fragment generated by clip-space primitives.
 typedef struct
@@ -34,9 +40,6 @@ typedef struct
     //   interpolate its value with values of other vertices making up the triangle and
     //   pass that interpolated value to the fragment shader for each fragment in that triangle;
     float2 textureCoordinate;
-
-    // If no, then we fake an alpha value
-    bool hasAlpha;
 } RasterizerData;
 
 // Vertex Function
@@ -44,8 +47,7 @@ vertex RasterizerData
 vertexShader(uint vertexID [[ vertex_id ]],
              constant CSRenderVertex *vertexArray [[ buffer(CSRenderVertexInputIndexVertices) ]],
              constant vector_uint2 *viewportSizePointer  [[ buffer(CSRenderVertexInputIndexViewportSize) ]],
-             constant matrix_float4x4 &transformation [[ buffer(CSRenderVertexInputIndexTransform) ]],
-             constant bool *hasAlpha [[ buffer(CSRenderVertexInputIndexHasAlpha) ]])
+             constant matrix_float4x4 &transformation [[ buffer(CSRenderVertexInputIndexTransform) ]])
 
 {
 
@@ -83,29 +85,93 @@ vertexShader(uint vertexID [[ vertex_id ]],
     //   interpolated with the other textureCoordinate values in the vertices that make up the
     //   triangle.
     out.textureCoordinate = vertexArray[vertexID].textureCoordinate;
-    
-    // All fragments have alpha or not
-    out.hasAlpha = *hasAlpha;
 
     return out;
 }
 
+// Catmull-Rom, which keeps edges sharper than a B-spline, zero from 2 texels out
+static float bicubicWeight(float x)
+{
+    x = fabs(x);
+    if (x < 1) {
+        return (1.5 * x - 2.5) * x * x + 1;
+    } else if (x < 2) {
+        return ((-0.5 * x + 2.5) * x - 4) * x + 2;
+    } else {
+        return 0;
+    }
+}
+
+// Three lobe Lanczos, zero from 3 texels out
+static float lanczosWeight(float x)
+{
+    x = fabs(x);
+    if (x < 1e-5) {
+        return 1;
+    } else if (x < 3) {
+        float px = M_PI_F * x;
+        return 3 * sin(px) * sin(px / 3) / (px * px);
+    } else {
+        return 0;
+    }
+}
+
+// Filter the texels around a texture coordinate with a separable kernel
+//
+// `footprint` widens the kernel when minifying, by the number of texels that fall on one
+//   pixel, so every texel contributes rather than the few nearest the centre. Texels are
+//   read rather than sampled so nothing is filtered twice.
+static half4 convolve(texture2d<half> colorTexture, float2 textureCoordinate, float footprint)
+{
+    float2 size = float2(colorTexture.get_width(), colorTexture.get_height());
+    float2 position = textureCoordinate * size - 0.5;
+    float2 base = floor(position);
+    float2 fraction = position - base;
+    bool lanczos = textureFilter == CSRenderFilterLanczos;
+    int taps = int(ceil((lanczos ? 3 : 2) * footprint));
+    float4 sum = 0;
+    float total = 0;
+
+    for (int j = 1 - taps; j <= taps; j++) {
+        float y = (j - fraction.y) / footprint;
+        float weightY = lanczos ? lanczosWeight(y) : bicubicWeight(y);
+        if (weightY == 0) {
+            continue;
+        }
+        uint row = uint(clamp(base.y + j, 0.0, size.y - 1));
+        for (int i = 1 - taps; i <= taps; i++) {
+            float x = (i - fraction.x) / footprint;
+            float weight = weightY * (lanczos ? lanczosWeight(x) : bicubicWeight(x));
+            uint column = uint(clamp(base.x + i, 0.0, size.x - 1));
+            sum += weight * float4(colorTexture.read(uint2(column, row)));
+            total += weight;
+        }
+    }
+    // negative lobes overshoot around edges
+    return half4(clamp(sum / total, 0.0, 1.0));
+}
+
 // Fragment function
 fragment float4
 samplingShader(RasterizerData in [[stage_in]],
                texture2d<half> colorTexture [[ texture(CSRenderTextureIndexBaseColor) ]],
                sampler textureSampler [[ sampler(CSRenderSamplerIndexTexture) ]],
-               constant bool *isInverted [[ buffer(CSRenderFragmentBufferIndexIsInverted) ]])
+               constant float *footprint [[ buffer(CSRenderFragmentBufferIndexFootprint), function_constant(isConvolved) ]])
 {
-    // Sample the texture to obtain a color
-    half4 colorSample = colorTexture.sample(textureSampler, in.textureCoordinate);
+    half4 colorSample;
+
+    // Sample the texture to obtain a color, or filter the texels around it
+    if (isConvolved) {
+        colorSample = convolve(colorTexture, in.textureCoordinate, *footprint);
+    } else {
+        colorSample = colorTexture.sample(textureSampler, in.textureCoordinate);
+    }
 
     // fake alpha
-    if (!in.hasAlpha) {
+    if (!hasAlpha) {
         colorSample.a = 0xff;
     }
 
     // We return the color of the texture inverted when requested
-    return float4(*isInverted ? colorSample.bgra : colorSample);
+    return float4(isInverted ? colorSample.bgra : colorSample);
 }
-
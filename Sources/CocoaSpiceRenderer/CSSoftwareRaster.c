@@ -0,0 +1,211 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CSSoftwareRaster.h"
+#include <math.h>
+#include <string.h>
+
+typedef struct
+{
+    float r, g, b, a;
+} CSRasterColor;
+
+static inline float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline uint8_t to_unorm8(float v) {
+    return (uint8_t)(clampf(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+/// Fetch one texel, `x` and `y` must be in bounds
+static CSRasterColor raster_fetch(const CSRasterTexture *texture, size_t x, size_t y) {
+    const uint8_t *row = (const uint8_t *)texture->pixels + y * texture->bytesPerRow;
+    CSRasterColor c;
+
+    switch (texture->format) {
+        case CSRasterFormatBGRA8: {
+            const uint8_t *p = row + x * 4;
+            c = (CSRasterColor){ p[2] / 255.0f, p[1] / 255.0f, p[0] / 255.0f, p[3] / 255.0f };
+            break;
+        }
+        case CSRasterFormatRGBA8: {
+            const uint8_t *p = row + x * 4;
+            c = (CSRasterColor){ p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f };
+            break;
+        }
+        case CSRasterFormatXRGB1555:
+        default: {
+            const uint8_t *p = row + x * 2;
+            uint16_t v = (uint16_t)(p[0] | (p[1] << 8));
+            c = (CSRasterColor){ ((v >> 10) & 0x1f) / 31.0f, ((v >> 5) & 0x1f) / 31.0f, (v & 0x1f) / 31.0f, 1.0f };
+            break;
+        }
+    }
+    return c;
+}
+
+/// Sample at normalized coordinates with clamp to edge addressing, the Metal default
+static CSRasterColor raster_sample(const CSRasterTexture *texture, float u, float v) {
+    float fx = u * texture->width;
+    float fy = v * texture->height;
+    size_t maxX = texture->width - 1;
+    size_t maxY = texture->height - 1;
+
+    if (!texture->linear) {
+        size_t x = (size_t)clampf(floorf(fx), 0.0f, (float)maxX);
+        size_t y = (size_t)clampf(floorf(fy), 0.0f, (float)maxY);
+        return raster_fetch(texture, x, y);
+    }
+
+    fx -= 0.5f;
+    fy -= 0.5f;
+    float x0f = floorf(fx);
+    float y0f = floorf(fy);
+    float tx = fx - x0f;
+    float ty = fy - y0f;
+    size_t x0 = (size_t)clampf(x0f, 0.0f, (float)maxX);
+    size_t y0 = (size_t)clampf(y0f, 0.0f, (float)maxY);
+    size_t x1 = (size_t)clampf(x0f + 1.0f, 0.0f, (float)maxX);
+    size_t y1 = (size_t)clampf(y0f + 1.0f, 0.0f, (float)maxY);
+    CSRasterColor c00 = raster_fetch(texture, x0, y0);
+    CSRasterColor c10 = raster_fetch(texture, x1, y0);
+    CSRasterColor c01 = raster_fetch(texture, x0, y1);
+    CSRasterColor c11 = raster_fetch(texture, x1, y1);
+    float w00 = (1.0f - tx) * (1.0f - ty);
+    float w10 = tx * (1.0f - ty);
+    float w01 = (1.0f - tx) * ty;
+    float w11 = tx * ty;
+    return (CSRasterColor){
+        c00.r * w00 + c10.r * w10 + c01.r * w01 + c11.r * w11,
+        c00.g * w00 + c10.g * w10 + c01.g * w01 + c11.g * w11,
+        c00.b * w00 + c10.b * w10 + c01.b * w01 + c11.b * w11,
+        c00.a * w00 + c10.a * w10 + c01.a * w01 + c11.a * w11,
+    };
+}
+
+/// Source over blending with the factors `CSMetalRenderer` sets on its pipeline
+static void raster_blend(uint8_t *dst, CSRasterColor src) {
+    float invA = 1.0f - src.a;
+    dst[0] = to_unorm8(src.b * src.a + dst[0] / 255.0f * invA);
+    dst[1] = to_unorm8(src.g * src.a + dst[1] / 255.0f * invA);
+    dst[2] = to_unorm8(src.r * src.a + dst[2] / 255.0f * invA);
+    dst[3] = to_unorm8(src.a + dst[3] / 255.0f);
+}
+
+static inline float edge(CSRasterPoint a, CSRasterPoint b, CSRasterPoint p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+/// With clockwise winding and y down, a pixel centre exactly on a top or left edge
+/// belongs to this triangle and on any other edge to its neighbour
+static inline bool edge_is_top_left(CSRasterPoint a, CSRasterPoint b) {
+    return (a.y == b.y && b.x > a.x) || b.y < a.y;
+}
+
+static inline bool edge_covers(float w, bool topLeft) {
+    return w > 0.0f || (w == 0.0f && topLeft);
+}
+
+static void raster_triangle(const CSRasterTarget *target, const CSRasterTexture *texture,
+                            CSRasterPoint p[3], CSRasterPoint uv[3]) {
+    float area = edge(p[0], p[1], p[2]);
+
+    if (area == 0.0f) {
+        return;
+    }
+    if (area < 0.0f) {
+        CSRasterPoint tp = p[1];
+        CSRasterPoint tuv = uv[1];
+        p[1] = p[2];
+        p[2] = tp;
+        uv[1] = uv[2];
+        uv[2] = tuv;
+        area = -area;
+    }
+
+    bool topLeft0 = edge_is_top_left(p[1], p[2]);
+    bool topLeft1 = edge_is_top_left(p[2], p[0]);
+    bool topLeft2 = edge_is_top_left(p[0], p[1]);
+    float minX = fminf(p[0].x, fminf(p[1].x, p[2].x));
+    float maxX = fmaxf(p[0].x, fmaxf(p[1].x, p[2].x));
+    float minY = fminf(p[0].y, fminf(p[1].y, p[2].y));
+    float maxY = fmaxf(p[0].y, fmaxf(p[1].y, p[2].y));
+    long x0 = (long)clampf(floorf(minX), 0.0f, (float)target->width);
+    long x1 = (long)clampf(ceilf(maxX), 0.0f, (float)target->width);
+    long y0 = (long)clampf(floorf(minY), 0.0f, (float)target->height);
+    long y1 = (long)clampf(ceilf(maxY), 0.0f, (float)target->height);
+
+    for (long y = y0; y < y1; y++) {
+        uint8_t *row = target->pixels + y * target->bytesPerRow;
+        for (long x = x0; x < x1; x++) {
+            CSRasterPoint c = { x + 0.5f, y + 0.5f };
+            float w0 = edge(p[1], p[2], c);
+            float w1 = edge(p[2], p[0], c);
+            float w2 = edge(p[0], p[1], c);
+            if (!edge_covers(w0, topLeft0) || !edge_covers(w1, topLeft1) || !edge_covers(w2, topLeft2)) {
+                continue;
+            }
+            float u = (w0 * uv[0].x + w1 * uv[1].x + w2 * uv[2].x) / area;
+            float v = (w0 * uv[0].y + w1 * uv[1].y + w2 * uv[2].y) / area;
+            CSRasterColor color = raster_sample(texture, u, v);
+            if (!texture->hasAlpha) {
+                color.a = 1.0f;
+            }
+            if (texture->isInverted) {
+                float r = color.r;
+                color.r = color.b;
+                color.b = r;
+            }
+            raster_blend(row + x * 4, color);
+        }
+    }
+}
+
+void cs_raster_clear(const CSRasterTarget *target, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    const uint8_t pixel[4] = { b, g, r, a };
+
+    for (size_t y = 0; y < target->height; y++) {
+        uint8_t *row = target->pixels + y * target->bytesPerRow;
+        for (size_t x = 0; x < target->width; x++) {
+            memcpy(row + x * 4, pixel, sizeof(pixel));
+        }
+    }
+}
+
+void cs_raster_draw(const CSRasterTarget *target,
+                    const CSRasterTexture *texture,
+                    const CSRasterVertex *vertices,
+                    size_t numVertices,
+                    float scale,
+                    CSRasterPoint origin) {
+    if (texture->width == 0 || texture->height == 0) {
+        return;
+    }
+    for (size_t i = 0; i + 2 < numVertices; i += 3) {
+        CSRasterPoint p[3];
+        CSRasterPoint uv[3];
+        for (size_t k = 0; k < 3; k++) {
+            const CSRasterVertex *vertex = &vertices[i + k];
+            // `matrix_scale_translate` followed by the vertex shader's conversion to
+            // clip space, then the viewport transform back to pixels with y down
+            p[k].x = vertex->position.x * scale + origin.x + target->width / 2.0f;
+            p[k].y = target->height / 2.0f - (vertex->position.y * scale - origin.y);
+            uv[k] = vertex->textureCoordinate;
+        }
+        raster_triangle(target, texture, p, uv);
+    }
+}
@@ -0,0 +1,425 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import "CSSoftwareRenderer.h"
+#import "CSRenderSource.h"
+#import "CSRenderer.h"
+#import "CSRendererSourceData.h"
+#import "CSShaderTypes.h"
+#import "CSSoftwareRaster.h"
+#import <stddef.h>
+
+// render sources' vertex buffers are handed to the rasterizer as is
+_Static_assert(sizeof(CSRasterVertex) == sizeof(CSRenderVertex), "vertex size mismatch");
+_Static_assert(offsetof(CSRasterVertex, position) == offsetof(CSRenderVertex, position), "vertex layout mismatch");
+_Static_assert(offsetof(CSRasterVertex, textureCoordinate) == offsetof(CSRenderVertex, textureCoordinate), "vertex layout mismatch");
+
+/// Map a texture format to one the rasterizer reads, returns NO if there is none
+static BOOL cs_raster_format(MTLPixelFormat pixelFormat, CSRasterFormat *format, NSUInteger *pixelSize) {
+    switch (pixelFormat) {
+        case MTLPixelFormatBGRA8Unorm:
+        case MTLPixelFormatBGRA8Unorm_sRGB:
+            *format = CSRasterFormatBGRA8;
+            *pixelSize = 4;
+            return YES;
+        case MTLPixelFormatRGBA8Unorm:
+        case MTLPixelFormatRGBA8Unorm_sRGB:
+            *format = CSRasterFormatRGBA8;
+            *pixelSize = 4;
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+/// Where a texture is read back to, kept from frame to frame
+@interface _CSSoftwareReadback : NSObject
+
+/// Shared buffer the GPU copies private textures into
+@property (nonatomic, nullable) id<MTLBuffer> buffer;
+/// Memory other textures are copied into
+@property (nonatomic, nullable) NSMutableData *data;
+
+@end
+
+@implementation _CSSoftwareReadback
+@end
+
+@interface CSSoftwareRenderer ()
+
+// These must only be accessed on `renderQueue`
+@property (nonatomic, nullable) _CSRendererSourceData *renderSourceData;
+@property (nonatomic) CGSize renderViewportSize;
+@property (nonatomic) CGPoint renderViewportOrigin;
+@property (nonatomic) CGFloat renderViewportScale;
+@property (nonatomic) BOOL renderDrawScheduled;
+@property (nonatomic, nullable) NSMutableData *renderFramebuffer;
+@property (nonatomic) CGSize renderFramebufferSize;
+@property (nonatomic, readonly) NSMutableArray<completionCallback_t> *renderCompletions;
+@property (nonatomic, readonly) NSMutableArray<_CSRendererCopy *> *renderPendingCopies;
+@property (nonatomic, readonly) _CSSoftwareReadback *renderSourceReadback;
+@property (nonatomic, readonly) _CSSoftwareReadback *renderCursorReadback;
+
+@property (nonatomic, readonly) dispatch_queue_t renderQueue;
+@property (atomic, readwrite) uint64_t frameCount;
+
+@end
+
+@implementation CSSoftwareRenderer {
+    id<MTLDevice> _device;
+    id<MTLCommandQueue> _commandQueue;
+    CGSize _viewportSize;
+}
+
+@synthesize device = _device;
+@synthesize commandQueue = _commandQueue;
+@synthesize viewportOrigin = _viewportOrigin;
+@synthesize viewportScale = _viewportScale;
+
+- (instancetype)initWithDevice:(id<MTLDevice>)device viewportSize:(CGSize)viewportSize {
+    if (self = [super init]) {
+        _device = device;
+        // only used to read back private textures and for copies into them, it is
+        // where `CSDisplay` submits its scanout copies so those stay ordered with us
+        _commandQueue = [device newCommandQueue];
+        _renderQueue = dispatch_queue_create("CSSoftwareRenderer", DISPATCH_QUEUE_SERIAL);
+        _renderCompletions = [NSMutableArray array];
+        _renderPendingCopies = [NSMutableArray array];
+        _renderSourceReadback = [[_CSSoftwareReadback alloc] init];
+        _renderCursorReadback = [[_CSSoftwareReadback alloc] init];
+        _viewportSize = viewportSize;
+        _renderViewportSize = viewportSize;
+        _viewportScale = 1.0f;
+        _renderViewportScale = 1.0f;
+        _linearFiltering = YES;
+    }
+    return self;
+}
+
+#pragma mark - Properties
+
+- (CGSize)viewportSize {
+    @synchronized (self) {
+        return _viewportSize;
+    }
+}
+
+- (void)setViewportSize:(CGSize)viewportSize {
+    @synchronized (self) {
+        _viewportSize = viewportSize;
+    }
+    dispatch_async(self.renderQueue, ^{
+        self.renderViewportSize = viewportSize;
+        [self _setNeedsDraw];
+    });
+}
+
+- (void)setViewportOrigin:(CGPoint)viewportOrigin {
+    if (!CGPointEqualToPoint(_viewportOrigin, viewportOrigin)) {
+        _viewportOrigin = viewportOrigin;
+        dispatch_async(self.renderQueue, ^{
+            self.renderViewportOrigin = viewportOrigin;
+            [self _setNeedsDraw];
+        });
+    }
+}
+
+- (void)setViewportScale:(CGFloat)viewportScale {
+    if (_viewportScale != viewportScale) {
+        _viewportScale = viewportScale;
+        dispatch_async(self.renderQueue, ^{
+            self.renderViewportScale = viewportScale;
+            [self _setNeedsDraw];
+        });
+    }
+}
+
+#pragma mark - Drawing
+
+/// Must be called on render queue
+///
+/// Anything queued before the draw runs is picked up by it, so a burst of updates
+/// costs one frame.
+- (void)_setNeedsDraw {
+    if (self.renderDrawScheduled) {
+        return;
+    }
+    self.renderDrawScheduled = YES;
+    dispatch_async(self.renderQueue, ^{
+        self.renderDrawScheduled = NO;
+        [self _drawFrame];
+    });
+}
+
+/// Must be called on render queue
+- (void)_applyPendingCopies {
+    id<MTLCommandBuffer> commandBuffer = nil;
+    id<MTLBlitCommandEncoder> blitEncoder = nil;
+
+    for (_CSRendererCopy *copy in self.renderPendingCopies) {
+        for (NSUInteger i = 0; i < copy.count; i++) {
+            if (copy.texture.storageMode != MTLStorageModePrivate) {
+                [copy.texture replaceRegion:copy.regions[i]
+                                mipmapLevel:0
+                                  withBytes:(const uint8_t *)copy.sourceBuffer.contents + copy.sourceOffsets[i]
+                                bytesPerRow:copy.sourceBytesPerRow];
+                continue;
+            }
+            if (!blitEncoder) {
+                commandBuffer = [self.commandQueue commandBuffer];
+                commandBuffer.label = @"Software Renderer Copies";
+                blitEncoder = [commandBuffer blitCommandEncoder];
+            }
+            [blitEncoder copyFromBuffer:copy.sourceBuffer
+                           sourceOffset:copy.sourceOffsets[i]
+                      sourceBytesPerRow:copy.sourceBytesPerRow
+                    sourceBytesPerImage:0
+                             sourceSize:copy.regions[i].size
+                              toTexture:copy.texture
+                       destinationSlice:0
+                       destinationLevel:0
+                      destinationOrigin:copy.regions[i].origin];
+        }
+    }
+    [blitEncoder endEncoding];
+    // readbacks are submitted to the same queue after this, so no need to wait
+    [commandBuffer commit];
+    [self.renderPendingCopies removeAllObjects];
+}
+
+/// Must be called on render queue
+///
+/// Returns the pixels of `texture` row by row with `bytesPerRow` stride, or NULL if the
+/// rasterizer cannot read its format. They stay valid until `readback` is used again,
+/// which only allocates when the size of the texture changes.
+- (nullable const void *)_readTexture:(id<MTLTexture>)texture readback:(_CSSoftwareReadback *)readback format:(CSRasterFormat *)format bytesPerRow:(NSUInteger *)bytesPerRow {
+    NSUInteger pixelSize;
+    if (!cs_raster_format(texture.pixelFormat, format, &pixelSize)) {
+        return NULL;
+    }
+    *bytesPerRow = texture.width * pixelSize;
+    NSUInteger length = *bytesPerRow * texture.height;
+    if (texture.storageMode == MTLStorageModePrivate) {
+        // a GL scanout shadow, only the GPU can read it
+        if (readback.buffer.length != length) {
+            readback.buffer = [self.device newBufferWithLength:length options:MTLResourceStorageModeShared];
+            readback.data = nil;
+        }
+        id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
+        commandBuffer.label = @"Software Renderer Readback";
+        id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+        [blitEncoder copyFromTexture:texture
+                         sourceSlice:0
+                         sourceLevel:0
+                        sourceOrigin:MTLOriginMake(0, 0, 0)
+                          sourceSize:MTLSizeMake(texture.width, texture.height, 1)
+                            toBuffer:readback.buffer
+                   destinationOffset:0
+              destinationBytesPerRow:*bytesPerRow
+            destinationBytesPerImage:length];
+        [blitEncoder endEncoding];
+        [commandBuffer commit];
+        [commandBuffer waitUntilCompleted];
+        if (commandBuffer.error) {
+            return NULL;
+        }
+        return readback.buffer.contents;
+    } else {
+        if (readback.data.length != length) {
+            readback.data = [NSMutableData dataWithLength:length];
+            readback.buffer = nil;
+        }
+        [texture getBytes:readback.data.mutableBytes
+              bytesPerRow:*bytesPerRow
+               fromRegion:MTLRegionMake2D(0, 0, texture.width, texture.height)
+              mipmapLevel:0];
+        return readback.data.bytes;
+    }
+}
+
+/// Must be called on render queue
+- (void)_drawSource:(id<CSRenderSource>)source
+             target:(const CSRasterTarget *)target
+           readback:(_CSSoftwareReadback *)readback
+       drawAtOrigin:(CGPoint)origin
+              scale:(CGFloat)scale {
+    id<MTLTexture> texture = source.texture;
+    id<MTLBuffer> vertices = source.vertices;
+    CSRasterTexture rasterTexture = {0};
+    NSUInteger bytesPerRow;
+
+    if (vertices.storageMode == MTLStorageModePrivate ||
+        vertices.length < source.numVertices * sizeof(CSRenderVertex)) {
+        return;
+    }
+    const void *pixels = [self _readTexture:texture readback:readback format:&rasterTexture.format bytesPerRow:&bytesPerRow];
+    if (!pixels) {
+        return;
+    }
+    rasterTexture.pixels = pixels;
+    rasterTexture.width = texture.width;
+    rasterTexture.height = texture.height;
+    rasterTexture.bytesPerRow = bytesPerRow;
+    rasterTexture.hasAlpha = source.hasAlpha;
+    rasterTexture.isInverted = source.isInverted;
+    rasterTexture.linear = self.linearFiltering;
+    cs_raster_draw(target,
+                   &rasterTexture,
+                   vertices.contents,
+                   source.numVertices,
+                   scale,
+                   (CSRasterPoint){ origin.x, origin.y });
+}
+
+/// Must be called on render queue
+- (void)_drawFrame {
+    CGSize size = self.renderViewportSize;
+    NSUInteger width = size.width;
+    NSUInteger height = size.height;
+
+    [self _applyPendingCopies];
+
+    if (!CGSizeEqualToSize(self.renderFramebufferSize, size)) {
+        self.renderFramebuffer = width && height ? [NSMutableData dataWithLength:width * height * 4] : nil;
+        self.renderFramebufferSize = size;
+    }
+
+    if (self.renderFramebuffer) {
+        CSRasterTarget target = {
+            .pixels = self.renderFramebuffer.mutableBytes,
+            .width = width,
+            .height = height,
+            .bytesPerRow = width * 4,
+        };
+        // the clear colour of a MTKView
+        cs_raster_clear(&target, 0, 0, 0, 0xff);
+
+        _CSRendererSourceData *source = self.renderSourceData;
+        if (source.isVisible) {
+            CGPoint viewportOrigin = self.renderViewportOrigin;
+            CGFloat viewportScale = self.renderViewportScale;
+            CGPoint origin = CGPointMake(viewportOrigin.x + source.offset.x * viewportScale,
+                                         viewportOrigin.y + source.offset.y * viewportScale);
+            [self _drawSource:source target:&target readback:self.renderSourceReadback drawAtOrigin:origin scale:viewportScale];
+            if (source.cursorSource.isVisible) {
+                CGPoint cursorOrigin = CGPointMake(viewportOrigin.x + (source.offset.x + source.cursorSource.offset.x) * viewportScale,
+                                                   viewportOrigin.y + (source.offset.y + source.cursorSource.offset.y) * viewportScale);
+                [self _drawSource:source.cursorSource target:&target readback:self.renderCursorReadback drawAtOrigin:cursorOrigin scale:viewportScale];
+            }
+        }
+        self.frameCount++;
+    }
+
+    // callers may well come back for the image, which needs this queue
+    for (completionCallback_t completion in self.renderCompletions) {
+        dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), completion);
+    }
+    [self.renderCompletions removeAllObjects];
+}
+
+- (CGImageRef)copyImage {
+    __block NSData *pixels = nil;
+    __block CGSize size = CGSizeZero;
+
+    dispatch_sync(self.renderQueue, ^{
+        pixels = [self.renderFramebuffer copy];
+        size = self.renderFramebufferSize;
+    });
+    if (!pixels) {
+        return NULL;
+    }
+
+    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+    CGDataProviderRef dataProviderRef = CGDataProviderCreateWithCFData((__bridge CFDataRef)pixels);
+    CGImageRef img = CGImageCreate(size.width,
+                                   size.height,
+                                   8,
+                                   32,
+                                   size.width * 4,
+                                   colorSpaceRef,
+                                   kCGBitmapByteOrder32Little | kCGImageAlphaNoneSkipFirst,
+                                   dataProviderRef,
+                                   NULL,
+                                   NO,
+                                   kCGRenderingIntentDefault);
+    CGDataProviderRelease(dataProviderRef);
+    CGColorSpaceRelease(colorSpaceRef);
+    return img;
+}
+
+#pragma mark - CSRenderer
+
+- (void)renderSouce:(id<CSRenderSource>)renderSource
+         copyBuffer:(id<MTLBuffer>)sourceBuffer
+            regions:(const MTLRegion *)regions
+      sourceOffsets:(const NSUInteger *)sourceOffsets
+              count:(NSUInteger)count
+  sourceBytesPerRow:(NSUInteger)sourceBytesPerRow
+         completion:(nullable completionCallback_t)completion {
+
+    _CSRendererSourceData *sourceData = [[_CSRendererSourceData alloc] initWithRenderSource:renderSource];
+
+    if (!sourceData) {
+        if (completion) {
+            completion();
+        }
+        return;
+    }
+
+    _CSRendererCopy *copy = [[_CSRendererCopy alloc] initWithBuffer:sourceBuffer
+                                                          toTexture:sourceData.texture
+                                                            regions:regions
+                                                      sourceOffsets:sourceOffsets
+                                                              count:count
+                                                  sourceBytesPerRow:sourceBytesPerRow];
+
+    dispatch_async(self.renderQueue, ^{
+        [self.renderPendingCopies addObject:copy];
+        if (completion) {
+            [self.renderCompletions addObject:completion];
+        }
+        self.renderSourceData = sourceData;
+        [self _setNeedsDraw];
+    });
+}
+
+- (void)invalidateRenderSource:(id<CSRenderSource>)renderSource
+                withCompletion:(nullable completionCallback_t)completion {
+    _CSRendererSourceData *sourceData = [[_CSRendererSourceData alloc] initWithRenderSource:renderSource];
+    if (!sourceData || !sourceData.isVisible) {
+        if (completion) {
+            completion();
+        }
+        return;
+    }
+
+    dispatch_async(self.renderQueue, ^{
+        if (completion) {
+            [self.renderCompletions addObject:completion];
+        }
+        self.renderSourceData = sourceData;
+        [self _setNeedsDraw];
+    });
+}
+
+- (void)disableRender {
+    dispatch_async(self.renderQueue, ^{
+        self.renderSourceData = nil;
+        [self _setNeedsDraw];
+    });
+}
+
+@end
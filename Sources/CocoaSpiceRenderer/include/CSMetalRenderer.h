@@ -22,18 +22,123 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/// How a source is filtered when it is drawn larger or smaller than its size
+typedef NS_ENUM(NSInteger, CSMetalRendererKernel) {
+    /// The sampler filter set with `changeUpscaler:downscaler:`
+    kCSMetalRendererKernelSampler,
+    /// Every pixel of the source drawn as a square of whole pixels, the scale is rounded down to an integer when upscaling
+    kCSMetalRendererKernelPixelPerfect,
+    /// Catmull-Rom bicubic, widened to cover every texel when downscaling
+    kCSMetalRendererKernelBicubic,
+    /// Three lobe Lanczos, the sharpest and most expensive, widened to cover every texel when downscaling
+    kCSMetalRendererKernelLanczos,
+    /// Trilinear filtering of a mipmapped copy of the source, a cheap way to downscale without aliasing
+    kCSMetalRendererKernelMipmap,
+};
+
 /// Simple platform independent renderer for CocoaSpice
 @interface CSMetalRenderer : NSObject<MTKViewDelegate, CSRenderer>
 
+/// Number of command buffers that carried buffer to texture copies
+///
+/// All copies received within one display refresh share a single command buffer.
+@property (atomic, readonly) uint64_t copyCommitCount;
+
+/// Number of rectangles copied, divide by `copyCommitCount` for rectangles per commit
+@property (atomic, readonly) uint64_t copyRectCount;
+
+/// Pause the view while there is nothing to draw, defaults to NO
+///
+/// After a short run of refreshes with no update the view is paused, so an idle guest
+/// costs no wakeups or power at all. The next update resumes it in time for the refresh
+/// after it. The view must not be set to `enableSetNeedsDisplay`.
+@property (atomic) BOOL adaptiveFrameRate;
+
+/// Number of frames presented
+@property (atomic, readonly) uint64_t presentedFrameCount;
+
+/// Number of updates that never reached the screen on their own because a later one
+/// arrived within the same refresh and was drawn in their place
+@property (atomic, readonly) uint64_t coalescedFrameCount;
+
+/// Number of presented frames the GPU finished after the refresh they were meant for
+///
+/// Only counted where command buffer GPU timestamps are available (iOS 10.3, macOS 10.15).
+@property (atomic, readonly) uint64_t missedDeadlineCount;
+
+/// GPU time in seconds of the most recently presented frame
+@property (atomic, readonly) CFTimeInterval lastGPUTime;
+
+/// Moving average of the GPU time in seconds of presented frames
+@property (atomic, readonly) CFTimeInterval averageGPUTime;
+
+/// Number of presented frames that redrew a whole source
+@property (atomic, readonly) uint64_t fullFrameCount;
+
+/// Number of presented frames that only redrew cursors
+///
+/// The last frame is kept, so a cursor that moved or changed over an unchanged display
+/// only redraws the rectangles it left and entered.
+@property (atomic, readonly) uint64_t partialFrameCount;
+
+/// Number of times a whole source was redrawn, be it the view or a tile of the mosaic
+@property (atomic, readonly) uint64_t redrawnTileCount;
+
+/// Frames are drawn from a render thread of the renderer's own rather than the main thread
+@property (nonatomic, readonly) BOOL usesRenderThread;
+
 /// Create a new renderer for a MTKView
 /// @param mtkView The MetalKit View
 - (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView;
 
+/// Create a new renderer for a MTKView, optionally drawing from a render thread
+///
+/// With a render thread, updates, presentation and completions all happen on a high priority
+/// queue paced by the display (CVDisplayLink on macOS, CADisplayLink on a thread of its own
+/// elsewhere), so a busy main thread holds up neither frames nor the acknowledgements sources
+/// wait for. The main thread is then only used for the view's geometry: the view is paused
+/// and its layer is drawn to directly, at the display's refresh rate, with no depth attachment.
+/// Nothing else must draw to the view, and its pixel format must not change afterwards.
+/// Must be called from the main thread.
+/// @param mtkView The MetalKit View, which must have this renderer as its delegate
+/// @param usesRenderThread YES to draw from a render thread, NO to draw from `drawInMTKView:` on the main thread
+- (nonnull instancetype)initWithMetalKitView:(nonnull MTKView *)mtkView usesRenderThread:(BOOL)usesRenderThread;
+
 /// Modify upscaler and downscaler settings
 /// @param upscaler Upscaler to use
 /// @param downscaler Downscaler to use
 - (void)changeUpscaler:(MTLSamplerMinMagFilter)upscaler downscaler:(MTLSamplerMinMagFilter)downscaler;
 
+/// Filter sources with a kernel rather than just the sampler
+///
+/// Both default to `kCSMetalRendererKernelSampler`. The filtered source is kept in the frame
+/// from one refresh to the next, so the more expensive kernels only run again where the
+/// source changed, the cursor moved, or after the viewport did. The cursor is always drawn
+/// with the sampler. Mipmaps only apply to downscaling, and are only rebuilt for an update.
+/// @param upscaling Kernel for sources drawn larger than their size
+/// @param downscaling Kernel for sources drawn smaller than their size
+- (void)changeUpscalingKernel:(CSMetalRendererKernel)upscaling downscalingKernel:(CSMetalRendererKernel)downscaling;
+
+/// Place a source in the mosaic, or move one already in it
+///
+/// While the mosaic holds any source, the renderer composites all of them into the view in
+/// a single render pass instead of drawing the one source it was last sent. Every source is
+/// centred in its own tile and clipped to it, and an update to a source only redraws its
+/// tile: the rest of the frame is kept from the one before. Tiles are drawn over black, in
+/// the order they were added. `viewportOrigin` and `viewportScale` do not apply to the mosaic.
+///
+/// The source must also send its updates here, for a display by adding this renderer to it.
+/// @param renderSource Source to draw
+/// @param frame Tile in drawable pixels, with the origin at the top left
+/// @param scale Scale factor of the source in its tile
+- (void)addRenderSource:(id<CSRenderSource>)renderSource frame:(CGRect)frame scale:(CGFloat)scale;
+
+/// Take a source out of the mosaic
+///
+/// Once the last one is removed the renderer goes back to drawing a single source.
+/// @param renderSource Source to remove
+- (void)removeRenderSource:(id<CSRenderSource>)renderSource;
+
 @end
 
 NS_ASSUME_NONNULL_END
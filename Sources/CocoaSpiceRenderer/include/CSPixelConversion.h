@@ -0,0 +1,63 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef CSPixelConversion_h
+#define CSPixelConversion_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Convert a rectangle of SPICE 16-bit 555 pixels to opaque BGRA8
+//
+// Source pixels are little endian with blue in the low bits and the top bit unused, the
+//   same as `SPICE_SURFACE_FMT_16_555`. Each 5-bit component is widened to the nearest
+//   8-bit value, as sampling it on the GPU would. Uses NEON or SSE2 when the target has them.
+void cs_convert_xrgb1555_to_bgra8(uint8_t *dst,
+                                  size_t dstBytesPerRow,
+                                  const void *src,
+                                  size_t srcBytesPerRow,
+                                  size_t width,
+                                  size_t height);
+
+// Pixel layouts `cs_downscale_to_bgra8` reads
+typedef enum {
+    kCSDownscaleSourceBGRX8,
+    kCSDownscaleSourceRGBX8,
+    kCSDownscaleSourceXRGB1555,
+} CSDownscaleSource;
+
+// Redraw the part of a downscaled BGRA8 image that a rectangle of the source covers
+//
+// `dst` is the whole `src` scaled to `dstWidth` x `dstHeight`, and only its pixels whose
+//   footprint overlaps the source rectangle at (`x`, `y`) of `width` x `height` are written,
+//   so damage to the source updates the image without touching the rest. Each one averages
+//   four samples spread over its footprint rather than every source pixel in it: the cost
+//   follows the size of the image, not of the source. Alpha is always opaque.
+void cs_downscale_to_bgra8(uint8_t *dst,
+                           size_t dstBytesPerRow,
+                           size_t dstWidth,
+                           size_t dstHeight,
+                           const void *src,
+                           size_t srcBytesPerRow,
+                           size_t srcWidth,
+                           size_t srcHeight,
+                           CSDownscaleSource format,
+                           size_t x,
+                           size_t y,
+                           size_t width,
+                           size_t height);
+
+#endif /* CSPixelConversion_h */
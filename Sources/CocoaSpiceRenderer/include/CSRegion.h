@@ -0,0 +1,74 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef CSRegion_h
+#define CSRegion_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Most rectangles a region holds before the cheapest pair is merged to make room
+#define CS_REGION_MAX_RECTS 16
+
+typedef struct
+{
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} CSRegionRect;
+
+// A bounded set of disjoint rectangles that accumulates damage between uploads.
+//
+// Every rectangle added is first split against what is already pending, so no pixel is
+//   held (or uploaded) twice. A newcomer is folded into a neighbour when their bounding box
+//   is almost all damage anyway, and once there are more than `CS_REGION_MAX_RECTS` the
+//   pair whose bounding box wastes the least is merged. The region therefore only ever
+//   over-approximates the damage, and by how much is tracked in the two counters.
+typedef struct
+{
+    // One spare slot holds a newcomer until the region is brought back within bounds
+    CSRegionRect rects[CS_REGION_MAX_RECTS + 1];
+    size_t count;
+
+    // Pixels damaged over the region's lifetime that were not already pending upload
+    uint64_t damagedPixels;
+
+    // Pixels handed out by `cs_region_flush` over the region's lifetime
+    uint64_t uploadedPixels;
+} CSRegion;
+
+void cs_region_init(CSRegion *region);
+
+// Drop all pending rectangles without counting them as uploaded
+void cs_region_clear(CSRegion *region);
+
+bool cs_region_is_empty(const CSRegion *region);
+
+// Number of pixels covered by the pending rectangles
+uint64_t cs_region_area(const CSRegion *region);
+
+// Bounding box of the pending rectangles, empty when there are none
+CSRegionRect cs_region_extents(const CSRegion *region);
+
+// Add damage to the region, empty rectangles are ignored
+void cs_region_add(CSRegion *region, CSRegionRect rect);
+
+// Move every pending rectangle into `rects` and empty the region. Returns the number copied.
+size_t cs_region_flush(CSRegion *region, CSRegionRect rects[CS_REGION_MAX_RECTS]);
+
+#endif /* CSRegion_h */
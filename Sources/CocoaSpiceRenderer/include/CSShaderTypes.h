@@ -26,7 +26,6 @@ typedef enum CSRenderVertexInputIndex
     CSRenderVertexInputIndexVertices     = 0,
     CSRenderVertexInputIndexViewportSize = 1,
     CSRenderVertexInputIndexTransform    = 2,
-    CSRenderVertexInputIndexHasAlpha     = 3,
 } CSRenderVertexInputIndex;
 
 // Texture index values shared between shader and C code to ensure Metal shader buffer inputs match
@@ -43,9 +42,30 @@ typedef enum CSRenderSamplerIndex
 
 typedef enum CSRenderFragmentBufferIndex
 {
-    CSRenderFragmentBufferIndexIsInverted = 0,
+    CSRenderFragmentBufferIndexFootprint = 0,
 } CSRenderFragmentBufferIndex;
 
+// Function constant index values shared between shader and C code, every combination of
+//   them is a pipeline of its own so fragments do not branch on them
+typedef enum CSRenderFunctionConstantIndex
+{
+    CSRenderFunctionConstantIndexHasAlpha   = 0,
+    CSRenderFunctionConstantIndexIsInverted = 1,
+    CSRenderFunctionConstantIndexFilter     = 2,
+} CSRenderFunctionConstantIndex;
+
+// How the fragment shader reads the texture
+typedef enum CSRenderFilter
+{
+    // With the bound sampler
+    CSRenderFilterSampler = 0,
+    // Catmull-Rom bicubic over the texels, scaled by the footprint buffer
+    CSRenderFilterBicubic = 1,
+    // Three lobe Lanczos over the texels, scaled by the footprint buffer
+    CSRenderFilterLanczos = 2,
+    CSRenderFilterCount
+} CSRenderFilter;
+
 //  This structure defines the layout of each vertex in the array of vertices set as an input to our
 //    Metal vertex shader.  Since this header is shared between our .metal shader and C code,
 //    we can be sure that the layout of the vertex array in the code matches the layout that
@@ -0,0 +1,89 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef CSSoftwareRaster_h
+#define CSSoftwareRaster_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Texel layouts the rasterizer can sample from
+typedef enum CSRasterFormat
+{
+    // Bytes in memory are B, G, R, A (`MTLPixelFormatBGRA8Unorm`, SPICE 32-bit xRGB)
+    CSRasterFormatBGRA8 = 0,
+    // Bytes in memory are R, G, B, A (`MTLPixelFormatRGBA8Unorm`)
+    CSRasterFormatRGBA8 = 1,
+    // Little endian 16-bit with blue in the low bits, top bit unused (SPICE 16-bit 555)
+    CSRasterFormatXRGB1555 = 2,
+} CSRasterFormat;
+
+// A position or offset in pixels, or a texture coordinate
+typedef struct
+{
+    float x;
+    float y;
+} CSRasterPoint;
+
+// A vertex laid out like `CSRenderVertex`, so a render source's vertex buffer can be drawn as is
+typedef struct
+{
+    CSRasterPoint position;
+    CSRasterPoint textureCoordinate;
+} CSRasterVertex;
+
+// A BGRA8 framebuffer to draw into, the first row is the top of the viewport
+typedef struct
+{
+    uint8_t *pixels;
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+} CSRasterTarget;
+
+// Pixels of a texture to draw, with the same options the Metal shaders take
+typedef struct
+{
+    const void *pixels;
+    size_t width;
+    size_t height;
+    size_t bytesPerRow;
+    CSRasterFormat format;
+    // If false, alpha is treated as opaque
+    bool hasAlpha;
+    // If true, red and blue are swapped
+    bool isInverted;
+    // Bilinear rather than nearest filtering
+    bool linear;
+} CSRasterTexture;
+
+// Fill the framebuffer with one colour, components are 0 to 255
+void cs_raster_clear(const CSRasterTarget *target, uint8_t r, uint8_t g, uint8_t b, uint8_t a);
+
+// Draw a triangle list the way `vertexShader` and `samplingShader` would.
+//
+// Vertex positions are in pixels from the centre of the viewport with y up, they are
+//   scaled by `scale` and then moved by `origin` (with y down), and texels are blended
+//   over the framebuffer by their alpha. Edges shared by two triangles are filled once.
+void cs_raster_draw(const CSRasterTarget *target,
+                    const CSRasterTexture *texture,
+                    const CSRasterVertex *vertices,
+                    size_t numVertices,
+                    float scale,
+                    CSRasterPoint origin);
+
+#endif /* CSSoftwareRaster_h */
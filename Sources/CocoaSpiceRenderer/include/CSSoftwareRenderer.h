@@ -0,0 +1,60 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+@import Metal;
+@import CoreGraphics;
+
+@protocol CSRenderer;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Renderer that composites into memory on the CPU instead of presenting to a view
+///
+/// Useful where there is no window to draw into, such as taking screenshots of many virtual
+/// machines at once or measuring the display pipeline in automated tests. Frames are drawn with
+/// the same vertex, offset and scale semantics as `CSMetalRenderer`, cursor included, on a
+/// private serial queue as soon as the source changes; updates that arrive while a frame is
+/// being drawn are merged into the next one.
+///
+/// A Metal device is still needed because the display textures live on it, but nothing is
+/// rendered by the GPU: textures are read back and rasterized in software.
+@interface CSSoftwareRenderer : NSObject<CSRenderer>
+
+/// Size of the framebuffer in pixels, changing it redraws the frame
+@property (atomic) CGSize viewportSize;
+
+/// Sample with bilinear rather than nearest filtering when the display is scaled, defaults to YES
+@property (atomic) BOOL linearFiltering;
+
+/// Number of frames drawn so far
+@property (atomic, readonly) uint64_t frameCount;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Create a new renderer
+/// @param device Device the render sources create their textures on
+/// @param viewportSize Size of the framebuffer in pixels
+- (instancetype)initWithDevice:(id<MTLDevice>)device viewportSize:(CGSize)viewportSize NS_DESIGNATED_INITIALIZER;
+
+/// Copy the most recently drawn frame
+///
+/// Blocks until any frame being drawn is complete.
+/// @returns An opaque 32-bit BGRA image, or NULL if nothing has been drawn at this size yet
+- (nullable CGImageRef)copyImage CF_RETURNS_RETAINED;
+
+@end
+
+NS_ASSUME_NONNULL_END
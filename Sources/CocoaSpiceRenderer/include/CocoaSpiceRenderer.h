@@ -18,7 +18,11 @@
 #define CocoaSpiceRenderer_h
 
 #include "CSMetalRenderer.h"
+#include "CSPixelConversion.h"
+#include "CSRegion.h"
 #include "CSRenderSource.h"
 #include "CSShaderTypes.h"
+#include "CSSoftwareRaster.h"
+#include "CSSoftwareRenderer.h"
 
 #endif /* CocoaSpiceRenderer_h */
@@ -0,0 +1,115 @@
+//
+// Copyright © 2026 osy. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#import <XCTest/XCTest.h>
+#import "CocoaSpice.h"
+#import "CSDisplay+Protected.h"
+#import <glib.h>
+#import <gst/gst.h>
+#import <spice-client.h>
+
+@interface CSDisplayOverlayTests : XCTestCase
+
+@end
+
+@implementation CSDisplayOverlayTests {
+    SpiceSession *_session;
+    SpiceChannel *_channel;
+    CSDisplay *_display;
+}
+
+- (void)setUp {
+    XCTAssertTrue([CSMain.sharedInstance spiceStart]);
+    gst_init(NULL, NULL);
+    [CSMain.sharedInstance syncWith:^{
+        self->_session = spice_session_new();
+        self->_channel = spice_channel_new(self->_session, SPICE_CHANNEL_DISPLAY, 0);
+        self->_display = [[CSDisplay alloc] initWithChannel:SPICE_DISPLAY_CHANNEL(self->_channel)];
+    }];
+}
+
+- (void)tearDown {
+    [CSMain.sharedInstance syncWith:^{
+        self->_display = nil;
+        g_object_unref(self->_channel);
+        g_object_unref(self->_session);
+    }];
+}
+
+/// Emit what spice-gtk emits when a stream starts, returns the window handle it got back
+- (gpointer)startStreamingWithPipeline:(GstElement *)pipeline handled:(gboolean *)handled {
+    __block gpointer handle = NULL;
+    __block gboolean result = FALSE;
+    [CSMain.sharedInstance syncWith:^{
+        g_signal_emit_by_name(self->_channel, "streaming-mode", TRUE, &handle);
+        if (handle) {
+            g_signal_emit_by_name(self->_channel, "gst-video-overlay", pipeline, &result);
+        }
+    }];
+    *handled = result;
+    return handle;
+}
+
+- (void)testStreamingModeDeclinedWithoutDevice {
+    GstElement *playbin = gst_element_factory_make("playbin", NULL);
+    XCTSkipUnless(playbin != NULL, @"playbin is not available");
+    gboolean handled = TRUE;
+    XCTAssertTrue([self startStreamingWithPipeline:playbin handled:&handled] == NULL);
+    XCTAssertFalse(handled);
+    gst_object_unref(playbin);
+}
+
+- (void)testStreamReachesOverlaySink {
+    id<MTLDevice> device = MTLCreateSystemDefaultDevice();
+    XCTSkipUnless(device != nil, @"no Metal device");
+    GstElement *playbin = gst_element_factory_make("playbin", NULL);
+    GstElement *source = gst_element_factory_make("videotestsrc", NULL);
+    XCTSkipUnless(playbin != NULL && source != NULL, @"playbin or videotestsrc is not available");
+    _display.device = device;
+
+    gboolean handled = FALSE;
+    XCTAssertTrue([self startStreamingWithPipeline:playbin handled:&handled] != NULL);
+    XCTAssertTrue(handled);
+    GstElement *sink = NULL;
+    g_object_get(playbin, "video-sink", &sink, NULL);
+    XCTAssertTrue(sink != NULL);
+
+    // playbin only links its sink once it has a stream, so feed the sink ourselves
+    GstElement *pipeline = gst_pipeline_new(NULL);
+    GstElement *filter = gst_element_factory_make("capsfilter", NULL);
+    GstCaps *caps = gst_caps_from_string("video/x-raw,format=BGRx,width=64,height=48");
+    g_object_set(source, "num-buffers", 2, NULL);
+    g_object_set(filter, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    gst_bin_add_many(GST_BIN(pipeline), source, filter, sink, NULL);
+    XCTAssertTrue(gst_element_link_many(source, filter, sink, NULL));
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *message = gst_bus_timed_pop_filtered(bus, 5 * GST_SECOND, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    XCTAssertTrue(message != NULL && GST_MESSAGE_TYPE(message) == GST_MESSAGE_EOS);
+    if (message) {
+        gst_message_unref(message);
+    }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+
+    XCTAssertGreaterThan(_display.statistics.framesReceived, 0);
+    gst_object_unref(pipeline);
+    gst_object_unref(sink);
+    gst_object_unref(playbin);
+}
+
+@end
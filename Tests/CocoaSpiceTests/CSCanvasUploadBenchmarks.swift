@@ -0,0 +1,80 @@
+#if os(macOS)
+import XCTest
+import Metal
+
+/// Per-frame CPU cost of getting a damaged canvas rectangle to the GPU, the way `CSDisplay` does it
+///
+/// Each iteration damages a full 4K frame of a no-copy canvas buffer and blits it into a texture.
+/// Compare `testPerRowRanges` (what the canvas used to do) with `testCoalescedRange` on any Mac,
+/// and with `testSharedStorage` on unified memory.
+final class CSCanvasUploadBenchmarks: XCTestCase {
+    private let width = 3840
+    private let height = 2160
+    private let frames = 30
+    private var stride: Int { width * 4 }
+
+    private var device: MTLDevice!
+    private var queue: MTLCommandQueue!
+    private var texture: MTLTexture!
+    private var canvas: UnsafeMutableRawPointer!
+    private var canvasSize: Int { (stride * height + Int(vm_page_size) - 1) & ~(Int(vm_page_size) - 1) }
+
+    override func setUpWithError() throws {
+        guard let device = MTLCreateSystemDefaultDevice() else {
+            throw XCTSkip("no Metal device")
+        }
+        self.device = device
+        queue = device.makeCommandQueue()
+        let descriptor = MTLTextureDescriptor.texture2DDescriptor(pixelFormat: .bgra8Unorm, width: width, height: height, mipmapped: false)
+        descriptor.usage = .shaderRead
+        descriptor.storageMode = .private
+        texture = device.makeTexture(descriptor: descriptor)
+        var pointer: UnsafeMutableRawPointer?
+        XCTAssertEqual(posix_memalign(&pointer, Int(vm_page_size), canvasSize), 0)
+        canvas = pointer
+        memset(canvas, 0x80, canvasSize)
+    }
+
+    override func tearDown() {
+        free(canvas)
+    }
+
+    private func upload(options: MTLResourceOptions, markModified: (MTLBuffer) -> Void) throws {
+        let buffer = try XCTUnwrap(device.makeBuffer(bytesNoCopy: canvas, length: canvasSize, options: options, deallocator: nil))
+        measure(metrics: [XCTCPUMetric(), XCTClockMetric()]) {
+            for _ in 0..<frames {
+                markModified(buffer)
+                let commandBuffer = queue.makeCommandBuffer()!
+                let blit = commandBuffer.makeBlitCommandEncoder()!
+                blit.copy(from: buffer, sourceOffset: 0, sourceBytesPerRow: stride, sourceBytesPerImage: stride * height,
+                          sourceSize: MTLSize(width: width, height: height, depth: 1),
+                          to: texture, destinationSlice: 0, destinationLevel: 0, destinationOrigin: MTLOrigin())
+                blit.endEncoding()
+                commandBuffer.commit()
+                commandBuffer.waitUntilCompleted()
+            }
+        }
+    }
+
+    func testPerRowRanges() throws {
+        try upload(options: .storageModeManaged) { buffer in
+            for row in 0..<height {
+                buffer.didModifyRange(row * stride ..< row * stride + width * 4)
+            }
+        }
+    }
+
+    func testCoalescedRange() throws {
+        try upload(options: .storageModeManaged) { buffer in
+            buffer.didModifyRange(0 ..< (height - 1) * stride + width * 4)
+        }
+    }
+
+    func testSharedStorage() throws {
+        guard device.hasUnifiedMemory else {
+            throw XCTSkip("shared storage needs unified memory")
+        }
+        try upload(options: .storageModeShared) { _ in }
+    }
+}
+#endif
@@ -0,0 +1,159 @@
+#if os(macOS)
+import XCTest
+import MetalKit
+import CocoaSpiceRenderer
+
+/// Allocations made by one thread, counted through the `malloc_logger` hook stack logging uses
+///
+/// Only the thread the count was started on counts, so whatever the rest of the process does
+/// at the same time, such as Metal's own threads, does not show up.
+private enum AllocationCounter {
+    typealias Logger = @convention(c) (UInt32, UInt, UInt, UInt, UInt, UInt32) -> Void
+
+    /// `MALLOC_LOG_TYPE_ALLOCATE`, set for malloc, calloc, valloc and realloc
+    static let allocateType: UInt32 = 2
+    static var thread: pthread_t?
+    static var allocations = 0
+    static let logger: Logger = { type, _, _, _, _, _ in
+        guard type & AllocationCounter.allocateType != 0,
+              let thread = AllocationCounter.thread,
+              pthread_equal(pthread_self(), thread) != 0 else {
+            return
+        }
+        AllocationCounter.allocations += 1
+    }
+    static let slot = dlsym(UnsafeMutableRawPointer(bitPattern: -2), "malloc_logger")?.assumingMemoryBound(to: Logger?.self)
+
+    /// Allocations `body` makes on the calling thread, nil if they cannot be counted
+    static func count(_ body: () -> Void) -> Int? {
+        guard let slot = slot, slot.pointee == nil else {
+            return nil
+        }
+        // touch everything the hook reads before it is installed, so it never initializes them
+        allocations = 0
+        thread = pthread_self()
+        _ = logger
+        slot.pointee = logger
+        body()
+        slot.pointee = nil
+        thread = nil
+        return allocations
+    }
+}
+
+/// Updates to `CSMetalRenderer` must not allocate once a source has been seen
+///
+/// A display invalidates for every frame and the cursor for every mouse move, often many
+/// times a refresh. Allocations are counted on the main thread, which is both where updates
+/// are sent from and `renderQueue` for this renderer, while updates pile up faster than the
+/// render queue takes them. That is when a per-update snapshot or block would show.
+final class CSMetalRendererAllocationTests: XCTestCase {
+    private final class Source: NSObject, CSRenderSource {
+        let isVisible = true
+        let offset = CGPoint.zero
+        let texture: MTLTexture?
+        let numVertices = 6
+        let vertices: MTLBuffer?
+        let hasAlpha = false
+        let isInverted = false
+        weak var cursorSource: CSRenderSource?
+
+        init(device: MTLDevice) {
+            let descriptor = MTLTextureDescriptor.texture2DDescriptor(pixelFormat: .bgra8Unorm, width: 64, height: 64, mipmapped: false)
+            texture = device.makeTexture(descriptor: descriptor)
+            vertices = device.makeBuffer(length: numVertices * MemoryLayout<CSRenderVertex>.stride)
+        }
+    }
+
+    /// Allocations allowed for everything the test itself does around the renderer
+    private let allowedAllocations = 16
+
+    private var view: MTKView!
+    private var renderer: CSMetalRenderer!
+    private var source: Source!
+
+    override func setUpWithError() throws {
+        guard let device = MTLCreateSystemDefaultDevice() else {
+            throw XCTSkip("no Metal device")
+        }
+        let seen = AllocationCounter.count {
+            free(malloc(16))
+        }
+        guard let seen = seen, seen > 0 else {
+            throw XCTSkip("allocations cannot be counted through malloc_logger")
+        }
+        view = MTKView(frame: CGRect(x: 0, y: 0, width: 64, height: 64), device: device)
+        view.isPaused = true
+        view.enableSetNeedsDisplay = false
+        renderer = CSMetalRenderer(metalKitView: view)
+        source = Source(device: device)
+
+        // the first update from a source sets up what every later one reuses
+        renderer.invalidate(source, withCompletion: nil)
+        renderer.invalidateCursor(of: source)
+        drainMainQueue()
+    }
+
+    /// Run everything already on the main queue, allocating the same whatever is on it
+    private func drainMainQueue() {
+        var drained = false
+        DispatchQueue.main.async {
+            drained = true
+        }
+        while !drained {
+            CFRunLoopRunInMode(.defaultMode, 1, true)
+        }
+    }
+
+    /// Send `count` updates of the display and its cursor
+    private func sendUpdates(_ count: Int) {
+        for _ in 0..<count {
+            renderer.invalidate(source, withCompletion: nil)
+            renderer.invalidateCursor(of: source)
+        }
+    }
+
+    func testInvalidateAllocatesNothing() throws {
+        let queued = try XCTUnwrap(AllocationCounter.count {
+            sendUpdates(10_000)
+        })
+        XCTAssertLessThan(queued, allowedAllocations, "updates waiting for the render queue are queued rather than merged")
+
+        let drain = try XCTUnwrap(AllocationCounter.count {
+            drainMainQueue()
+        })
+        sendUpdates(10_000)
+        let applied = try XCTUnwrap(AllocationCounter.count {
+            drainMainQueue()
+        })
+        XCTAssertLessThan(applied - drain, allowedAllocations, "applying updates allocates")
+    }
+
+    func testPresentAllocatesNothingPerUpdate() throws {
+        let framesBefore = renderer.fullFrameCount + renderer.partialFrameCount
+        renderer.draw(in: view)
+        guard renderer.fullFrameCount + renderer.partialFrameCount > framesBefore else {
+            throw XCTSkip("the view has no drawable")
+        }
+
+        // Metal allocates for every frame it encodes, the same whatever was updated, so
+        // only frames with many updates are compared with frames with one
+        func present(frames: Int, updatesPerFrame: Int) -> Int? {
+            AllocationCounter.count {
+                for _ in 0..<frames {
+                    autoreleasepool {
+                        sendUpdates(updatesPerFrame)
+                        drainMainQueue()
+                        renderer.draw(in: view)
+                    }
+                }
+            }
+        }
+        // let every drawable of the layer go round once before counting
+        _ = present(frames: 4, updatesPerFrame: 1)
+        let single = try XCTUnwrap(present(frames: 30, updatesPerFrame: 1))
+        let many = try XCTUnwrap(present(frames: 30, updatesPerFrame: 100))
+        XCTAssertLessThan(many - single, allowedAllocations, "presenting allocates for every update")
+    }
+}
+#endif
@@ -0,0 +1,85 @@
+import XCTest
+import CocoaSpiceRenderer
+
+final class CSPixelConversionTests: XCTestCase {
+    private func expected(_ pixel: UInt16) -> [UInt8] {
+        let widen = { (c: UInt16) in UInt8((Double(c & 0x1f) * 255 / 31).rounded()) }
+        return [widen(pixel), widen(pixel >> 5), widen(pixel >> 10), 255]
+    }
+
+    func testEveryPixelValue() throws {
+        let pixels = (0...UInt16.max).map { $0 }
+        var converted = [UInt8](repeating: 0, count: pixels.count * 4)
+        pixels.withUnsafeBytes { src in
+            converted.withUnsafeMutableBytes { dst in
+                cs_convert_xrgb1555_to_bgra8(dst.baseAddress!.assumingMemoryBound(to: UInt8.self), pixels.count * 4,
+                                             src.baseAddress, pixels.count * 2, pixels.count, 1)
+            }
+        }
+        for (i, pixel) in pixels.enumerated() {
+            XCTAssertEqual(Array(converted[i * 4 ..< i * 4 + 4]), expected(pixel), "pixel \(pixel)")
+        }
+    }
+
+    func testRectInsideLargerSurfaces() throws {
+        // odd sizes exercise the scalar tail, strides leave bytes that must not be touched
+        let (width, height, srcStride, dstStride) = (13, 5, 40, 64)
+        let source = (0..<srcStride / 2 * height).map { _ in UInt16.random(in: 0...UInt16.max) }
+        var converted = [UInt8](repeating: 0xcc, count: dstStride * height)
+        source.withUnsafeBytes { src in
+            converted.withUnsafeMutableBytes { dst in
+                cs_convert_xrgb1555_to_bgra8(dst.baseAddress!.assumingMemoryBound(to: UInt8.self), dstStride,
+                                             src.baseAddress, srcStride, width, height)
+            }
+        }
+        for y in 0..<height {
+            for x in 0..<dstStride / 4 {
+                let pixel = Array(converted[y * dstStride + x * 4 ..< y * dstStride + x * 4 + 4])
+                if x < width {
+                    XCTAssertEqual(pixel, expected(source[y * srcStride / 2 + x]), "at \(x), \(y)")
+                } else {
+                    XCTAssertEqual(pixel, [0xcc, 0xcc, 0xcc, 0xcc], "at \(x), \(y)")
+                }
+            }
+        }
+    }
+
+    func testDownscaleOnlyTouchesDamagedPixels() throws {
+        // 8x6 to 4x3 is exactly 2x2 per pixel, so every sample lands on its own source pixel
+        let (srcWidth, srcHeight, dstWidth, dstHeight) = (8, 6, 4, 3)
+        let source = (0..<srcWidth * srcHeight).flatMap { i in [UInt8(i), 0x40, 0x80, 0] }
+        var thumbnail = [UInt8](repeating: 0xcc, count: dstWidth * dstHeight * 4)
+        source.withUnsafeBytes { src in
+            thumbnail.withUnsafeMutableBytes { dst in
+                cs_downscale_to_bgra8(dst.baseAddress!.assumingMemoryBound(to: UInt8.self), dstWidth * 4, dstWidth, dstHeight,
+                                      src.baseAddress, srcWidth * 4, srcWidth, srcHeight, kCSDownscaleSourceRGBX8,
+                                      2, 2, 3, 1)
+            }
+        }
+        for y in 0..<dstHeight {
+            for x in 0..<dstWidth {
+                let pixel = Array(thumbnail[(y * dstWidth + x) * 4 ..< (y * dstWidth + x) * 4 + 4])
+                if y == 1 && (x == 1 || x == 2) {
+                    let red = (0...1).flatMap { dy in (0...1).map { dx in (y * 2 + dy) * srcWidth + x * 2 + dx } }
+                    XCTAssertEqual(pixel, [0x80, 0x40, UInt8((red.reduce(0, +) + 2) / 4), 0xff], "at \(x), \(y)")
+                } else {
+                    XCTAssertEqual(pixel, [0xcc, 0xcc, 0xcc, 0xcc], "at \(x), \(y)")
+                }
+            }
+        }
+    }
+
+    func testPerformance() throws {
+        let (width, height) = (1920, 1080)
+        let source = [UInt16](repeating: 0x5a5a, count: width * height)
+        var converted = [UInt8](repeating: 0, count: width * height * 4)
+        measure {
+            source.withUnsafeBytes { src in
+                converted.withUnsafeMutableBytes { dst in
+                    cs_convert_xrgb1555_to_bgra8(dst.baseAddress!.assumingMemoryBound(to: UInt8.self), width * 4,
+                                                 src.baseAddress, width * 2, width, height)
+                }
+            }
+        }
+    }
+}
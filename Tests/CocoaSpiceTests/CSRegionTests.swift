@@ -0,0 +1,96 @@
+import XCTest
+import CocoaSpiceRenderer
+
+final class CSRegionTests: XCTestCase {
+    private var region = CSRegion()
+
+    override func setUp() {
+        cs_region_init(&region)
+    }
+
+    private func add(_ x: Int32, _ y: Int32, _ width: Int32, _ height: Int32) {
+        cs_region_add(&region, CSRegionRect(x: x, y: y, width: width, height: height))
+    }
+
+    private func flush() -> [CSRegionRect] {
+        var rects = [CSRegionRect](repeating: CSRegionRect(), count: Int(CS_REGION_MAX_RECTS))
+        let count = cs_region_flush(&region, &rects)
+        return Array(rects[0..<count])
+    }
+
+    func testEmptyRectIsIgnored() throws {
+        add(10, 10, 0, 20)
+        add(10, 10, 20, -1)
+        XCTAssertTrue(cs_region_is_empty(&region))
+        XCTAssertEqual(region.damagedPixels, 0)
+    }
+
+    func testDistantRectsStaySeparate() throws {
+        // clock in one corner, cursor trail in the other, on a 4K canvas
+        add(3740, 2120, 100, 40)
+        add(0, 0, 32, 32)
+        XCTAssertEqual(region.count, 2)
+        XCTAssertEqual(cs_region_area(&region), 100 * 40 + 32 * 32)
+        XCTAssertEqual(flush().count, 2)
+        XCTAssertEqual(region.uploadedPixels, region.damagedPixels)
+    }
+
+    func testAdjacentRowsMerge() throws {
+        for row in Int32(0)..<100 {
+            add(0, row, 1920, 1)
+        }
+        XCTAssertEqual(region.count, 1)
+        let extents = cs_region_extents(&region)
+        XCTAssertEqual(extents.x, 0)
+        XCTAssertEqual(extents.y, 0)
+        XCTAssertEqual(extents.width, 1920)
+        XCTAssertEqual(extents.height, 100)
+        XCTAssertEqual(region.damagedPixels, 1920 * 100)
+    }
+
+    func testRepeatedDamageIsCountedOnce() throws {
+        add(100, 100, 50, 50)
+        add(100, 100, 50, 50)
+        add(110, 110, 10, 10)
+        XCTAssertEqual(region.count, 1)
+        XCTAssertEqual(region.damagedPixels, 50 * 50)
+    }
+
+    func testOverlapIsSplit() throws {
+        // a horizontal and a vertical bar crossing: their bounding box is mostly empty
+        add(0, 500, 1000, 10)
+        add(500, 0, 10, 1000)
+        XCTAssertEqual(cs_region_area(&region), 1000 * 10 + 10 * 1000 - 10 * 10)
+        XCTAssertEqual(region.damagedPixels, cs_region_area(&region))
+        let rects = flush()
+        for i in 0..<rects.count {
+            for j in (i + 1)..<rects.count {
+                let a = rects[i], b = rects[j]
+                let disjoint = a.x + a.width <= b.x || b.x + b.width <= a.x ||
+                               a.y + a.height <= b.y || b.y + b.height <= a.y
+                XCTAssertTrue(disjoint, "\(a) overlaps \(b)")
+            }
+        }
+    }
+
+    func testBoundedRectCount() throws {
+        // a grid of small updates too far apart to merge for free
+        for i in Int32(0)..<64 {
+            add((i % 8) * 400, (i / 8) * 250, 16, 16)
+        }
+        XCTAssertLessThanOrEqual(region.count, Int(CS_REGION_MAX_RECTS))
+        XCTAssertEqual(region.damagedPixels, 64 * 16 * 16)
+        XCTAssertGreaterThanOrEqual(cs_region_area(&region), region.damagedPixels)
+        _ = flush()
+        XCTAssertTrue(cs_region_is_empty(&region))
+        XCTAssertGreaterThan(region.uploadedPixels, region.damagedPixels)
+    }
+
+    func testClearDoesNotCountAsUploaded() throws {
+        add(0, 0, 64, 64)
+        cs_region_clear(&region)
+        XCTAssertTrue(cs_region_is_empty(&region))
+        XCTAssertEqual(region.uploadedPixels, 0)
+        XCTAssertEqual(flush().count, 0)
+    }
+}
@@ -0,0 +1,71 @@
+import XCTest
+import CocoaSpiceRenderer
+
+final class CSSoftwareRasterTests: XCTestCase {
+    private let size = 8
+
+    /// The quad `CSDisplay` builds for a canvas of `width` by `height`
+    private func quad(_ width: Float, _ height: Float) -> [CSRasterVertex] {
+        let (w, h) = (width / 2, height / 2)
+        return [
+            CSRasterVertex(position: CSRasterPoint(x: w, y: h), textureCoordinate: CSRasterPoint(x: 1, y: 0)),
+            CSRasterVertex(position: CSRasterPoint(x: -w, y: h), textureCoordinate: CSRasterPoint(x: 0, y: 0)),
+            CSRasterVertex(position: CSRasterPoint(x: -w, y: -h), textureCoordinate: CSRasterPoint(x: 0, y: 1)),
+            CSRasterVertex(position: CSRasterPoint(x: w, y: h), textureCoordinate: CSRasterPoint(x: 1, y: 0)),
+            CSRasterVertex(position: CSRasterPoint(x: -w, y: -h), textureCoordinate: CSRasterPoint(x: 0, y: 1)),
+            CSRasterVertex(position: CSRasterPoint(x: w, y: -h), textureCoordinate: CSRasterPoint(x: 1, y: 1)),
+        ]
+    }
+
+    private func draw(_ texels: [UInt8], hasAlpha: Bool, into framebuffer: inout [UInt8],
+                      width: Int, scale: Float = 1, origin: CSRasterPoint = CSRasterPoint()) {
+        let vertices = quad(Float(size), Float(size))
+        texels.withUnsafeBytes { texels in
+            framebuffer.withUnsafeMutableBytes { pixels in
+                var target = CSRasterTarget(pixels: pixels.baseAddress!.assumingMemoryBound(to: UInt8.self),
+                                            width: width, height: width, bytesPerRow: width * 4)
+                var texture = CSRasterTexture(pixels: texels.baseAddress, width: size, height: size,
+                                              bytesPerRow: size * 4, format: CSRasterFormatBGRA8,
+                                              hasAlpha: hasAlpha, isInverted: false, linear: false)
+                cs_raster_clear(&target, 0, 0, 0, 255)
+                cs_raster_draw(&target, &texture, vertices, vertices.count, scale, origin)
+            }
+        }
+    }
+
+    func testQuadMapsTexelsOneToOne() throws {
+        // blue channel holds the texel index, alpha is garbage as it is for the canvas
+        let texels = (0..<size * size).flatMap { [UInt8($0), 0, 0, 0] }
+        var framebuffer = [UInt8](repeating: 0, count: size * size * 4)
+        draw(texels, hasAlpha: false, into: &framebuffer, width: size)
+        for i in 0..<size * size {
+            XCTAssertEqual(framebuffer[i * 4], UInt8(i))
+            XCTAssertEqual(framebuffer[i * 4 + 3], 255)
+        }
+    }
+
+    func testSharedEdgeIsFilledOnce() throws {
+        // half transparent white over black, a pixel blended twice would come out brighter
+        let texels: [UInt8] = (0..<size * size * 4).map { $0 % 4 == 3 ? 128 : 255 }
+        var framebuffer = [UInt8](repeating: 0, count: size * size * 4)
+        draw(texels, hasAlpha: true, into: &framebuffer, width: size)
+        for i in 0..<size * size {
+            XCTAssertEqual(framebuffer[i * 4], 128)
+        }
+    }
+
+    func testScaleAndOrigin() throws {
+        let texels = (0..<size * size).flatMap { [UInt8($0), 0, 0, 0] }
+        let width = 32
+        var framebuffer = [UInt8](repeating: 0, count: width * width * 4)
+        draw(texels, hasAlpha: false, into: &framebuffer, width: width, scale: 2, origin: CSRasterPoint(x: 4, y: 2))
+        // centred, twice the size, then moved 4 right and 2 down
+        for y in 0..<width {
+            for x in 0..<width {
+                let inside = (12..<28).contains(x) && (10..<26).contains(y)
+                let expected = inside ? UInt8((y - 10) / 2 * size + (x - 12) / 2) : 0
+                XCTAssertEqual(framebuffer[(y * width + x) * 4], expected, "at \(x), \(y)")
+            }
+        }
+    }
+}